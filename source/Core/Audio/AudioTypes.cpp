@@ -0,0 +1,122 @@
+#include "AudioTypes.h"
+#include "Surround.h"
+
+#if CORE_AUDIO_AVX2
+#   include <immintrin.h>
+#   if defined(_MSC_VER)
+#       include <intrin.h>
+#   endif
+// msvc builds the avx2 intrinsics anywhere, gcc and clang only in functions targeting avx2
+#   if defined(__GNUC__) || defined(__clang__)
+#       define CORE_AUDIO_AVX2_TARGET __attribute__((target("avx2")))
+#   else
+#       define CORE_AUDIO_AVX2_TARGET
+#   endif
+#endif
+
+namespace core
+{
+    bool IsAvx2Supported()
+    {
+#if CORE_AUDIO_AVX2
+        static const bool isSupported = []()
+        {
+#   if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7)
+                return false;
+            // avx and osxsave, then the os has to save the ymm registers
+            __cpuid(info, 1);
+            if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+                return false;
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#   else
+            return __builtin_cpu_supports("avx2") != 0;
+#   endif
+        }();
+        return isSupported;
+#else
+        return false;
+#endif
+    }
+
+#if CORE_AUDIO_AVX2
+    // [l0 r0 l1 r1 l2 r2 l3 r3] with each side moved toward the other one
+    CORE_AUDIO_AVX2_TARGET static inline __m256 SeparateStereo(__m256 samples, __m256 stereo)
+    {
+        auto swapped = _mm256_permute_ps(samples, _MM_SHUFFLE(2, 3, 0, 1));
+        return _mm256_add_ps(samples, _mm256_mul_ps(_mm256_sub_ps(swapped, samples), stereo));
+    }
+
+    // 8 int16 sign extended to float
+    CORE_AUDIO_AVX2_TARGET static inline __m256 ConvertInt16(__m128i samples, __m256 scale)
+    {
+        return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(samples)), scale);
+    }
+
+    CORE_AUDIO_AVX2_TARGET uint32_t StereoSample::ConvertInterleavedAvx2(StereoSample* output, const int16_t* input, uint32_t numSamples, float scale, float stereo)
+    {
+        auto vScale = _mm256_set1_ps(scale);
+        auto vStereo = _mm256_set1_ps(stereo);
+        uint32_t i = 0;
+        for (; i + 8 <= numSamples; i += 8, input += 16, output += 8)
+        {
+            _mm256_storeu_ps(&output[0].left, SeparateStereo(ConvertInt16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input)), vScale), vStereo));
+            _mm256_storeu_ps(&output[4].left, SeparateStereo(ConvertInt16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 8)), vScale), vStereo));
+        }
+        _mm256_zeroupper();
+        return i;
+    }
+
+    CORE_AUDIO_AVX2_TARGET uint32_t StereoSample::ConvertInterleavedAvx2(StereoSample* output, const float* input, uint32_t numSamples, float scale, float stereo)
+    {
+        // input can be the output (each block is loaded before being stored)
+        auto vScale = _mm256_set1_ps(scale);
+        auto vStereo = _mm256_set1_ps(stereo);
+        uint32_t i = 0;
+        for (; i + 8 <= numSamples; i += 8, input += 16, output += 8)
+        {
+            auto s0 = _mm256_loadu_ps(input);
+            auto s1 = _mm256_loadu_ps(input + 8);
+            _mm256_storeu_ps(&output[0].left, SeparateStereo(_mm256_mul_ps(s0, vScale), vStereo));
+            _mm256_storeu_ps(&output[4].left, SeparateStereo(_mm256_mul_ps(s1, vScale), vStereo));
+        }
+        _mm256_zeroupper();
+        return i;
+    }
+
+    CORE_AUDIO_AVX2_TARGET uint32_t StereoSample::ConvertPlanarAvx2(StereoSample* output, const int16_t* inputLeft, const int16_t* inputRight, uint32_t numSamples, float scale, float stereo)
+    {
+        auto vScale = _mm256_set1_ps(scale);
+        auto vStereo = _mm256_set1_ps(stereo);
+        uint32_t i = 0;
+        for (; i + 8 <= numSamples; i += 8, inputLeft += 8, inputRight += 8, output += 8)
+        {
+            auto l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputLeft));
+            auto r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputRight));
+            _mm256_storeu_ps(&output[0].left, SeparateStereo(ConvertInt16(_mm_unpacklo_epi16(l, r), vScale), vStereo));
+            _mm256_storeu_ps(&output[4].left, SeparateStereo(ConvertInt16(_mm_unpackhi_epi16(l, r), vScale), vStereo));
+        }
+        _mm256_zeroupper();
+        return i;
+    }
+
+    CORE_AUDIO_AVX2_TARGET uint32_t Surround::ProcessAvx2(StereoSample* delay, StereoSample* samples, uint32_t numSamples)
+    {
+        auto mix = _mm256_set1_ps(kMix);
+        uint32_t i = 0;
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            auto d = _mm256_loadu_ps(&delay[i].left);
+            auto s = _mm256_loadu_ps(&samples[i].left);
+            _mm256_storeu_ps(&delay[i].left, s);
+            _mm256_storeu_ps(&samples[i].left, _mm256_mul_ps(_mm256_add_ps(_mm256_permute_ps(d, _MM_SHUFFLE(2, 3, 0, 1)), s), mix));
+        }
+        _mm256_zeroupper();
+        return i;
+    }
+#endif
+}
+// namespace core
@@ -2,10 +2,27 @@
 
 #include <Core/Types.h>
 
+#if (defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)) && !defined(_M_ARM64EC)
+#   define CORE_AUDIO_SSE2 1
+#   include <emmintrin.h>
+#else
+#   define CORE_AUDIO_SSE2 0
+#endif
+
+// the avx2 kernels are built in AudioTypes.cpp and picked at runtime
+#if (defined(_M_X64) || defined(__x86_64__)) && !defined(_M_ARM64EC)
+#   define CORE_AUDIO_AVX2 1
+#else
+#   define CORE_AUDIO_AVX2 0
+#endif
+
 namespace core
 {
     class Surround;
 
+    // cpu and os support, checked once
+    bool IsAvx2Supported();
+
     struct StereoSample
     {
         float left;
@@ -22,6 +39,17 @@ namespace core
         StereoSample* Convert(Surround& surround, const int16_t* inputLeft, const int16_t* inputRight, uint32_t numSamples, uint32_t stereoSeparation, float scale = 1.0f);
 
         StereoSample operator*(float scale) const { return { left * scale, right * scale }; }
+
+    private:
+        // kernels shared by the conversions: sample * scale, then stereo separation (0 is none)
+        StereoSample* ConvertInterleaved(const int16_t* input, uint32_t numSamples, float scale, float stereo);
+        StereoSample* ConvertInterleaved(const float* input, uint32_t numSamples, float scale, float stereo);
+        StereoSample* ConvertPlanar(const int16_t* inputLeft, const int16_t* inputRight, uint32_t numSamples, float scale, float stereo);
+
+        // same, 8 samples at a time, they return the number of samples converted (the caller does the tail)
+        static uint32_t ConvertInterleavedAvx2(StereoSample* output, const int16_t* input, uint32_t numSamples, float scale, float stereo);
+        static uint32_t ConvertInterleavedAvx2(StereoSample* output, const float* input, uint32_t numSamples, float scale, float stereo);
+        static uint32_t ConvertPlanarAvx2(StereoSample* output, const int16_t* inputLeft, const int16_t* inputRight, uint32_t numSamples, float scale, float stereo);
     };
 
     struct LoopInfo
@@ -5,35 +5,48 @@
 
 namespace core
 {
+#if CORE_AUDIO_SSE2
+    // [l0 r0 l1 r1] with each side moved toward the other one
+    inline __m128 SeparateStereo(__m128 samples, __m128 stereo)
+    {
+        auto swapped = _mm_shuffle_ps(samples, samples, _MM_SHUFFLE(2, 3, 0, 1));
+        return _mm_add_ps(samples, _mm_mul_ps(_mm_sub_ps(swapped, samples), stereo));
+    }
+
+    // sign extended int16 to float
+    inline __m128 ConvertLow(__m128i samples, __m128 scale)
+    {
+        return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16)), scale);
+    }
+
+    inline __m128 ConvertHigh(__m128i samples, __m128 scale)
+    {
+        return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16)), scale);
+    }
+#endif
+
     inline StereoSample* StereoSample::Convert(const int16_t* input, uint32_t numSamples, float scale)
     {
-        auto output = this;
-        for (; numSamples; numSamples--)
-        {
-            StereoSample s;
-            s.left = *input++ / 32767.0f;
-            s.right = *input++ / 32767.0f;
-            *output++ = s * scale;
-        }
-        return output;
+        return ConvertInterleaved(input, numSamples, scale / 32767.0f, 0.0f);
     }
 
     inline StereoSample* StereoSample::Convert(const int16_t* inputLeft, const int16_t* inputRight, uint32_t numSamples, float scale)
     {
-        auto output = this;
-        for (; numSamples; numSamples--)
-        {
-            StereoSample s;
-            s.left = *inputLeft++ / 32767.0f;
-            s.right = *inputRight++ / 32767.0f;
-            *output++ = s * scale;
-        }
-        return output;
+        return ConvertPlanar(inputLeft, inputRight, numSamples, scale / 32767.0f, 0.0f);
     }
 
     inline StereoSample* StereoSample::ConvertMono(const float* input, uint32_t numSamples, float scale)
     {
         auto output = this;
+#if CORE_AUDIO_SSE2
+        auto vScale = _mm_set1_ps(scale);
+        for (; numSamples >= 4; numSamples -= 4, input += 4, output += 4)
+        {
+            auto s = _mm_mul_ps(_mm_loadu_ps(input), vScale);
+            _mm_storeu_ps(&output[0].left, _mm_unpacklo_ps(s, s));
+            _mm_storeu_ps(&output[2].left, _mm_unpackhi_ps(s, s));
+        }
+#endif
         for (; numSamples; numSamples--)
         {
             StereoSample s;
@@ -46,10 +59,24 @@ namespace core
     inline StereoSample* StereoSample::ConvertMono(const int16_t* input, uint32_t numSamples, float scale)
     {
         auto output = this;
+        scale /= 32767.0f;
+#if CORE_AUDIO_SSE2
+        auto vScale = _mm_set1_ps(scale);
+        for (; numSamples >= 8; numSamples -= 8, input += 8, output += 8)
+        {
+            auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+            auto lo = ConvertLow(v, vScale);
+            auto hi = ConvertHigh(v, vScale);
+            _mm_storeu_ps(&output[0].left, _mm_unpacklo_ps(lo, lo));
+            _mm_storeu_ps(&output[2].left, _mm_unpackhi_ps(lo, lo));
+            _mm_storeu_ps(&output[4].left, _mm_unpacklo_ps(hi, hi));
+            _mm_storeu_ps(&output[6].left, _mm_unpackhi_ps(hi, hi));
+        }
+#endif
         for (; numSamples; numSamples--)
         {
             StereoSample s;
-            s.left = s.right = scale * *input++ / 32767.0f;
+            s.left = s.right = scale * *input++;
             *output++ = s;
         }
         return output;
@@ -57,68 +84,131 @@ namespace core
 
     inline StereoSample* StereoSample::Convert(Surround& surround, uint32_t numSamples, float scale)
     {
-        auto output = this;
-        auto ctx = surround.Begin();
-        for (uint32_t i = 0; i < numSamples; i++)
-            *output++ = ctx(*output * scale);
-        surround.End(ctx);
+        auto output = ConvertInterleaved(&left, numSamples, scale, 0.0f);
+        surround.Process(this, numSamples);
         return output;
     }
 
     inline StereoSample* StereoSample::Convert(Surround& surround, const float* input, uint32_t numSamples, uint32_t stereoSeparation, float scale)
+    {
+        auto output = ConvertInterleaved(input, numSamples, scale, 0.5f - 0.5f * stereoSeparation / 100.0f);
+        surround.Process(this, numSamples);
+        return output;
+    }
+
+    inline StereoSample* StereoSample::Convert(Surround& surround, const int16_t* input, uint32_t numSamples, uint32_t stereoSeparation, float scale)
+    {
+        auto output = ConvertInterleaved(input, numSamples, scale / 32767.0f, 0.5f - 0.5f * stereoSeparation / 100.0f);
+        surround.Process(this, numSamples);
+        return output;
+    }
+
+    inline StereoSample* StereoSample::Convert(Surround& surround, const int16_t* inputLeft, const int16_t* inputRight, uint32_t numSamples, uint32_t stereoSeparation, float scale)
+    {
+        auto output = ConvertPlanar(inputLeft, inputRight, numSamples, scale / 32767.0f, 0.5f - 0.5f * stereoSeparation / 100.0f);
+        surround.Process(this, numSamples);
+        return output;
+    }
+
+    inline StereoSample* StereoSample::ConvertInterleaved(const int16_t* input, uint32_t numSamples, float scale, float stereo)
     {
         auto output = this;
-        auto ctx = surround.Begin();
-        float stereo = 0.5f - 0.5f * stereoSeparation / 100.0f;
-        for (uint32_t i = 0; i < numSamples; i++)
+#if CORE_AUDIO_AVX2
+        if (IsAvx2Supported())
+        {
+            auto numConverted = ConvertInterleavedAvx2(output, input, numSamples, scale, stereo);
+            output += numConverted;
+            input += numConverted * 2;
+            numSamples -= numConverted;
+        }
+#endif
+#if CORE_AUDIO_SSE2
+        auto vScale = _mm_set1_ps(scale);
+        auto vStereo = _mm_set1_ps(stereo);
+        for (; numSamples >= 4; numSamples -= 4, input += 8, output += 4)
+        {
+            auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+            _mm_storeu_ps(&output[0].left, SeparateStereo(ConvertLow(v, vScale), vStereo));
+            _mm_storeu_ps(&output[2].left, SeparateStereo(ConvertHigh(v, vScale), vStereo));
+        }
+#endif
+        for (; numSamples; numSamples--)
         {
             float l = scale * *input++;
             float r = scale * *input++;
-            StereoSample s;
-            s.left = l + (r - l) * stereo;
-            s.right = r + (l - r) * stereo;
-
-            *output++ = ctx(s);
+            output->left = l + (r - l) * stereo;
+            output->right = r + (l - r) * stereo;
+            output++;
         }
-        surround.End(ctx);
         return output;
     }
 
-    inline StereoSample* StereoSample::Convert(Surround& surround, const int16_t* input, uint32_t numSamples, uint32_t stereoSeparation, float scale)
+    inline StereoSample* StereoSample::ConvertInterleaved(const float* input, uint32_t numSamples, float scale, float stereo)
     {
+        // input can be the output
         auto output = this;
-        auto ctx = surround.Begin();
-        float stereo = 0.5f - 0.5f * stereoSeparation / 100.0f;
-        for (auto count = numSamples; count; --count)
+#if CORE_AUDIO_AVX2
+        if (IsAvx2Supported())
         {
-            float l = scale * *input++ / 32767.0f;
-            float r = scale * *input++ / 32767.0f;
-            StereoSample s;
-            s.left = l + (r - l) * stereo;
-            s.right = r + (l - r) * stereo;
-
-            *output++ = ctx(s);
+            auto numConverted = ConvertInterleavedAvx2(output, input, numSamples, scale, stereo);
+            output += numConverted;
+            input += numConverted * 2;
+            numSamples -= numConverted;
+        }
+#endif
+#if CORE_AUDIO_SSE2
+        auto vScale = _mm_set1_ps(scale);
+        auto vStereo = _mm_set1_ps(stereo);
+        for (; numSamples >= 2; numSamples -= 2, input += 4, output += 2)
+            _mm_storeu_ps(&output->left, SeparateStereo(_mm_mul_ps(_mm_loadu_ps(input), vScale), vStereo));
+#endif
+        for (; numSamples; numSamples--)
+        {
+            float l = scale * *input++;
+            float r = scale * *input++;
+            output->left = l + (r - l) * stereo;
+            output->right = r + (l - r) * stereo;
+            output++;
         }
-        surround.End(ctx);
         return output;
     }
 
-    inline StereoSample* StereoSample::Convert(Surround& surround, const int16_t* inputLeft, const int16_t* inputRight, uint32_t numSamples, uint32_t stereoSeparation, float scale)
+    inline StereoSample* StereoSample::ConvertPlanar(const int16_t* inputLeft, const int16_t* inputRight, uint32_t numSamples, float scale, float stereo)
     {
         auto output = this;
-        auto ctx = surround.Begin();
-        float stereo = 0.5f - 0.5f * stereoSeparation / 100.0f;
-        for (auto count = numSamples; count; --count)
+#if CORE_AUDIO_AVX2
+        if (IsAvx2Supported())
         {
-            float l = scale * *inputLeft++ / 32767.0f;
-            float r = scale * *inputRight++ / 32767.0f;
-            StereoSample s;
-            s.left = l + (r - l) * stereo;
-            s.right = r + (l - r) * stereo;
-
-            *output++ = ctx(s);
+            auto numConverted = ConvertPlanarAvx2(output, inputLeft, inputRight, numSamples, scale, stereo);
+            output += numConverted;
+            inputLeft += numConverted;
+            inputRight += numConverted;
+            numSamples -= numConverted;
+        }
+#endif
+#if CORE_AUDIO_SSE2
+        auto vScale = _mm_set1_ps(scale);
+        auto vStereo = _mm_set1_ps(stereo);
+        for (; numSamples >= 8; numSamples -= 8, inputLeft += 8, inputRight += 8, output += 8)
+        {
+            auto l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputLeft));
+            auto r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputRight));
+            auto lr = _mm_unpacklo_epi16(l, r);
+            _mm_storeu_ps(&output[0].left, SeparateStereo(ConvertLow(lr, vScale), vStereo));
+            _mm_storeu_ps(&output[2].left, SeparateStereo(ConvertHigh(lr, vScale), vStereo));
+            lr = _mm_unpackhi_epi16(l, r);
+            _mm_storeu_ps(&output[4].left, SeparateStereo(ConvertLow(lr, vScale), vStereo));
+            _mm_storeu_ps(&output[6].left, SeparateStereo(ConvertHigh(lr, vScale), vStereo));
+        }
+#endif
+        for (; numSamples; numSamples--)
+        {
+            float l = scale * *inputLeft++;
+            float r = scale * *inputRight++;
+            output->left = l + (r - l) * stereo;
+            output->right = r + (l - r) * stereo;
+            output++;
         }
-        surround.End(ctx);
         return output;
     }
 
@@ -35,8 +35,18 @@ namespace core
         Context Begin() const;
         void End(const Context& context);
 
+        // in place, same as going through the context sample by sample
+        void Process(StereoSample* samples, uint32_t numSamples);
+
         void Reset();
 
+    private:
+        // 4 samples at a time, returns the number of samples processed (the caller does the tail)
+        static uint32_t ProcessAvx2(StereoSample* delay, StereoSample* samples, uint32_t numSamples);
+
+    private:
+        static constexpr float kMix = 1.0f / 1.414f;
+
     private:
         Context m_context;
     };
@@ -75,5 +85,51 @@ namespace core
     {
         m_context.m_delayIndex = context.m_delayIndex;
     }
+
+    inline void Surround::Process(StereoSample* samples, uint32_t numSamples)
+    {
+        // the delay line is processed by contiguous runs (no modulo per sample)
+        auto& ctx = m_context;
+        assert(ctx.m_delaySize > 0);
+        if (ctx.m_delaySize == 0)
+            return; // no delay line at such a low sampling rate, the samples are left as they are
+        while (numSamples > 0)
+        {
+            auto count = Min(numSamples, ctx.m_delaySize - ctx.m_delayIndex);
+            auto* delay = ctx.m_data + ctx.m_delayIndex;
+            if (!ctx.m_isEnabled)
+                memcpy(delay, samples, count * sizeof(StereoSample));
+            else
+            {
+                uint32_t i = 0;
+#if CORE_AUDIO_AVX2
+                if (IsAvx2Supported())
+                    i = ProcessAvx2(delay, samples, count);
+#endif
+#if CORE_AUDIO_SSE2
+                auto mix = _mm_set1_ps(kMix);
+                for (; i + 2 <= count; i += 2)
+                {
+                    auto d = _mm_loadu_ps(&delay[i].left);
+                    auto s = _mm_loadu_ps(&samples[i].left);
+                    _mm_storeu_ps(&delay[i].left, s);
+                    _mm_storeu_ps(&samples[i].left, _mm_mul_ps(_mm_add_ps(_mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 3, 0, 1)), s), mix));
+                }
+#endif
+                for (; i < count; i++)
+                {
+                    auto d = delay[i];
+                    auto s = samples[i];
+                    delay[i] = s;
+                    samples[i] = { (d.right + s.left) * kMix, (d.left + s.right) * kMix };
+                }
+            }
+            ctx.m_delayIndex += count;
+            if (ctx.m_delayIndex == ctx.m_delaySize)
+                ctx.m_delayIndex = 0;
+            samples += count;
+            numSamples -= count;
+        }
+    }
 }
 // namespace core
\ No newline at end of file
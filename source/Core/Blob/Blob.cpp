@@ -0,0 +1,27 @@
+#include "Blob.h"
+
+#include <IO/File.h>
+
+#include <atomic>
+
+namespace core
+{
+    void Blob::AddToArena(Arena* arena, Blob* blob)
+    {
+        auto* record = reinterpret_cast<ArenaRecord*>(blob) - 1;
+        record->offset = uint32_t(reinterpret_cast<uint8_t*>(record) - reinterpret_cast<uint8_t*>(arena));
+        blob->isInArena = 1;
+        arena->numBlobs++;
+    }
+
+    void Blob::ReleaseArena(Arena* arena)
+    {
+        if (--std::atomic_ref(arena->numBlobs) != 0)
+            return;
+        if (arena->view)
+            io::File::Unmap(arena->view);
+        else
+            Free(arena);
+    }
+}
+// namespace core
@@ -19,8 +19,31 @@ namespace core
         template <typename TypeStatic>
         void Delete();
 
-        uint16_t dataSize = 0;
+        // arena of blobs loaded in one go and used in place, released with the last of its blobs
+        struct Arena
+        {
+            int32_t numBlobs; // alive, plus one for the loader until all the blobs are placed
+            uint32_t size;
+            union
+            {
+                void* view; // of the mapped file, null when the arena is allocated
+                uint64_t dummy; // to keep the struct size between 32bit and 64bit architectures
+            };
+        };
+        // each blob of an arena follows its record
+        struct ArenaRecord
+        {
+            uint32_t size; // including this header
+            uint32_t offset; // of this record in the arena
+        };
+        static void AddToArena(Arena* arena, Blob* blob);
+        static void ReleaseArena(Arena* arena);
+
+        static constexpr size_t kMaxDataSize = 0x7fff;
+
+        uint16_t dataSize : 15 = 0;
+        uint16_t isInArena : 1 = 0;
         int16_t refCount = 0;
     };
 }
-// namespace core
\ No newline at end of file
+// namespace core
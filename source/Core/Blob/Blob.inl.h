@@ -7,7 +7,7 @@ namespace core
     template <typename TypeStatic>
     inline TypeStatic* Blob::New(size_t sizeOfData)
     {
-        assert(sizeOfData < 65536);
+        assert(sizeOfData <= kMaxDataSize);
         auto buffer = new (Alloc<TypeStatic>(Max(sizeOfData + sizeof(Blob), sizeof(TypeStatic)))) TypeStatic();
         buffer->dataSize = uint16_t(sizeOfData);
         return buffer;
@@ -17,7 +17,14 @@ namespace core
     void Blob::Delete()
     {
         // we don't call the destructor for a static type, as it's supposed to be a POD
-        Free(this);
+        if (isInArena)
+        {
+            // the record gives the arena, freed with its last blob
+            auto* record = reinterpret_cast<ArenaRecord*>(this) - 1;
+            ReleaseArena(reinterpret_cast<Arena*>(reinterpret_cast<uint8_t*>(record) - record->offset));
+        }
+        else
+            Free(this);
     }
 }
 // namespace core
\ No newline at end of file
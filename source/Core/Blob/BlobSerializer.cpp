@@ -101,7 +101,7 @@ namespace core
 
                 mainPatch.buffer.Add(currentPatch.buffer.Items(), currentPatch.buffer.NumItems());
             }
-            if (m_patches.Size() >= 65536)
+            if (m_patches.Size() >= 65536 || mainPatch.buffer.NumItems() - sizeof(Blob) > Blob::kMaxDataSize)
                 m_isValid = false;
             m_patches.Resize(1);
         }
@@ -47,6 +47,8 @@ namespace core
 
         void Remove(uint16_t commandId);
 
+        const Array<Command>& Commands() const;
+
     private:
         Array<Command>& m_commands;
     };
@@ -84,5 +84,10 @@ namespace core
                 i += m_commands[i].numEntries + 1;
         }
     }
+
+    inline const Array<CommandBuffer::Command>& CommandBuffer::Commands() const
+    {
+        return m_commands;
+    }
 }
 // namespace rePlayer
\ No newline at end of file
@@ -44,7 +44,7 @@ namespace core::io
     File File::OpenForRead(const wchar_t* name)
     {
         DWORD dwDesiredAccess = GENERIC_READ;
-        DWORD dwShareMode = FILE_SHARE_READ;
+        DWORD dwShareMode = FILE_SHARE_READ | FILE_SHARE_DELETE; // a mapped file can still be renamed
         DWORD dwCreationDisposition = OPEN_EXISTING;
         DWORD dwFlagsAndAttributes = 0;
 
@@ -148,6 +148,22 @@ namespace core::io
         ::SetFilePointerEx(mHandle, largeOffset, nullptr, FILE_BEGIN);
     }
 
+    uint8_t* File::Map() const
+    {
+        uint8_t* view = nullptr;
+        if (auto mapping = ::CreateFileMappingW(mHandle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr))
+        {
+            view = reinterpret_cast<uint8_t*>(::MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+            ::CloseHandle(mapping);
+        }
+        return view;
+    }
+
+    void File::Unmap(const void* view)
+    {
+        ::UnmapViewOfFile(view);
+    }
+
     bool File::Delete(const wchar_t* name)
     {
         auto e = ::DeleteFileW(name);
@@ -56,6 +56,10 @@ namespace core::io
         uint64_t GetPosition() const;
         void Seek(uint64_t offset);
 
+        // copy on write view of the whole file (the pages written stay private), it outlives the file
+        uint8_t* Map() const;
+        static void Unmap(const void* view);
+
         static bool Delete(const char* name);
         static bool Copy(const char* srcName, const char* dstName);
         static bool Move(const char* oldName, const char* newName);
@@ -10,7 +10,7 @@ namespace core::io
     SmartPtr<StreamFile> StreamFile::Create(const std::string& filename, Stream* root)
     {
         SmartPtr<StreamFile> stream;
-        auto handle = ::CreateFileW(Convert(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+        auto handle = ::CreateFileW(Convert(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
         if (handle != INVALID_HANDLE_VALUE)
         {
             stream.New(root);
@@ -24,7 +24,7 @@ namespace core::io
     SmartPtr<StreamFile> StreamFile::Create(const std::wstring& filename, Stream* root)
     {
         SmartPtr<StreamFile> stream;
-        auto handle = ::CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+        auto handle = ::CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
         if (handle != INVALID_HANDLE_VALUE)
         {
             stream.New(root);
@@ -39,12 +39,13 @@ namespace core::io
     {
         if (m_stream.IsValid())
             return m_stream->Read(buffer, size);
+        auto* dest = reinterpret_cast<uint8_t*>(buffer);
         uint64_t totalRead = 0;
         while (totalRead < size)
         {
-            uint32_t toRead = size > 0xffFFffFF ? 0xffFFffFF : uint32_t(size);
+            uint32_t toRead = uint32_t(Min(size - totalRead, uint64_t(0xffFFffFF)));
             DWORD readSize = 0;
-            ::ReadFile(m_handle, buffer, uint32_t(size), &readSize, nullptr);
+            ::ReadFile(m_handle, dest + totalRead, toRead, &readSize, nullptr);
             totalRead += readSize;
             if (toRead != readSize)
                 break;
@@ -106,6 +107,26 @@ namespace core::io
         if (m_stream.IsValid())
             return m_stream->Read();
 
+        // map the file instead of copying it (an empty file can't be mapped)
+        // only the big files on a local fixed disk are mapped: a page fault on a removable or network drive raises an exception
+        // at any access of the span and a mapped file can't be deleted or moved, so the small ones are simply copied
+        auto size = GetSize();
+        if (size >= kMinMappedSize && IsOnFixedDisk())
+        {
+            if (auto mapping = ::CreateFileMappingW(m_handle, nullptr, PAGE_READONLY, 0, 0, nullptr))
+            {
+                auto* view = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                ::CloseHandle(mapping);
+                if (view)
+                {
+                    // the whole file is about to be decoded or hashed: start reading ahead
+                    WIN32_MEMORY_RANGE_ENTRY range = { view, size_t(Min(size, kPrefetchSize)) };
+                    ::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+                    m_cachedData = new MappedMemory(view);
+                }
+            }
+        }
+
         auto data = Stream::Read();
         ::CloseHandle(m_handle);
         m_handle = INVALID_HANDLE_VALUE;
@@ -114,6 +135,27 @@ namespace core::io
         return data;
     }
 
+    bool StreamFile::IsOnFixedDisk() const
+    {
+        wchar_t path[MAX_PATH];
+        // a network share has no volume guid
+        auto length = ::GetFinalPathNameByHandleW(m_handle, path, MAX_PATH, FILE_NAME_NORMALIZED | VOLUME_NAME_GUID);
+        if (length == 0 || length >= MAX_PATH)
+            return false;
+        // \\?\Volume{guid}\ is the root of the volume
+        auto* root = wcschr(path + 4, L'\\');
+        if (root == nullptr)
+            return false;
+        root[1] = 0;
+        return ::GetDriveTypeW(path) == DRIVE_FIXED;
+    }
+
+    StreamFile::MappedMemory::~MappedMemory()
+    {
+        ::UnmapViewOfFile(m_ptr);
+        m_ptr = nullptr;
+    }
+
     SmartPtr<Stream> StreamFile::OnOpen(const std::string& filename)
     {
         std::filesystem::path path(m_name);
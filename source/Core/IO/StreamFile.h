@@ -32,6 +32,18 @@ namespace core::io
         static [[nodiscard]] std::wstring Convert(const std::string& name);
         static [[nodiscard]] std::string Convert(const std::wstring& wName);
 
+        [[nodiscard]] bool IsOnFixedDisk() const;
+
+        // read only view of the whole file, unmapped with the last reference
+        struct MappedMemory : public SharedMemory
+        {
+            MappedMemory(void* ptr) : SharedMemory(ptr) {}
+            ~MappedMemory() override;
+        };
+
+        static constexpr uint64_t kPrefetchSize = 64 * 1024 * 1024;
+        static constexpr uint64_t kMinMappedSize = 4 * 1024 * 1024;
+
     private:
         std::string m_name;
         void* m_handle;
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Core/Types.h>
+
+#include <type_traits>
+
+namespace core::thread
+{
+    // move-only callable, small captures are stored in place (no allocation)
+    class Task
+    {
+    public:
+        Task() = default;
+        template <typename Callable, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Callable>, Task>>>
+        Task(Callable&& callable);
+        Task(Task&& otherTask);
+        ~Task();
+
+        Task& operator=(Task&& otherTask);
+
+        explicit operator bool() const;
+        void operator()();
+
+    private:
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        enum class Op : uint8_t
+        {
+            kInvoke,
+            kMove,
+            kDestroy
+        };
+
+        template <typename Callable>
+        static constexpr bool IsInPlace();
+        template <typename Callable>
+        static void Handle(Op op, Task* task, Task* otherTask);
+
+    private:
+        static constexpr uint32_t kBufferSize = 56;
+
+        void (*m_handler)(Op op, Task* task, Task* otherTask) = nullptr;
+        alignas(8) uint8_t m_buffer[kBufferSize];
+    };
+}
+// namespace core::thread
+
+#include "Task.inl.h"
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Task.h"
+
+#include <new>
+#include <utility>
+
+namespace core::thread
+{
+    template <typename Callable, typename>
+    inline Task::Task(Callable&& callable)
+        : m_handler(&Handle<std::decay_t<Callable>>)
+    {
+        using Type = std::decay_t<Callable>;
+        if constexpr (IsInPlace<Type>())
+            new (m_buffer) Type(std::forward<Callable>(callable));
+        else
+            *reinterpret_cast<Type**>(m_buffer) = new Type(std::forward<Callable>(callable));
+    }
+
+    inline Task::Task(Task&& otherTask)
+    {
+        if (otherTask.m_handler)
+        {
+            otherTask.m_handler(Op::kMove, this, &otherTask);
+            m_handler = otherTask.m_handler;
+            otherTask.m_handler = nullptr;
+        }
+    }
+
+    inline Task::~Task()
+    {
+        if (m_handler)
+            m_handler(Op::kDestroy, this, nullptr);
+    }
+
+    inline Task& Task::operator=(Task&& otherTask)
+    {
+        if (this != &otherTask)
+        {
+            if (m_handler)
+                m_handler(Op::kDestroy, this, nullptr);
+            m_handler = nullptr;
+            if (otherTask.m_handler)
+            {
+                otherTask.m_handler(Op::kMove, this, &otherTask);
+                m_handler = otherTask.m_handler;
+                otherTask.m_handler = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    inline Task::operator bool() const
+    {
+        return m_handler != nullptr;
+    }
+
+    inline void Task::operator()()
+    {
+        m_handler(Op::kInvoke, this, nullptr);
+    }
+
+    template <typename Callable>
+    inline constexpr bool Task::IsInPlace()
+    {
+        return sizeof(Callable) <= kBufferSize && alignof(Callable) <= 8 && std::is_nothrow_move_constructible_v<Callable>;
+    }
+
+    template <typename Callable>
+    inline void Task::Handle(Op op, Task* task, Task* otherTask)
+    {
+        if constexpr (IsInPlace<Callable>())
+        {
+            auto* callable = reinterpret_cast<Callable*>(task->m_buffer);
+            if (op == Op::kInvoke)
+                (*callable)();
+            else if (op == Op::kMove)
+            {
+                auto* otherCallable = reinterpret_cast<Callable*>(otherTask->m_buffer);
+                new (callable) Callable(std::move(*otherCallable));
+                otherCallable->~Callable();
+            }
+            else
+                callable->~Callable();
+        }
+        else
+        {
+            auto*& callable = *reinterpret_cast<Callable**>(task->m_buffer);
+            if (op == Op::kInvoke)
+                (*callable)();
+            else if (op == Op::kMove)
+                callable = *reinterpret_cast<Callable**>(otherTask->m_buffer);
+            else
+                delete callable;
+        }
+    }
+}
+// namespace core::thread
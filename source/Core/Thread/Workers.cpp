@@ -8,15 +8,113 @@
 #include <windows.h>
 
 // stl
+#include <bit>
 #include <thread>
 
 namespace core::thread
 {
+    static thread_local uint32_t s_workerIndex = ~0u;
+
+    Workers::Queue::Queue(uint32_t maxJobs)
+    {
+        maxJobs = std::bit_ceil(Max(maxJobs, 2u));
+        m_cells = new Cell[maxJobs];
+        m_mask = maxJobs - 1;
+        for (uint32_t i = 0; i < maxJobs; i++)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    Workers::Queue::~Queue()
+    {
+        delete[] m_cells;
+    }
+
+    bool Workers::Queue::Push(Job& job)
+    {
+        auto pos = m_pushPos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto& cell = m_cells[pos & m_mask];
+            auto diff = int32_t(cell.sequence.load(std::memory_order_acquire) - pos);
+            if (diff == 0)
+            {
+                if (m_pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.job = std::move(job);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) // full
+                return false;
+            else
+                pos = m_pushPos.load(std::memory_order_relaxed);
+        }
+    }
+
+    bool Workers::Queue::Pop(Job& job)
+    {
+        auto pos = m_popPos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto& cell = m_cells[pos & m_mask];
+            auto diff = int32_t(cell.sequence.load(std::memory_order_acquire) - (pos + 1));
+            if (diff == 0)
+            {
+                if (m_popPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    job = std::move(cell.job);
+                    cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) // empty
+                return false;
+            else
+                pos = m_popPos.load(std::memory_order_relaxed);
+        }
+    }
+
+    void Workers::Event::NotifyOne()
+    {
+        if (numWaiters.load() > 0)
+        {
+            epoch.fetch_add(1);
+            epoch.notify_one();
+        }
+    }
+
+    void Workers::Event::NotifyAll()
+    {
+        if (numWaiters.load() > 0)
+        {
+            epoch.fetch_add(1);
+            epoch.notify_all();
+        }
+    }
+
+    template <typename Predicate>
+    void Workers::Event::Wait(Predicate&& isDone)
+    {
+        // the waiter is registered before checking the predicate, so a notifier changing it after will bump the epoch
+        numWaiters.fetch_add(1);
+        for (;;)
+        {
+            auto currentEpoch = epoch.load();
+            if (isDone())
+                break;
+            epoch.wait(currentEpoch);
+        }
+        numWaiters.fetch_sub(1);
+    }
+
     Workers::Workers(uint32_t numThreads, uint32_t maxJobs, const wchar_t* name)
         : m_threads(new std::thread[numThreads])
         , m_numThreads(numThreads)
-        , m_jobs(maxJobs, 0)
     {
+        for (uint32_t i = 0; i <= numThreads; i++)
+            m_queues.Add(new Queue(maxJobs));
+
         wchar_t format[16] = L"%s Worker %01u";
         if (numThreads <= 10)
             ;
@@ -32,7 +130,7 @@ namespace core::thread
 
         for (uint32_t i = 0; i < numThreads; i++)
         {
-            m_threads[i] = std::thread([this]() { Run(); });
+            m_threads[i] = std::thread([this, i]() { Run(i); });
 #ifdef _WIN64
             wchar_t desc[128];
             swprintf(desc, 128, format, name, i);
@@ -44,52 +142,99 @@ namespace core::thread
     Workers::~Workers()
     {
         m_isClosing.store(true);
-        m_event.notify_all();
+        m_jobEvent.epoch.fetch_add(1);
+        m_jobEvent.epoch.notify_all();
         for (uint32_t i = 0; i < m_numThreads; i++)
             m_threads[i].join();
         delete[] m_threads;
+        for (auto* queue : m_queues)
+            delete queue;
+        for (auto* job = m_mainThreadJobs.load(); job;)
+        {
+            auto* next = job->next;
+            delete job;
+            job = next;
+        }
     }
 
-    void Workers::AddJob(const std::function<void()>& callback)
+    void Workers::AddJob(Task&& task, JobCounter* counter)
     {
-        m_mutex.lock();
+        if (counter)
+            counter->m_numJobs.fetch_add(1);
+        // counted before it can be popped, so Flush never sees it missing
+        m_numQueuedJobs.fetch_add(1);
+
+        Job job{ std::move(task), counter };
 
-        auto currentJob = m_currentJob;
-        auto freeJob = m_freeJob;
-        auto maxJobs = m_jobs.NumItems();
-        if (freeJob - currentJob == maxJobs)
+        // a worker queues in its own queue, everyone else in the shared one; when full, try the others
+        auto numQueues = m_queues.NumItems();
+        auto queueIndex = s_workerIndex < m_numThreads ? s_workerIndex : m_numThreads;
+        uint32_t i = 0;
+        while (i < numQueues && !m_queues[(queueIndex + i) % numQueues]->Push(job))
+            i++;
+        if (i == numQueues)
         {
-            m_currentJob = currentJob %= maxJobs;
-            freeJob = (freeJob % maxJobs) + maxJobs;
-            m_jobs.Resize(maxJobs * 2);
-            for (uint32_t i = 0; i < currentJob; i++)
-                m_jobs[i + maxJobs] = std::move(m_jobs[i]);
-            maxJobs *= 2;
+            // everything is full: don't block as the workers are queueing jobs too
+            ScopedSpinLock lock(m_overflowMutex);
+            m_overflowJobs.Add(std::move(job));
+            m_numOverflowJobs.fetch_add(1);
         }
-        m_jobs[freeJob % maxJobs] = { callback };
-        m_freeJob = freeJob + 1;
 
-        m_mutex.unlock();
-        m_event.notify_one();
+        m_jobEvent.NotifyOne();
+        m_doneEvent.NotifyAll(); // for the workers waiting in Wait
     }
 
-    void Workers::FromJob(const std::function<void()>& callback)
+    void Workers::FromJob(Task&& task)
     {
         assert(GetCurrentId() == thread::ID::kWorker);
         if (GetCurrentId() == thread::ID::kWorker)
         {
-            auto* job = new Job;
-            job->callback = callback;
-            auto* prev = m_mainThreadJobHead.exchange(job);
-            if (prev == nullptr)
-                m_mainThreadJobTail.store(job);
-            else
-                std::atomic_ref(prev->next).store(job);
+            auto* job = new MainThreadJob{ std::move(task), m_mainThreadJobs.load() };
+            while (!m_mainThreadJobs.compare_exchange_weak(job->next, job));
+            m_doneEvent.NotifyAll();
         }
         else
             Log::Error("OnEndJob can only be used inside a running job");
     }
 
+    void Workers::Wait(JobCounter& counter)
+    {
+        // a worker helps with the queued jobs, the ones it waits for may be behind them
+        if (s_workerIndex < m_numThreads)
+        {
+            Job job;
+            while (!counter.IsDone())
+            {
+                if (NextJob(s_workerIndex, job))
+                    RunJob(job);
+                else
+                {
+                    m_doneEvent.Wait([this, &counter]()
+                    {
+                        return counter.IsDone() || m_numQueuedJobs.load() > 0;
+                    });
+                }
+            }
+            return;
+        }
+
+        // the main thread keeps running its own jobs (outside of the wait predicate, so none is missed)
+        auto isMainThread = GetCurrentId() == ID::kMain;
+        for (;;)
+        {
+            // once done, their last main thread jobs are already queued: they are run before returning
+            auto isDone = counter.IsDone();
+            if (isMainThread)
+                while (UpdateMainThreadJobs());
+            if (isDone)
+                break;
+            m_doneEvent.Wait([this, &counter, isMainThread]()
+            {
+                return counter.IsDone() || (isMainThread && m_mainThreadJobs.load() != nullptr);
+            });
+        }
+    }
+
     void Workers::Update()
     {
         UpdateMainThreadJobs();
@@ -97,89 +242,100 @@ namespace core::thread
 
     void Workers::Flush()
     {
-        for (bool isDone = false; !isDone;)
+        for (;;)
         {
-            isDone = m_numRunningJobs.load() == 0;
-            m_mutex.lock();
-            isDone |= m_freeJob == m_currentJob;
-            m_mutex.unlock();
-            isDone |= UpdateMainThreadJobs() == false;
-            thread::Sleep(0);
+            while (UpdateMainThreadJobs());
+            if (m_numQueuedJobs.load() <= 0 && m_mainThreadJobs.load() == nullptr)
+                break;
+            m_doneEvent.Wait([this]()
+            {
+                return m_numQueuedJobs.load() <= 0 || m_mainThreadJobs.load() != nullptr;
+            });
         }
     }
 
-    void Workers::Run()
+    void Workers::Run(uint32_t workerIndex)
     {
         thread::SetCurrentId(ID::kWorker);
+        s_workerIndex = workerIndex;
+
+        Job job;
         while (!m_isClosing.load())
         {
-            // waiting jobs
-            for (Job job = WaitJob(); job.callback; job = NextJob())
+            if (NextJob(workerIndex, job))
+                RunJob(job);
+            else
             {
-                ++m_numRunningJobs;
-                job.callback();
-                --m_numRunningJobs;
+                m_jobEvent.Wait([this]()
+                {
+                    return m_numQueuedJobs.load() > 0 || m_isClosing.load();
+                });
             }
         }
     }
 
-    Workers::Job Workers::WaitJob()
+    bool Workers::NextJob(uint32_t workerIndex, Job& job)
     {
-        Job job;
-
-        std::unique_lock lk(m_mutex);
-        m_event.wait(lk);
-
-        auto currentJob = m_currentJob;
-        if (currentJob != m_freeJob)
+        // own queue first, then the shared one and finally steal from the other workers
+        if (m_queues[workerIndex]->Pop(job) || m_queues[m_numThreads]->Pop(job))
+            return true;
+        for (uint32_t i = 1; i < m_numThreads; i++)
         {
-            job = std::move(m_jobs[currentJob % m_jobs.NumItems()]);
-            m_currentJob = currentJob + 1;
+            if (m_queues[(workerIndex + i) % m_numThreads]->Pop(job))
+                return true;
         }
-
-        return job;
+        if (m_numOverflowJobs.load() > 0)
+        {
+            ScopedSpinLock lock(m_overflowMutex);
+            if (m_overflowJobs.IsNotEmpty())
+            {
+                job = std::move(m_overflowJobs[0]);
+                m_overflowJobs.RemoveAt(0);
+                m_numOverflowJobs.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
     }
 
-    Workers::Job Workers::NextJob()
+    void Workers::RunJob(Job& job)
     {
-        Job job;
+        m_numQueuedJobs.fetch_sub(1);
+        m_doneEvent.NotifyAll();
 
-        std::lock_guard<std::mutex> lk(m_mutex);
+        job.task();
+        job.task = {};
 
-        auto currentJob = m_currentJob;
-        if (currentJob != m_freeJob)
+        if (job.counter)
         {
-            job = std::move(m_jobs[currentJob % m_jobs.NumItems()]);
-            m_currentJob = currentJob + 1;
+            job.counter->m_numJobs.fetch_sub(1);
+            m_doneEvent.NotifyAll();
         }
-
-        return job;
     }
 
     bool Workers::UpdateMainThreadJobs()
     {
-        if (auto* tail = m_mainThreadJobTail.exchange(nullptr))
+        auto* jobs = m_mainThreadJobs.exchange(nullptr);
+        if (jobs == nullptr)
+            return false;
+
+        // pushed on a stack, run them in order
+        MainThreadJob* orderedJobs = nullptr;
+        while (jobs)
         {
-            auto* head = m_mainThreadJobHead.exchange(nullptr);
-            for (;;)
-            {
-                tail->callback();
-                if (tail == head)
-                {
-                    delete tail;
-                    return true;
-                }
-                auto* next = tail->next;
-                for (; next == nullptr;) // bad luck
-                {
-                    thread::Sleep(0);
-                    next = std::atomic_ref(tail->next).load();
-                }
-                delete tail;
-                tail = next;
-            }
+            auto* next = jobs->next;
+            jobs->next = orderedJobs;
+            orderedJobs = jobs;
+            jobs = next;
         }
-        return false;
+        while (orderedJobs)
+        {
+            orderedJobs->task();
+            auto* next = orderedJobs->next;
+            delete orderedJobs;
+            orderedJobs = next;
+        }
+        return true;
     }
 }
-// namespace core::thread
\ No newline at end of file
+// namespace core::thread
@@ -1,10 +1,10 @@
 #pragma once
 
 #include <Containers/Array.h>
+#include <Thread/SpinLock.h>
+#include <Thread/Task.h>
 
 #include <atomic>
-#include <functional>
-#include <mutex>
 
 namespace std
 {
@@ -14,29 +14,91 @@ namespace std
 
 namespace core::thread
 {
+    // tracks a group of jobs: Workers::Wait returns once all of them are done
+    class JobCounter
+    {
+        friend class Workers;
+    public:
+        bool IsDone() const;
+
+    private:
+        std::atomic<uint32_t> m_numJobs{ 0 };
+    };
+
     class Workers
     {
     public:
+        // each worker has its own fifo (bounded multi-producer/multi-consumer, maxJobs entries), an idle worker pops from the others' ones
         Workers(uint32_t numThreads, uint32_t maxJobs, const wchar_t* name);
         ~Workers();
 
-        void AddJob(const std::function<void()>& callback);
-        void FromJob(const std::function<void()>& callback);
+        void AddJob(Task&& task, JobCounter* counter = nullptr);
+        void FromJob(Task&& task);
+
+        // the main thread only runs its own jobs while waiting, a worker runs the queued ones (so nested waits can't starve the workers)
+        // as it may pick any job, a job which never ends (like the player update) mustn't be queued while a worker waits
+        void Wait(JobCounter& counter);
 
         void Update();
+        // wait for all the queued jobs to be started and run the main thread jobs
         void Flush();
 
+        uint32_t NumThreads() const;
+
     private:
         struct Job
         {
-            std::function<void()> callback;
-            Job* next = nullptr;
+            Task task;
+            JobCounter* counter = nullptr;
+        };
+
+        // unbounded: a worker never waits for the main thread to queue one
+        struct MainThreadJob
+        {
+            Task task;
+            MainThreadJob* next = nullptr;
+        };
+
+        // bounded multi-producer/multi-consumer queue
+        class Queue
+        {
+        public:
+            Queue(uint32_t maxJobs);
+            ~Queue();
+
+            bool Push(Job& job);
+            bool Pop(Job& job);
+
+        private:
+            struct Cell
+            {
+                std::atomic<uint32_t> sequence;
+                Job job;
+            };
+
+        private:
+            Cell* m_cells;
+            uint32_t m_mask;
+            alignas(64) std::atomic<uint32_t> m_pushPos{ 0 };
+            alignas(64) std::atomic<uint32_t> m_popPos{ 0 };
+        };
+
+        // sleep until notified, only pays for the notification when someone is waiting
+        struct Event
+        {
+            alignas(64) std::atomic<uint32_t> epoch{ 0 };
+            std::atomic<uint32_t> numWaiters{ 0 };
+
+            void NotifyOne();
+            void NotifyAll();
+            template <typename Predicate>
+            void Wait(Predicate&& isDone);
         };
 
     private:
-        void Run();
-        Job WaitJob();
-        Job NextJob();
+        void Run(uint32_t workerIndex);
+        bool NextJob(uint32_t workerIndex, Job& job);
+        void RunJob(Job& job);
 
         bool UpdateMainThreadJobs();
 
@@ -45,17 +107,26 @@ namespace core::thread
         uint32_t m_numThreads;
 
         std::atomic<bool> m_isClosing{ false };
-        std::atomic<uint16_t> m_numRunningJobs{ 0 };
-
-        std::mutex m_mutex;
-        std::condition_variable m_event;
+        alignas(64) std::atomic<int32_t> m_numQueuedJobs{ 0 };
 
-        Array<Job> m_jobs;
-        uint32_t m_currentJob = 0;
-        uint32_t m_freeJob = 0;
+        Array<Queue*> m_queues; // one per worker + the last one for the jobs added outside of the workers
+        SpinLock m_overflowMutex;
+        Array<Job> m_overflowJobs; // when all the queues are full, fifo as well
+        std::atomic<uint32_t> m_numOverflowJobs{ 0 };
+        std::atomic<MainThreadJob*> m_mainThreadJobs{ nullptr }; // lifo, reversed when they are run
 
-        std::atomic<Job*> m_mainThreadJobTail{ nullptr };
-        std::atomic<Job*> m_mainThreadJobHead{ nullptr };
+        Event m_jobEvent; // a job has been queued
+        Event m_doneEvent; // a job has been queued, started or completed, or a main thread job has been queued
     };
+
+    inline bool JobCounter::IsDone() const
+    {
+        return m_numJobs.load() == 0;
+    }
+
+    inline uint32_t Workers::NumThreads() const
+    {
+        return m_numThreads;
+    }
 }
-// namespace core::thread
\ No newline at end of file
+// namespace core::thread
@@ -28,6 +28,7 @@ namespace rePlayer
         m_numItems++;
         auto newItem = ItemType::Create(item);
         m_items[uint32_t(id)] = newItem;
+        Touch(id);
         return newItem;
     }
 
@@ -39,6 +40,7 @@ namespace rePlayer
         m_items[uint32_t(id)].Reset();
         m_availableIds.Add(id);
         m_numItems--;
+        Touch(id);
     }
 
     template <typename ItemType, typename ItemID>
@@ -58,6 +60,12 @@ namespace rePlayer
         return newItem;
     }
 
+    template <typename ItemType, typename ItemID>
+    Database::Set<ItemType, ItemID>::~Set()
+    {
+        m_items.Reset();
+    }
+
     template <typename ItemType, typename ItemID>
     Status Database::Set<ItemType, ItemID>::Load(io::File& file)
     {
@@ -65,13 +73,34 @@ namespace rePlayer
         m_items.Clear();
         m_availableIds.Clear();
 
-        auto version = m_version = file.Read<uint32_t>();
+        auto version = file.Read<uint32_t>();
+        auto isArena = version == kArenaStamp;
+        if (isArena)
+            version = file.Read<uint32_t>();
+        m_version = version;
         if (version > Core::GetVersion())
         {
             assert(0 && "file read error");
             return Status::kFail;
         }
 
+        auto status = isArena ? LoadArena(file) : LoadItems(file);
+        if (status == Status::kOk && version != Core::GetVersion())
+        {
+            for (uint32_t i = 0, n = m_items.NumItems(); i < n; i++)
+            {
+                if (m_items[i])
+                    m_items[i]->Patch(version);
+            }
+        }
+
+        return status;
+    }
+
+    template <typename ItemType, typename ItemID>
+    Status Database::Set<ItemType, ItemID>::LoadItems(io::File& file)
+    {
+        // previous format, one item after the other
         m_numItems = file.Read<uint32_t>();
 
         m_items.Add(nullptr);
@@ -88,21 +117,97 @@ namespace rePlayer
             }
             m_items.Add(item);
         }
-        if (version != Core::GetVersion())
+        return Status::kOk;
+    }
+
+    template <typename ItemType, typename ItemID>
+    Status Database::Set<ItemType, ItemID>::LoadArena(io::File& file)
+    {
+        // the blobs are used straight from the mapped file, they only become sheets when edited
+        auto numBlobs = file.Read<uint32_t>();
+        auto arenaSize = file.Read<uint32_t>();
+        auto arenaOffset = AlignUp(file.GetPosition(), kArenaAlignment);
+
+        m_numItems = 0;
+        m_items.Add(nullptr);
+        if (arenaSize > 0)
         {
-            for (uint32_t i = 0, n = m_items.NumItems(); i < n; i++)
+            if (arenaSize < sizeof(Blob::Arena) || arenaOffset + arenaSize > file.GetSize())
+                return Status::kFail;
+
+            // the pages written (refcounts, proxies) are private copies, the file is read again into memory if it can't be mapped
+            Blob::Arena* arena;
+            if (auto* view = file.Map())
             {
-                if (m_items[i])
-                    m_items[i]->Patch(version);
+                arena = reinterpret_cast<Blob::Arena*>(view + arenaOffset);
+                arena->view = view;
+            }
+            else
+            {
+                arena = reinterpret_cast<Blob::Arena*>(Alloc(arenaSize, 16));
+                file.Seek(arenaOffset);
+                file.Read(arena, arenaSize);
+                arena->view = nullptr;
             }
+            arena->numBlobs = 1;
+            arena->size = arenaSize;
+            file.Seek(arenaOffset + arenaSize);
+
+            auto status = Status::kOk;
+            for (uint32_t i = 0, offset = sizeof(Blob::Arena); i < numBlobs; i++)
+            {
+                auto* record = reinterpret_cast<Blob::ArenaRecord*>(reinterpret_cast<uint8_t*>(arena) + offset);
+                if (arenaSize - offset < sizeof(Blob::ArenaRecord) || record->size > arenaSize - offset || record->size <= sizeof(Blob::ArenaRecord))
+                {
+                    status = Status::kFail;
+                    break;
+                }
+                Blob::AddToArena(arena, reinterpret_cast<Blob*>(record + 1));
+                if (Place(reinterpret_cast<ItemType*>(record + 1)) != Status::kOk)
+                {
+                    Blob::ReleaseArena(arena); // not owned
+                    status = Status::kFail;
+                    break;
+                }
+                offset += record->size;
+            }
+            Blob::ReleaseArena(arena);
+            if (status != Status::kOk)
+                return status;
+        }
+
+        // the items not fitting in a blob
+        for (uint32_t i = 0, n = file.Read<uint32_t>(); i < n; i++)
+        {
+            if (Place(ItemType::Load(file)) != Status::kOk)
+                return Status::kFail;
         }
 
+        for (uint32_t i = 1, n = m_items.NumItems(); i < n; i++)
+        {
+            if (m_items[i].IsInvalid())
+                m_availableIds.Add(ItemID(i));
+        }
+        return Status::kOk;
+    }
+
+    template <typename ItemType, typename ItemID>
+    Status Database::Set<ItemType, ItemID>::Place(ItemType* item)
+    {
+        auto id = static_cast<uint32_t>(item->GetId());
+        if (id == 0 || (id < m_items.NumItems() && m_items[id].IsValid()))
+            return Status::kFail;
+        while (m_items.NumItems() <= id)
+            m_items.Add(nullptr);
+        m_items[id] = item;
+        m_numItems++;
         return Status::kOk;
     }
 
     template <typename ItemType, typename ItemID>
     void Database::Set<ItemType, ItemID>::Save(io::File& file)
     {
+        // the previous format, the arena is only for the library files (saved from a snapshot)
         file.Write(Core::GetVersion());
         file.WriteAs<uint32_t>(m_numItems);
         for (auto& item : m_items)
@@ -110,6 +215,175 @@ namespace rePlayer
             if (item.IsValid())
                 item->Save(file);
         }
+        ClearChanges();
+    }
+
+    template <typename ItemType, typename ItemID>
+    void Database::Set<ItemType, ItemID>::Pack(Snapshot::Packed<typename ItemType::Sheet>& packed) const
+    {
+        // pack the blobs in an arena as they are laid out in memory, the items too big for a blob are copied
+        for (auto& item : m_items)
+        {
+            if (item.IsInvalid())
+                continue;
+
+            BlobSerializer s;
+            auto data = item->Pack(s);
+            if (data.IsEmpty())
+            {
+                auto* sheet = new typename ItemType::Sheet();
+                item->CopyTo(sheet);
+                sheet->refCount = 0;
+                packed.others.Add(sheet);
+                continue;
+            }
+
+            // the arena header is filled when loaded
+            if (packed.arena.IsEmpty())
+            {
+                packed.arena.Push(uint32_t(sizeof(Blob::Arena)));
+                memset(packed.arena.Items(), 0, sizeof(Blob::Arena));
+            }
+
+            // room for the proxy when the item will be edited
+            auto blobSize = Max(sizeof(Blob) + data.Size(), sizeof(ItemType));
+            auto recordSize = AlignUp(sizeof(Blob::ArenaRecord) + blobSize, kArenaAlignment);
+            auto* record = reinterpret_cast<Blob::ArenaRecord*>(packed.arena.Push(uint32_t(recordSize)));
+            memset(record, 0, recordSize);
+            record->size = uint32_t(recordSize);
+            auto* blob = reinterpret_cast<Blob*>(record + 1);
+            blob->dataSize = uint16_t(data.Size());
+            memcpy(blob + 1, data.Items(), data.Size());
+            packed.numBlobs++;
+        }
+    }
+
+    template <typename Sheet>
+    void Database::Snapshot::Packed<Sheet>::Save(io::File& file) const
+    {
+        // same layout as Set::LoadArena, the others are saved as their proxy would be
+        file.Write(Set<Song, SongID>::kArenaStamp);
+        file.Write(Core::GetVersion());
+        file.Write(numBlobs);
+        file.WriteAs<uint32_t>(arena.NumItems());
+        static constexpr uint8_t padding[Set<Song, SongID>::kArenaAlignment] = {};
+        file.Write(padding, AlignUp(file.GetPosition(), Set<Song, SongID>::kArenaAlignment) - file.GetPosition());
+        file.Write(arena.Items(), arena.Size());
+        file.WriteAs<uint32_t>(others.NumItems());
+        for (auto& sheet : others)
+        {
+            file.WriteAs<uint16_t>(0);
+            sheet->Save(file);
+        }
+    }
+
+    template struct Database::Snapshot::Packed<SongSheet>;
+    template struct Database::Snapshot::Packed<ArtistSheet>;
+
+    template <typename ItemType, typename ItemID>
+    void Database::Set<ItemType, ItemID>::Touch(ItemID id)
+    {
+        thread::ScopedSpinLock lock(m_changesSpinLock);
+        auto index = uint32_t(id);
+        if (index >= m_isChanged.NumItems())
+            m_isChanged.Add(false, index + 1 - m_isChanged.NumItems());
+        if (!m_isChanged[index])
+        {
+            m_isChanged[index] = true;
+            m_changedIds.Add(id);
+        }
+    }
+
+    template <typename ItemType, typename ItemID>
+    Array<ItemID> Database::Set<ItemType, ItemID>::FetchChanges()
+    {
+        Array<ItemID> changedIds;
+        thread::ScopedSpinLock lock(m_changesSpinLock);
+        changedIds.Swap(m_changedIds);
+        for (auto id : changedIds)
+            m_isChanged[uint32_t(id)] = false;
+        return changedIds;
+    }
+
+    template <typename ItemType, typename ItemID>
+    uint32_t Database::Set<ItemType, ItemID>::NumChanges()
+    {
+        thread::ScopedSpinLock lock(m_changesSpinLock);
+        return m_changedIds.NumItems();
+    }
+
+    template <typename ItemType, typename ItemID>
+    void Database::Set<ItemType, ItemID>::ClearChanges()
+    {
+        FetchChanges();
+    }
+
+    template <typename ItemType, typename ItemID>
+    Status Database::Set<ItemType, ItemID>::LoadJournal(io::File& file, uint32_t version)
+    {
+        // a record is the whole item, so the last one wins and replaying a record twice is harmless
+        m_revision++;
+        for (uint32_t i = 0, n = file.Read<uint32_t>(); i < n; i++)
+        {
+            auto index = file.Read<uint32_t>();
+            auto op = file.Read<uint8_t>();
+            if (index == 0)
+                return Status::kFail;
+            if (op == kUpdate)
+            {
+                SmartPtr<ItemType> item = ItemType::Load(file);
+                if (uint32_t(item->GetId()) != index)
+                    return Status::kFail;
+                if (version != Core::GetVersion())
+                    item->Patch(version);
+                while (m_items.NumItems() <= index)
+                    m_items.Add(nullptr);
+                if (m_items[index].IsInvalid())
+                    m_numItems++;
+                m_items[index] = item;
+            }
+            else if (op == kRemove)
+            {
+                if (index < m_items.NumItems() && m_items[index].IsValid())
+                {
+                    m_items[index].Reset();
+                    m_numItems--;
+                }
+            }
+            else
+                return Status::kFail;
+        }
+        return Status::kOk;
+    }
+
+    template <typename ItemType, typename ItemID>
+    void Database::Set<ItemType, ItemID>::SaveJournal(io::File& file)
+    {
+        auto changedIds = FetchChanges();
+        file.WriteAs<uint32_t>(changedIds.NumItems());
+        for (auto id : changedIds)
+        {
+            auto index = uint32_t(id);
+            file.Write(index);
+            if (index < m_items.NumItems() && m_items[index].IsValid())
+            {
+                file.WriteAs<uint8_t>(kUpdate);
+                m_items[index]->Save(file);
+            }
+            else
+                file.WriteAs<uint8_t>(kRemove);
+        }
+    }
+
+    template <typename ItemType, typename ItemID>
+    void Database::Set<ItemType, ItemID>::RebuildAvailableIds()
+    {
+        m_availableIds.Clear();
+        for (uint32_t i = 1, n = m_items.NumItems(); i < n; i++)
+        {
+            if (m_items[i].IsInvalid())
+                m_availableIds.Add(ItemID(i));
+        }
     }
 
     template <typename ItemType, typename ItemID>
@@ -119,6 +393,7 @@ namespace rePlayer
         m_items.Add(nullptr);
         m_availableIds.Reset();
         m_numItems = 0;
+        ClearChanges();
     }
 
     bool Database::Flag::IsEnabled(Flag flags) const
@@ -139,6 +414,7 @@ namespace rePlayer
         m_songs.Reset();
         m_artists.Reset();
         m_flags = Flag::kNone;
+        RebuildFileIndex();
     }
 
     std::string Database::GetTitle(SongID songId, int32_t subsongIndex) const
@@ -196,7 +472,9 @@ namespace rePlayer
         if (m_numFreeze == 0)
         {
             assert(thread::GetCurrentId() == thread::ID::kMain);
-            return m_songs.Add(song);
+            auto* newSong = m_songs.Add(song);
+            UpdateFileIndex(newSong);
+            return newSong;
         }
         auto* command = new Command;
         command->type = Command::kAddSong;
@@ -210,6 +488,7 @@ namespace rePlayer
         if (m_numFreeze == 0)
         {
             assert(thread::GetCurrentId() == thread::ID::kMain);
+            RemoveFromFileIndex(songId);
             return m_songs.Remove(songId);
         }
         auto* command = new Command;
@@ -259,7 +538,9 @@ namespace rePlayer
 
     Status Database::LoadSongs(io::File& file)
     {
-        return m_songs.Load(file);
+        auto status = m_songs.Load(file);
+        RebuildFileIndex();
+        return status;
     }
 
     void Database::SaveSongs(io::File& file)
@@ -277,6 +558,71 @@ namespace rePlayer
         m_artists.Save(file);
     }
 
+    template <typename ItemID>
+    void Database::Touch(ItemID id)
+    {
+        if constexpr (std::is_same<ItemID, SongID>::value)
+            m_songs.Touch(id);
+        else
+            m_artists.Touch(id);
+    }
+
+    template void Database::Touch(SongID id);
+    template void Database::Touch(ArtistID id);
+
+    Status Database::LoadJournal(io::File& file)
+    {
+        auto status = Status::kOk;
+        auto fileSize = file.GetSize();
+        for (auto offset = file.GetPosition(); fileSize - offset >= sizeof(JournalBatch);)
+        {
+            auto batch = file.Read<JournalBatch>();
+            if (batch.stamp != kJournalStamp || batch.size == 0 || batch.size > fileSize - offset - sizeof(JournalBatch) || batch.version > Core::GetVersion())
+                break; // not committed
+
+            if (m_songs.LoadJournal(file, batch.version) != Status::kOk || m_artists.LoadJournal(file, batch.version) != Status::kOk)
+            {
+                status = Status::kFail;
+                break;
+            }
+            offset += sizeof(JournalBatch) + batch.size;
+            file.Seek(offset);
+        }
+
+        m_songs.RebuildAvailableIds();
+        m_artists.RebuildAvailableIds();
+        RebuildFileIndex();
+        return status;
+    }
+
+    void Database::SaveJournal(io::File& file)
+    {
+        assert(thread::GetCurrentId() == thread::ID::kMain);
+        if (m_songs.NumChanges() == 0 && m_artists.NumChanges() == 0)
+            return;
+
+        auto offset = file.GetPosition();
+        JournalBatch batch;
+        batch.version = Core::GetVersion();
+        batch.size = 0;
+        file.Write(batch);
+        m_songs.SaveJournal(file);
+        m_artists.SaveJournal(file);
+
+        auto endOffset = file.GetPosition();
+        batch.size = uint32_t(endOffset - offset - sizeof(JournalBatch));
+        file.Seek(offset);
+        file.Write(batch);
+        file.Seek(endOffset);
+    }
+
+    void Database::TakeSnapshot(Snapshot& snapshot) const
+    {
+        assert(thread::GetCurrentId() == thread::ID::kMain);
+        m_songs.Pack(snapshot.songs);
+        m_artists.Pack(snapshot.artists);
+    }
+
     void Database::Raise(Flag flags)
     {
         if (flags.IsEnabled(Flag::kSaveArtists))
@@ -335,13 +681,17 @@ namespace rePlayer
                     case Command::kAddSong:
                         m_songs.m_items[uint32_t(commands->song->GetId())].Attach(commands->song);
                         m_songs.m_numItems++;
+                        m_songs.Touch(commands->song->GetId());
+                        UpdateFileIndex(commands->song);
                         break;
                     case Command::kRemoveSong:
+                        RemoveFromFileIndex(commands->songId);
                         m_songs.Remove(commands->songId);
                         break;
                     case Command::kAddArtist:
                         m_artists.m_items[uint32_t(commands->artist->GetId())].Attach(commands->artist);
                         m_artists.m_numItems++;
+                        m_artists.Touch(commands->artist->GetId());
                         break;
                     case Command::kRemoveArtist:
                         m_artists.Remove(commands->artistId);
@@ -355,6 +705,71 @@ namespace rePlayer
         }
     }
 
+    void Database::UpdateFileIndex(Song* song)
+    {
+        thread::ScopedSpinLock lock(m_fileIndexMutex);
+
+        auto songIndex = uint32_t(song->GetId());
+        if (songIndex >= m_fileIndexKeys.NumItems())
+        {
+            auto numItems = songIndex + 1 - m_fileIndexKeys.NumItems();
+            m_fileIndexKeys.Add(0ull, numItems);
+            m_fileIndexNext.Add(SongID::Invalid, numItems);
+        }
+
+        auto key = FileKey(song->GetFileSize(), song->GetFileCrc());
+        if (m_fileIndexKeys[songIndex] == key)
+            return;
+
+        RemoveFromFileIndex(song->GetId());
+        if (key != 0)
+        {
+            auto& firstSongId = m_fileIndex[key];
+            m_fileIndexNext[songIndex] = firstSongId;
+            firstSongId = song->GetId();
+            m_fileIndexKeys[songIndex] = key;
+        }
+    }
+
+    void Database::RemoveFromFileIndex(SongID songId)
+    {
+        thread::ScopedSpinLock lock(m_fileIndexMutex);
+
+        auto songIndex = uint32_t(songId);
+        if (songIndex >= m_fileIndexKeys.NumItems() || m_fileIndexKeys[songIndex] == 0)
+            return;
+
+        auto key = m_fileIndexKeys[songIndex];
+        auto* firstSongId = m_fileIndex.FindItemByKey(key);
+        if (*firstSongId == songId)
+        {
+            if (m_fileIndexNext[songIndex] == SongID::Invalid)
+                m_fileIndex.RemoveByKey(key);
+            else
+                *firstSongId = m_fileIndexNext[songIndex];
+        }
+        else
+        {
+            auto prevSongId = *firstSongId;
+            while (m_fileIndexNext[uint32_t(prevSongId)] != songId)
+                prevSongId = m_fileIndexNext[uint32_t(prevSongId)];
+            m_fileIndexNext[uint32_t(prevSongId)] = m_fileIndexNext[songIndex];
+        }
+        m_fileIndexKeys[songIndex] = 0;
+        m_fileIndexNext[songIndex] = SongID::Invalid;
+    }
+
+    void Database::RebuildFileIndex()
+    {
+        thread::ScopedSpinLock lock(m_fileIndexMutex);
+
+        m_fileIndex.RemoveAll();
+        m_fileIndexKeys.Clear();
+        m_fileIndexNext.Clear();
+        for (auto* song : m_songs.Items())
+            UpdateFileIndex(song);
+    }
+
     void Database::DeleteInternal(Song* song, const char* logId) const
     {
         UnusedArg(song, logId);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Containers/Array.h>
+#include <Containers/HashMap.h>
 #include <Containers/SmartPtr.h>
 #include <Thread/SpinLock.h>
 
@@ -60,6 +61,10 @@ namespace rePlayer
         void RemoveSong(SongID songId);
         template <typename Predicate>
         Song* FindSong(Predicate&& predicate) const;
+        // songs sharing the same file (size and crc) through the file index
+        template <typename Predicate>
+        Song* FindSong(uint32_t fileSize, uint32_t fileCrc, Predicate&& predicate) const;
+        void UpdateFileIndex(Song* song);
 
         void DeleteSubsong(SubsongID subsongId, bool isSilent = false);
         bool HasDeletedSubsongs(SongID songId) const;
@@ -75,6 +80,30 @@ namespace rePlayer
         Status LoadArtists(io::File& file);
         void SaveArtists(io::File& file);
 
+        // journal: the items added, edited or removed since the last save are appended as batches of records
+        template <typename ItemID>
+        void Touch(ItemID id);
+        Status LoadJournal(io::File& file);
+        void SaveJournal(io::File& file);
+
+        // copy of the sets taken on the main thread, so they can be saved from a job while the database keeps changing
+        struct Snapshot
+        {
+            template <typename Sheet>
+            struct Packed
+            {
+                Array<uint8_t> arena;
+                Array<SmartPtr<Sheet>> others; // copies of the items not fitting in a blob
+                uint32_t numBlobs = 0;
+
+                void Save(io::File& file) const;
+            };
+
+            Packed<SongSheet> songs;
+            Packed<ArtistSheet> artists;
+        };
+        void TakeSnapshot(Snapshot& snapshot) const;
+
         struct Flag
         {
             enum eFlag : uint32_t
@@ -126,6 +155,8 @@ namespace rePlayer
         {
             struct Iterator;
 
+            ~Set();
+
             Iterator Items() const;
 
             template <typename OtherItemType>
@@ -137,9 +168,32 @@ namespace rePlayer
 
             Status Load(io::File& file);
             void Save(io::File& file);
+            void Pack(Snapshot::Packed<typename ItemType::Sheet>& packed) const;
 
             void Reset();
 
+            // library files only: the blobs are saved as they are in memory, so the file is mapped and they are used in place
+            static constexpr uint32_t kArenaStamp = 0xffFFff01;
+            static constexpr uint32_t kArenaAlignment = 8;
+
+            Status LoadItems(io::File& file);
+            Status LoadArena(io::File& file);
+            Status Place(ItemType* item);
+
+            enum JournalOp : uint8_t
+            {
+                kUpdate, // or add
+                kRemove
+            };
+
+            void Touch(ItemID id);
+            Array<ItemID> FetchChanges();
+            uint32_t NumChanges();
+            void ClearChanges();
+            Status LoadJournal(io::File& file, uint32_t version);
+            void SaveJournal(io::File& file);
+            void RebuildAvailableIds();
+
             Array<SmartPtr<ItemType>> m_items;
             Array<ItemID> m_availableIds;
             uint32_t m_numItems = 0;
@@ -147,8 +201,24 @@ namespace rePlayer
             uint32_t m_frozenIndex = 0;
             uint32_t m_version = 0;
             thread::SpinLock m_spinLock;
+            Array<ItemID> m_changedIds;
+            Array<bool> m_isChanged; // indexed by id
+            thread::SpinLock m_changesSpinLock; // items are also edited by the jobs
         };
 
+        // a batch is committed by its size, written last: a crash while appending leaves it empty and it is ignored
+        static constexpr uint32_t kJournalStamp = 0xffFFff02;
+        struct JournalBatch
+        {
+            uint32_t stamp = kJournalStamp;
+            uint32_t version;
+            uint32_t size; // of the records following this header
+        };
+
+        static uint64_t FileKey(uint32_t fileSize, uint32_t fileCrc);
+        void RemoveFromFileIndex(SongID songId);
+        void RebuildFileIndex();
+
         struct Command
         {
             enum Type
@@ -179,6 +249,12 @@ namespace rePlayer
         Command m_commandTail;
         Command* m_commandHead = &m_commandTail;
 
+        // (file size, file crc) -> first song, the others are chained through m_fileIndexNext (indexed by song id)
+        HashMap<uint64_t, SongID> m_fileIndex;
+        Array<SongID> m_fileIndexNext;
+        Array<uint64_t> m_fileIndexKeys;
+        mutable thread::SpinLock m_fileIndexMutex;
+
     protected:
         Array<SubsongID> m_deletedSubsongs;
     };
@@ -160,6 +160,32 @@ namespace rePlayer
         return nullptr;
     }
 
+    template <typename Predicate>
+    inline Song* Database::FindSong(uint32_t fileSize, uint32_t fileCrc, Predicate&& predicate) const
+    {
+        auto key = FileKey(fileSize, fileCrc);
+        if (key == 0)
+            return nullptr;
+        thread::ScopedSpinLock lock(m_fileIndexMutex);
+        if (auto* firstSongId = m_fileIndex.FindItemByKey(key))
+        {
+            for (auto songId = *firstSongId; songId != SongID::Invalid; songId = m_fileIndexNext[uint32_t(songId)])
+            {
+                // the file may have changed since it has been indexed
+                auto* song = m_songs.m_items[uint32_t(songId)].Get();
+                if (song && song->GetFileSize() == fileSize && song->GetFileCrc() == fileCrc && std::forward<Predicate>(predicate)(song))
+                    return song;
+            }
+        }
+        return nullptr;
+    }
+
+    inline uint64_t Database::FileKey(uint32_t fileSize, uint32_t fileCrc)
+    {
+        // no file, no key
+        return fileSize ? (uint64_t(fileSize) << 32) | fileCrc : 0;
+    }
+
     inline void Database::DeleteSubsong(SubsongID subsongId, bool isSilent)
     {
         subsongId.external = isSilent;
@@ -178,7 +204,10 @@ namespace rePlayer
     inline void Database::Reconcile(ItemID id, ItemType* item)
     {
         if constexpr (std::is_same<ItemID, SongID>::value)
+        {
             m_songs.m_items[uint32_t(id)] = item;
+            UpdateFileIndex(item);
+        }
         else
             m_artists.m_items[uint32_t(id)] = item;
     }
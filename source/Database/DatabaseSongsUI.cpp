@@ -40,6 +40,27 @@ namespace rePlayer
         return DatabaseSongsUI::FilterFlagType(a) & DatabaseSongsUI::FilterFlagType(b);
     }
 
+    // ascii only, as ImGuiTextFilter
+    static inline char ToLower(char c)
+    {
+        return c >= 'A' && c <= 'Z' ? c + 'a' - 'A' : c;
+    }
+
+    static bool Contains(const char* text, const char* textEnd, const char* word, uint32_t length)
+    {
+        if (textEnd - text < int64_t(length))
+            return false;
+        for (auto* lastText = textEnd - length; text <= lastText; text++)
+        {
+            text = static_cast<const char*>(memchr(text, word[0], lastText - text + 1));
+            if (text == nullptr)
+                return false;
+            if (memcmp(text + 1, word + 1, length - 1) == 0)
+                return true;
+        }
+        return false;
+    }
+
     DatabaseSongsUI::DatabaseSongsUI(DatabaseID databaseId, Window& owner, bool isScrollingEnabled, uint16_t defaultHiddenColumns, const char* header)
         : m_db(Core::GetDatabase(databaseId))
         , m_owner(owner)
@@ -187,9 +208,11 @@ namespace rePlayer
 
     void DatabaseSongsUI::DisplaySongsFilter(bool& isDirty)
     {
+        // dirty before the filters ui means the entries have to be gathered again
+        auto isRefreshed = isDirty;
         DisplaySongsFilterUI(isDirty);
         if (isDirty)
-            FilterSongs();
+            FilterSongs(isRefreshed);
     }
 
     void DatabaseSongsUI::DisplaySongsTable(bool& isDirty)
@@ -630,31 +653,39 @@ namespace rePlayer
         ImGui::SetNextWindowPos(ImGui::GetMousePos(), ImGuiCond_Appearing);
         if (ImGui::BeginPopupModal("ExportAsWav", nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings))
         {
-            float progress;
-            uint32_t duration;
-            auto songIndex = m_export->GetStatus(progress, duration);
-            MusicID musicId = m_export->GetMusicId(songIndex);
-
-            ImGui::BeginChild("Labels", ImVec2(320.0f, ImGui::GetFrameHeight() * 3 + ImGui::GetFrameHeightWithSpacing()), ImGuiChildFlags_None, ImGuiWindowFlags_NoSavedSettings);
-            ImGui::Text("ID     : %016llX%c", musicId.subsongId.Value(), musicId.databaseId == DatabaseID::kPlaylist ? 'p' : 'l');
-            ImGui::Text("Title  : %s", musicId.GetTitle().c_str());
-            ImGui::Text(musicId.GetSong()->NumArtistIds() > 1 ? "Artists: %s" : "Artist : %s", musicId.GetArtists().c_str());
-            ImGui::Text("Replay : %s", musicId.GetSong()->GetType().GetReplay());
-            ImGui::EndChild();
+            for (uint32_t jobIndex = 0, numJobs = m_export->NumJobs(); jobIndex < numJobs; jobIndex++)
             {
-                auto numSongs = m_export->NumSongs();
-                char buf[32];
-                sprintf(buf, "Song %u/%u", songIndex + 1, numSongs);
-                ImGui::ProgressBar((songIndex + 1.0f) / numSongs, ImVec2(-FLT_MIN, 0), buf);
+                float progress;
+                uint32_t duration;
+                auto songIndex = m_export->GetStatus(jobIndex, progress, duration);
+                if (songIndex == Export::kNoEntry)
+                    continue;
+                MusicID musicId = m_export->GetMusicId(songIndex);
+
+                ImGui::PushID(jobIndex);
+                ImGui::BeginChild("Labels", ImVec2(320.0f, ImGui::GetFrameHeight() * 3 + ImGui::GetFrameHeightWithSpacing()), ImGuiChildFlags_None, ImGuiWindowFlags_NoSavedSettings);
+                ImGui::Text("ID     : %016llX%c", musicId.subsongId.Value(), musicId.databaseId == DatabaseID::kPlaylist ? 'p' : 'l');
+                ImGui::Text("Title  : %s", musicId.GetTitle().c_str());
+                ImGui::Text(musicId.GetSong()->NumArtistIds() > 1 ? "Artists: %s" : "Artist : %s", musicId.GetArtists().c_str());
+                ImGui::Text("Replay : %s", musicId.GetSong()->GetType().GetReplay());
+                ImGui::EndChild();
+                if (duration != 0xffFFffFF)
+                {
+                    char buf[32];
+                    sprintf(buf, "%u:%02u", uint32_t(duration / 60), uint32_t(duration % 60));
+                    ImGui::ProgressBar(progress, ImVec2(-FLT_MIN, 0), buf);
+                }
+                else
+                    ImGui::ProgressBar(1.0f, ImVec2(-FLT_MIN, 0), "Writing WAV");
+                ImGui::PopID();
             }
-            if (duration != 0xffFFffFF)
             {
+                auto numDoneSongs = m_export->NumDoneSongs();
+                auto numSongs = m_export->NumSongs();
                 char buf[32];
-                sprintf(buf, "%u:%02u", uint32_t(duration / 60), uint32_t(duration % 60));
-                ImGui::ProgressBar(progress, ImVec2(-FLT_MIN, 0), buf);
+                sprintf(buf, "Song %u/%u", numDoneSongs, numSongs);
+                ImGui::ProgressBar(float(numDoneSongs) / numSongs, ImVec2(-FLT_MIN, 0), buf);
             }
-            else
-                ImGui::ProgressBar(1.0f, ImVec2(-FLT_MIN, 0), "Writing WAV");
 
             if (ImGui::Button("Cancel", ImVec2(-FLT_MIN, 0.0f)))
                 m_export->Cancel();
@@ -671,95 +702,239 @@ namespace rePlayer
         }
     }
 
-    void DatabaseSongsUI::FilterSongs()
+    void DatabaseSongsUI::FilterSongs(bool isRefreshed)
     {
-        // prepare selection
+        SearchFilters searchFilters;
+        BuildSearchFilters(searchFilters);
+
+        // the search text is valid for one revision of the database
+        if (m_searchRevision != m_db.SongsRevision())
+        {
+            m_searchRevision = m_db.SongsRevision();
+            m_searchStamp++;
+            m_searchSubsongs.Clear();
+            m_searchText.Clear();
+        }
+
         m_numSelectedEntries = 0;
-        auto oldEntries = std::move(m_entries);
-        for (int64_t oldEntryIndex = 0, numOldEntries = oldEntries.NumItems<int64_t>(); oldEntryIndex < numOldEntries;)
+        uint32_t numEntries = 0;
+        if (!isRefreshed && IsNarrowing(searchFilters))
         {
-            if (!oldEntries[oldEntryIndex].IsSelected())
+            // typing more characters: only the current entries can pass (order and selection are kept)
+            for (auto& entry : m_entries)
             {
-                oldEntries.RemoveAtFast(oldEntryIndex);
-                --numOldEntries;
+                if (PassSearch(searchFilters, entry))
+                {
+                    m_numSelectedEntries += entry.IsSelected();
+                    m_entries[numEntries++] = entry;
+                }
             }
-            else
-                ++oldEntryIndex;
+            m_entries.Resize(numEntries);
+        }
+        else
+        {
+            // prepare selection
+            for (auto& entry : m_entries)
+            {
+                if (entry.IsSelected())
+                    m_selectedSubsongs[entry] = true;
+            }
+            // filter entries and assign the selection
+            Array<SubsongEntry> entries = GatherEntries();
+            for (auto& entry : entries)
+            {
+                if (PassSearch(searchFilters, entry))
+                {
+                    auto isSelected = m_selectedSubsongs.NumItems() > 0 && m_selectedSubsongs.RemoveByKey(entry);
+                    entry.Select(isSelected);
+                    m_numSelectedEntries += isSelected;
+                    entries[numEntries++] = entry;
+                }
+            }
+            m_selectedSubsongs.RemoveAll();
+            m_entries = std::move(entries.Resize(numEntries).Refit());
         }
-        // filter entries
-        Array<SubsongEntry> entries = GatherEntries();
-        std::string textToFilter;
+
+        searchFilters.revision = m_db.SongsRevision();
+        searchFilters.isValid = true;
+        m_searchFilters = std::move(searchFilters);
+    }
+
+    void DatabaseSongsUI::BuildSearchFilters(SearchFilters& searchFilters) const
+    {
         for (auto& filter : m_filters)
         {
             if (!filter.ui->IsActive())
                 continue;
-            auto flags = filter.flags;
 
-            auto updateTextToFilter = [&textToFilter](const char* text)
+            SearchFilters::Query query = { .flags = filter.flags, .id = filter.id, .words = searchFilters.words.NumItems(), .numWords = 0, .numIncluded = 0 };
+            for (auto& range : filter.ui->Filters)
             {
-                if (!textToFilter.empty())
-                    textToFilter += '\n';
-                textToFilter += text;
-            };
+                auto* c = range.b;
+                bool isExcluded = c != range.e && *c == '-';
+                c += isExcluded;
+                if (c == range.e) // empty words never match anything
+                    continue;
+
+                searchFilters.words.Add({ .offset = searchFilters.chars.NumItems(), .isExcluded = isExcluded, .length = uint32_t(range.e - c) });
+                for (; c < range.e; c++)
+                    searchFilters.chars.Add(ToLower(*c));
+                query.numWords++;
+                query.numIncluded += !isExcluded;
+            }
+            searchFilters.queries.Add(query);
+        }
+    }
 
-            for (int64_t entryIndex = 0, numEntries = entries.NumItems<int64_t>(); entryIndex < numEntries; ++entryIndex)
+    bool DatabaseSongsUI::IsNarrowing(const SearchFilters& searchFilters) const
+    {
+        // the words of the applied filters must be kept or made longer and only exclusions can be added
+        if (!m_searchFilters.isValid || m_searchFilters.revision != m_db.SongsRevision())
+            return false;
+        for (auto& oldQuery : m_searchFilters.queries)
+        {
+            auto* query = searchFilters.queries.FindIf([&oldQuery](auto& query)
             {
-                auto* song = m_db[entries[entryIndex]];
-                textToFilter.clear();
-                if (flags && FilterFlag::kSongTitle)
-                    updateTextToFilter(song->GetName());
-                if (flags && FilterFlag::kArtistHandle)
-                    for (auto artistId : song->ArtistIds())
-                        updateTextToFilter(m_db[artistId]->GetHandle());
-                if (flags && FilterFlag::kSubongTitle)
-                    updateTextToFilter(song->GetSubsongName(entries[entryIndex].index));
-                if (flags && FilterFlag::kArtistName)
-                    for (auto artistId : song->ArtistIds())
-                        updateTextToFilter(m_db[artistId]->GetRealName());
-                if (flags && FilterFlag::kArtistAlias)
-                    for (auto artistId : song->ArtistIds())
-                        for (uint16_t i = 1, numHandles = m_db[artistId]->NumHandles(); i < numHandles; i++)
-                            updateTextToFilter(m_db[artistId]->GetHandle(i));
-                if (flags && FilterFlag::kArtistCountry)
-                    for (auto artistId : song->ArtistIds())
-                        for (uint16_t i = 0, numCountries = m_db[artistId]->NumCountries(); i < numCountries; i++)
-                            updateTextToFilter(Countries::GetName(m_db[artistId]->GetCountry(i)));
-                if (flags && FilterFlag::kArtistGroup)
-                    for (auto artistId : song->ArtistIds())
-                        for (uint16_t i = 0, numGroups = m_db[artistId]->NumGroups(); i < numGroups; i++)
-                            updateTextToFilter(m_db[artistId]->GetGroup(i));
-                if (flags && FilterFlag::kSongTag)
-                    updateTextToFilter(song->GetTags().ToString().c_str());
-                if (flags && FilterFlag::kSongType)
-                    updateTextToFilter(song->GetType().GetExtension());
-                if (flags && FilterFlag::kReplay)
-                    updateTextToFilter(song->GetType().GetReplay());
-                if (flags && FilterFlag::kSource)
-                    for (auto sourceId : song->SourceIds())
-                        updateTextToFilter(SourceID::sourceNames[sourceId.sourceId]);
-
-                if (!filter.ui->PassFilter(textToFilter.c_str(), textToFilter.c_str() + textToFilter.size()))
+                return query.id == oldQuery.id;
+            });
+            if (query == nullptr || query->flags != oldQuery.flags || query->numWords < oldQuery.numWords)
+                return false;
+            for (uint32_t i = 0; i < query->numWords; i++)
+            {
+                auto& word = searchFilters.words[query->words + i];
+                auto* chars = searchFilters.chars.Items(word.offset);
+                if (i >= oldQuery.numWords)
                 {
-                    entries.RemoveAtFast(entryIndex--);
-                    --numEntries;
+                    if (!word.isExcluded)
+                        return false;
+                    continue;
                 }
+                auto& oldWord = m_searchFilters.words[oldQuery.words + i];
+                auto* oldChars = m_searchFilters.chars.Items(oldWord.offset);
+                if (word.isExcluded != oldWord.isExcluded)
+                    return false;
+                if (word.isExcluded)
+                {
+                    if (word.length != oldWord.length || memcmp(chars, oldChars, word.length) != 0)
+                        return false;
+                }
+                else if (!Contains(chars, chars + word.length, oldChars, oldWord.length))
+                    return false;
             }
         }
-        // assign the selection
-        for (int64_t entryIndex = 0, numEntries = entries.NumItems<int64_t>(); entryIndex < numEntries; ++entryIndex)
+        return true;
+    }
+
+    bool DatabaseSongsUI::PassSearch(const SearchFilters& searchFilters, SubsongID subsongId)
+    {
+        if (searchFilters.queries.IsEmpty())
+            return true;
+
+        auto& searchSong = GetSearchSong(m_db[subsongId]);
+        auto* text = m_searchText.Items();
+        for (auto& query : searchFilters.queries)
         {
-            for (int64_t oldEntryIndex = 0, numOldEntries = oldEntries.NumItems<int64_t>(); oldEntryIndex < numOldEntries; ++oldEntryIndex)
+            // same rules as ImGuiTextFilter::PassFilter: the first word found decides
+            bool isPassing = query.numIncluded == 0;
+            for (uint32_t i = 0; i < query.numWords; i++)
             {
-                if (oldEntries[oldEntryIndex] == entries[entryIndex])
+                auto& word = searchFilters.words[query.words + i];
+                auto* chars = searchFilters.chars.Items(word.offset);
+                bool isFound = false;
+                for (auto flags = FilterFlagType(query.flags); flags && !isFound; flags &= flags - 1)
                 {
-                    entries[entryIndex].Select(true);
-                    oldEntries.RemoveAtFast(oldEntryIndex);
-                    m_numSelectedEntries++;
+                    auto field = std::countr_zero(flags);
+                    if (FilterFlag(FilterFlagType(1) << field) == FilterFlag::kSubongTitle)
+                    {
+                        auto* subsongs = m_searchSubsongs.Items(searchSong.subsongs + subsongId.index);
+                        isFound = Contains(text + subsongs[0], text + subsongs[1], chars, word.length);
+                    }
+                    else
+                        isFound = Contains(text + searchSong.fields[field], text + searchSong.fields[field + 1], chars, word.length);
+                }
+                if (isFound)
+                {
+                    isPassing = !word.isExcluded;
                     break;
                 }
             }
+            if (!isPassing)
+                return false;
         }
-        m_entries = std::move(entries.Refit());
+        return true;
+    }
+
+    const DatabaseSongsUI::SearchSong& DatabaseSongsUI::GetSearchSong(Song* song)
+    {
+        auto songIndex = uint32_t(song->GetId());
+        if (songIndex >= m_searchSongs.NumItems())
+            m_searchSongs.Add(SearchSong(), songIndex + 1 - m_searchSongs.NumItems());
+        auto& searchSong = m_searchSongs[songIndex];
+        if (searchSong.stamp == m_searchStamp)
+            return searchSong;
+        searchSong.stamp = m_searchStamp;
+
+        auto addText = [this](const char* text)
+        {
+            auto length = uint32_t(strlen(text));
+            auto* chars = m_searchText.Push(length + 1);
+            for (uint32_t i = 0; i < length; i++)
+                chars[i] = ToLower(text[i]);
+            chars[length] = '\n';
+        };
+        uint32_t fieldIndex = 0;
+        auto nextField = [&]()
+        {
+            searchSong.fields[fieldIndex++] = m_searchText.NumItems();
+        };
+
+        // same order as the FilterFlag bits
+        nextField(); // kSongTitle
+        addText(song->GetName());
+        nextField(); // kArtistHandle
+        for (auto artistId : song->ArtistIds())
+            addText(m_db[artistId]->GetHandle());
+        nextField(); // kSubongTitle
+        searchSong.subsongs = m_searchSubsongs.NumItems();
+        for (uint16_t i = 0, lastSubsongIndex = song->GetLastSubsongIndex(); i <= lastSubsongIndex; i++)
+        {
+            m_searchSubsongs.Add(m_searchText.NumItems());
+            addText(song->GetSubsongName(i));
+        }
+        m_searchSubsongs.Add(m_searchText.NumItems());
+        nextField(); // kArtistName
+        for (auto artistId : song->ArtistIds())
+            addText(m_db[artistId]->GetRealName());
+        nextField(); // kArtistAlias
+        for (auto artistId : song->ArtistIds())
+            for (uint16_t i = 1, numHandles = m_db[artistId]->NumHandles(); i < numHandles; i++)
+                addText(m_db[artistId]->GetHandle(i));
+        nextField(); // kArtistCountry
+        for (auto artistId : song->ArtistIds())
+            for (uint16_t i = 0, numCountries = m_db[artistId]->NumCountries(); i < numCountries; i++)
+                addText(Countries::GetName(m_db[artistId]->GetCountry(i)));
+        nextField(); // kArtistGroup
+        for (auto artistId : song->ArtistIds())
+            for (uint16_t i = 0, numGroups = m_db[artistId]->NumGroups(); i < numGroups; i++)
+                addText(m_db[artistId]->GetGroup(i));
+        nextField(); // kSongTag
+        auto tags = song->GetTags();
+        for (uint32_t i = 0; i < Tag::kNumTags; i++)
+        {
+            if (tags.IsEnabled(Tag(1ull << i)))
+                addText(Tag::Name(i));
+        }
+        nextField(); // kSongType
+        addText(song->GetType().GetExtension());
+        nextField(); // kReplay
+        addText(song->GetType().GetReplay());
+        nextField(); // kSource
+        for (auto sourceId : song->SourceIds())
+            addText(SourceID::sourceNames[sourceId.sourceId]);
+        nextField(); // end
+        assert(fieldIndex == kNumFilterFlags + 1);
+
+        return searchSong;
     }
 
     void DatabaseSongsUI::SortSubsongs(bool isDirty)
@@ -767,10 +942,16 @@ namespace rePlayer
         auto* sortsSpecs = ImGui::TableGetSortSpecs();
         if (sortsSpecs && (sortsSpecs->SpecsDirty || isDirty) && m_entries.NumItems() > 1)
         {
-            std::sort(m_entries.begin(), m_entries.end(), [this, sortsSpecs](auto& l, auto& r)
+            BuildSortKeys(sortsSpecs);
+
+            // sort the flat keys, then reorder the entries
+            Array<uint32_t> order(m_entries.NumItems());
+            for (uint32_t i = 0, e = order.NumItems(); i < e; i++)
+                order[i] = i;
+            std::sort(order.begin(), order.end(), [this, sortsSpecs](uint32_t l, uint32_t r)
             {
-                Song* lSong = m_db[l.songId];
-                Song* rSong = m_db[r.songId];
+                auto& lKey = m_sortKeys[l];
+                auto& rKey = m_sortKeys[r];
                 for (int i = 0; i < sortsSpecs->SpecsCount; i++)
                 {
                     auto& sortSpec = sortsSpecs->Specs[i];
@@ -778,47 +959,130 @@ namespace rePlayer
                     switch (sortSpec.ColumnUserID)
                     {
                     case kTitle:
-                        delta = CompareStringMixed(lSong->GetName(), rSong->GetName());
+                        delta = CompareStringMixed(lKey.title, rKey.title);
                         break;
                     case kArtist:
-                        delta = CompareStringMixed(m_db.GetArtists(l.songId).c_str(), m_db.GetArtists(r.songId).c_str());
+                        for (auto* lRank = m_sortArtistRanks.Items(lKey.artists), *rRank = m_sortArtistRanks.Items(rKey.artists);; lRank++, rRank++)
+                        {
+                            delta = int64_t(*lRank) - int64_t(*rRank);
+                            if (delta || *lRank == 0)
+                                break;
+                        }
                         break;
                     case kType:
-                        delta = strcmp(lSong->GetType().GetExtension(), rSong->GetType().GetExtension());
+                        delta = strcmp(lKey.type, rKey.type);
                         break;
                     case kSize:
-                        delta = int64_t(lSong->GetFileSize()) - int64_t(rSong->GetFileSize());
+                        delta = int64_t(lKey.fileSize) - int64_t(rKey.fileSize);
                         break;
                     case kDuration:
-                        delta = int64_t(lSong->GetSubsongDurationCs(l.index) / 100) - int64_t(rSong->GetSubsongDurationCs(r.index) / 100);
+                        delta = int64_t(lKey.duration) - int64_t(rKey.duration);
                         break;
                     case kCRC:
-                        delta = int64_t(lSong->GetFileCrc()) - int64_t(rSong->GetFileCrc());
+                        delta = int64_t(lKey.fileCrc) - int64_t(rKey.fileCrc);
                         break;
                     case kRating:
-                        delta = int64_t(lSong->GetSubsongRating(l.index)) - int64_t(rSong->GetSubsongRating(r.index));
+                        delta = int64_t(lKey.rating) - int64_t(rKey.rating);
                         break;
                     case kDatabaseDate:
-                        delta = int64_t(lSong->GetDatabaseDay()) - int64_t(rSong->GetDatabaseDay());
+                        delta = int64_t(lKey.databaseDay) - int64_t(rKey.databaseDay);
                         break;
                     case kSource:
-                        delta = strcmp(SourceID::sourceNames[lSong->GetSourceId(0).sourceId], SourceID::sourceNames[rSong->GetSourceId(0).sourceId]);
+                        delta = strcmp(lKey.source, rKey.source);
                         break;
                     case kReplay:
-                        delta = strcmp(lSong->GetType().GetReplay(), rSong->GetType().GetReplay());
+                        delta = strcmp(lKey.replay, rKey.replay);
                         break;
                     }
 
                     if (delta)
                         return (sortSpec.SortDirection == ImGuiSortDirection_Ascending) ? delta < 0 : delta > 0;
                 }
-                return l < r;
+                return m_entries[l] < m_entries[r];
             });
 
+            Array<SubsongEntry> entries(order.NumItems());
+            for (uint32_t i = 0, e = order.NumItems(); i < e; i++)
+                entries[i] = m_entries[order[i]];
+            m_entries = std::move(entries);
+
             sortsSpecs->SpecsDirty = false;
         }
     }
 
+    void DatabaseSongsUI::BuildSortKeys(const ImGuiTableSortSpecs* sortsSpecs)
+    {
+        // songs can be edited in place (through their proxy), so the keys are gathered again for each sort:
+        // it's a single pass over the entries, the comparator never goes through the database
+        bool isSortingArtists = false;
+        for (int i = 0; i < sortsSpecs->SpecsCount; i++)
+            isSortingArtists |= sortsSpecs->Specs[i].ColumnUserID == kArtist;
+
+        // rank the artists by handle once, instead of building the artists string of each song
+        Array<uint32_t> artistRanks;
+        if (isSortingArtists)
+        {
+            Array<Artist*> artists(0u, m_db.NumArtists());
+            uint32_t maxArtistId = 0;
+            for (Artist* artist : m_db.Artists())
+            {
+                artists.Add(artist);
+                maxArtistId = Max(maxArtistId, uint32_t(artist->GetId()));
+            }
+            std::sort(artists.begin(), artists.end(), [](Artist* l, Artist* r)
+            {
+                return CompareStringMixed(l->GetHandle(), r->GetHandle()) < 0;
+            });
+            artistRanks.Add(0u, maxArtistId + 1);
+            uint32_t rank = 0;
+            for (uint32_t i = 0, e = artists.NumItems(); i < e; i++)
+            {
+                if (i == 0 || CompareStringMixed(artists[i - 1]->GetHandle(), artists[i]->GetHandle()) != 0)
+                    rank++;
+                artistRanks[uint32_t(artists[i]->GetId())] = rank;
+            }
+        }
+
+        m_sortKeys.Resize(m_entries.NumItems());
+        m_sortArtistRanks.Clear();
+        m_sortArtistRanks.Add(0u);
+        Song* lastSong = nullptr;
+        uint32_t lastArtists = 0;
+        for (uint32_t i = 0, e = m_entries.NumItems(); i < e; i++)
+        {
+            auto& entry = m_entries[i];
+            Song* song = m_db[entry.songId];
+            auto type = song->GetType();
+
+            auto& key = m_sortKeys[i];
+            key.title = song->GetName();
+            key.type = type.GetExtension();
+            key.source = SourceID::sourceNames[song->GetSourceId(0).sourceId];
+            key.replay = type.GetReplay();
+            key.fileSize = song->GetFileSize();
+            key.fileCrc = song->GetFileCrc();
+            key.duration = song->GetSubsongDurationCs(entry.index) / 100;
+            key.databaseDay = song->GetDatabaseDay();
+            key.rating = song->GetSubsongRating(entry.index);
+
+            // subsongs of a song are usually next to each other and share the artist ranks
+            if (isSortingArtists && song != lastSong)
+            {
+                if (song->NumArtistIds() > 0)
+                {
+                    lastArtists = m_sortArtistRanks.NumItems();
+                    for (auto artistId : song->ArtistIds())
+                        m_sortArtistRanks.Add(artistRanks[uint32_t(artistId)]);
+                    m_sortArtistRanks.Add(0u);
+                }
+                else
+                    lastArtists = 0;
+                lastSong = song;
+            }
+            key.artists = lastArtists;
+        }
+    }
+
     void DatabaseSongsUI::UpdateRowBackground(int32_t rowIdx, Song* song, SubsongID subsongId, MusicID currentPlayingSong)
     {
         float backgroundRatio = m_subsongHighlights.Get(subsongId, 0.0f);
@@ -5,6 +5,7 @@
 #include <Containers/HashMap.h>
 #include <Database/Types/MusicID.h>
 
+struct ImGuiTableSortSpecs;
 struct ImGuiTextFilter;
 
 namespace core
@@ -41,6 +42,8 @@ namespace rePlayer
             bool IsSelected() const;
             void Select(bool isEnabled);
         };
+        struct SearchSong;
+        struct SearchFilters;
 
     protected:
         virtual Array<SubsongEntry> GatherEntries() const;
@@ -55,10 +58,17 @@ namespace rePlayer
 
         // Used in DisplaySongsFilter
         void DisplaySongsFilterUI(bool& isDirty);
-        void FilterSongs();
+        void FilterSongs(bool isRefreshed);
+
+        // Used in FilterSongs
+        void BuildSearchFilters(SearchFilters& searchFilters) const;
+        bool IsNarrowing(const SearchFilters& searchFilters) const;
+        bool PassSearch(const SearchFilters& searchFilters, SubsongID subsongId);
+        const SearchSong& GetSearchSong(Song* song);
 
         // Used in DisplaySongsTable
         void SortSubsongs(bool isDirty);
+        void BuildSortKeys(const ImGuiTableSortSpecs* sortsSpecs);
         void UpdateRowBackground(int32_t rowIdx, Song* song, SubsongID subsongId, MusicID currentPlayingSong);
         void UpdateSelection(int32_t rowIdx, MusicID musicId);
 
@@ -118,6 +128,44 @@ namespace rePlayer
         Array<Filter> m_filters;
         Array<uint32_t> m_filterLostIds;
 
+        // lower-cased search text of a song, the fields are separated by '\n' and ordered as the filter flags
+        struct SearchSong
+        {
+            uint32_t stamp = 0;
+            uint32_t subsongs; // offset in m_searchSubsongs (one text offset per subsong + the end)
+            uint32_t fields[kNumFilterFlags + 1]; // offsets in m_searchText
+        };
+        // the active filters split in lower-cased words
+        struct SearchFilters
+        {
+            struct Word
+            {
+                uint32_t offset : 31; // in chars
+                uint32_t isExcluded : 1;
+                uint32_t length;
+            };
+            struct Query
+            {
+                FilterFlag flags;
+                uint32_t id;
+                uint32_t words; // first word in words
+                uint16_t numWords;
+                uint16_t numIncluded;
+            };
+            Array<Query> queries;
+            Array<Word> words;
+            Array<char> chars;
+            uint32_t revision = 0;
+            bool isValid = false;
+        };
+        Array<SearchSong> m_searchSongs; // indexed by song id
+        Array<uint32_t> m_searchSubsongs;
+        Array<char> m_searchText;
+        uint32_t m_searchRevision = 0;
+        uint32_t m_searchStamp = 1;
+        SearchFilters m_searchFilters; // applied to the current entries
+        HashMap<SubsongID, bool> m_selectedSubsongs;
+
         // table
 
         enum TabIDs
@@ -134,6 +182,23 @@ namespace rePlayer
         Array<SubsongEntry> m_entries;
         uint32_t m_numSelectedEntries = 0;
 
+        // sort keys of the entries, to keep the database out of the sort comparator
+        struct SortKey
+        {
+            const char* title;
+            const char* type;
+            const char* source;
+            const char* replay;
+            uint32_t artists; // offset in m_sortArtistRanks
+            uint32_t fileSize;
+            uint32_t fileCrc;
+            uint32_t duration;
+            uint16_t databaseDay;
+            uint8_t rating;
+        };
+        Array<SortKey> m_sortKeys;
+        Array<uint32_t> m_sortArtistRanks; // artist ranks (by handle) of each song, zero terminated
+
         const bool m_isScrollingEnabled = true;
 
         TrackMode m_trackMode = TrackMode::None;
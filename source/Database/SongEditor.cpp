@@ -479,7 +479,8 @@ namespace rePlayer
                 Core::AddJob([this, &replays, musicId = m_musicId]()
                 {
                     SmartPtr<core::io::Stream> stream = musicId.GetStream();
-                    Core::FromJob([this, musicId, playables = stream.IsValid() ? replays.Enumerate(stream) : Replayables()]()
+                    auto* song = musicId.GetSong();
+                    Core::FromJob([this, musicId, playables = stream.IsValid() ? replays.Enumerate(stream, song->GetFileSize(), song->GetFileCrc()) : Replayables()]()
                     {
                         m_busySpinner.Reset();
                         if (m_musicId == musicId)
@@ -34,11 +34,71 @@ namespace rePlayer
         WAVEHDR header = {};
     };
 
+    // buffers and plans kept between the loop detections (fftw is shared by the whole process, its wisdom is never cleaned up here)
+    struct SongEndEditor::Fft
+    {
+        Array<float> mono;
+        Array<float> autocorrelation;
+        int size = 0;
+        float* in = nullptr;
+        float* out = nullptr;
+        fftwf_complex* spectrum = nullptr;
+        fftwf_complex* power = nullptr;
+        fftwf_plan forward = nullptr;
+        fftwf_plan inverse = nullptr;
+
+        ~Fft()
+        {
+            Resize(0);
+        }
+
+        void Resize(int newSize)
+        {
+            if (size == newSize)
+                return;
+            if (size)
+            {
+                fftwf_destroy_plan(forward);
+                fftwf_destroy_plan(inverse);
+                fftwf_free(spectrum);
+                fftwf_free(power);
+                fftwf_free(in);
+                fftwf_free(out);
+            }
+            size = newSize;
+            if (newSize)
+            {
+                spectrum = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * (newSize / 2 + 1));
+                power = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * (newSize / 2 + 1));
+                in = (float*)fftwf_malloc(sizeof(float) * newSize);
+                out = (float*)fftwf_malloc(sizeof(float) * newSize);
+                forward = fftwf_plan_dft_r2c_1d(newSize, in, spectrum, FFTW_ESTIMATE);
+                inverse = fftwf_plan_dft_c2r_1d(newSize, power, out, FFTW_ESTIMATE);
+            }
+        }
+    };
+
+    inline void SongEndEditor::Bucket::Add(const Bucket& other)
+    {
+        min = Min(min, other.min);
+        max = Max(max, other.max);
+        sumSquares += other.sumSquares;
+    }
+
+    inline void SongEndEditor::Bucket::Add(const StereoSample& sample)
+    {
+        float s = (sample.left + sample.right) * 0.5f;
+        min = Min(min, s);
+        max = Max(max, s);
+        sumSquares += s * s;
+    }
+
     SmartPtr<SongEndEditor> SongEndEditor::Create(ReplayMetadataContext& context, MusicID musicId)
     {
         musicId.subsongId.index = context.subsongIndex;
         auto currentSong = musicId.GetSong();
-        if (auto replay = Core::GetReplays().Load(musicId.GetStream(), currentSong->Edit()->metadata.Container(), currentSong->Edit()->type))
+        auto* songSheet = currentSong->Edit();
+        if (auto replay = Core::GetReplays().Load(musicId.GetStream(), songSheet->metadata.Container(), songSheet->type, songSheet->fileSize, songSheet->fileCrc))
             return SmartPtr<SongEndEditor>(kAllocate, musicId, replay, context.loop);
         context.isSongEndEditorEnabled = false;
         return nullptr;
@@ -68,6 +128,7 @@ namespace rePlayer
         , m_replay(replay)
         , m_loop(loop)
         , m_wave(new Wave)
+        , m_fft(new Fft)
     {
         auto artists = musicId.GetArtists();
         if (!artists.empty())
@@ -82,6 +143,7 @@ namespace rePlayer
         m_numSamples = kDefaultSongLength * replay->GetSampleRate();
         m_samples.Resize(m_numSamples);
         memset(m_samples.Items(), 0, m_samples.Size<size_t>());
+        ResizePyramid();
         m_loopDetection.loopMax = GetMaxLoopDuration();
 
         AddRef();
@@ -105,6 +167,7 @@ namespace rePlayer
     {
         delete m_replay;
         delete m_wave;
+        delete m_fft;
     }
 
     bool SongEndEditor::Update(ReplayMetadataContext& context)
@@ -141,29 +204,17 @@ namespace rePlayer
                 uint32_t currentSample = ReadCurrentSample();
                 uint32_t startFrame = uint32_t((1000ull * m_currentFrameSample) / (sampleRate * numMillisecondsPerPixel));
                 uint32_t endFrame = currentSample == numSamples ? m_frames.NumItems() : uint32_t((1000ull * currentSample) / (sampleRate * numMillisecondsPerPixel));
-                if (startFrame != endFrame)
+                if (startFrame != endFrame && currentSample != 0) // nothing rendered yet, no sample to clamp to
                 {
-                    auto* samples = m_samples.Items();
+                    // the pyramid gives each frame in a few buckets, whatever the zoom
                     for (uint32_t i = startFrame; i < endFrame; i++)
                     {
-                        auto x0 = uint32_t(i * numMillisecondsPerPixel * sampleRate / 1000);
-                        auto x1 = uint32_t((i + 1) * numMillisecondsPerPixel * sampleRate / 1000);
-                        float s = (samples[x0].left + samples[x0].right) * 0.5f;
-                        float rms = s * s;
-                        float min = s;
-                        float max = s;
-                        for (auto x = x0 + 1; x < x1; x++)
-                        {
-                            s = (samples[x].left + samples[x].right) * 0.5f;
-                            rms += s * s;
-                            if (s < min)
-                                min = s;
-                            else if (s > max)
-                                max = s;
-                        }
-                        rms = sqrtf(rms / (x1 - x0));
-                        m_frames[i].min = uint8_t(Saturate(min * 0.5f + 0.5f) * 255);
-                        m_frames[i].max = uint8_t(Saturate(max * 0.5f + 0.5f) * 255);
+                        auto x0 = Min(uint32_t(i * numMillisecondsPerPixel * sampleRate / 1000), currentSample - 1);
+                        auto x1 = Clamp(uint32_t((i + 1) * numMillisecondsPerPixel * sampleRate / 1000), x0 + 1, currentSample);
+                        auto bucket = QueryPyramid(x0, x1);
+                        float rms = sqrtf(bucket.sumSquares / (x1 - x0));
+                        m_frames[i].min = uint8_t(Saturate(bucket.min * 0.5f + 0.5f) * 255);
+                        m_frames[i].max = uint8_t(Saturate(bucket.max * 0.5f + 0.5f) * 255);
                         m_frames[i].rms = uint8_t(Saturate(rms) * 127);
                     }
                     m_currentFrameSample = currentSample;
@@ -248,6 +299,7 @@ namespace rePlayer
             if ((numSamples | preNumSamples) == 0)
             {
                 m_loop = { 0, uint32_t((m_currentSample * 1000ull) / sampleRate) };
+                UpdatePyramid(m_currentSample + remainingSamples);
                 std::atomic_ref(m_currentSample) += remainingSamples;
                 remainingSamples = 0;
             }
@@ -256,12 +308,80 @@ namespace rePlayer
                 waveform += numSamples;
                 remainingSamples -= numSamples;
                 preNumSamples = numSamples;
+                UpdatePyramid(m_currentSample + numSamples);
                 std::atomic_ref(m_currentSample) += numSamples;
             }
         }
         m_silence = Min(silence + sampleRate / 4, m_currentSample);
     }
 
+    void SongEndEditor::ResizePyramid()
+    {
+        // the render is idle, the buckets already built are kept
+        for (uint32_t level = 0; level < kNumPyramidLevels; level++)
+            m_pyramid[level].Resize(m_samples.NumItems() >> (kPyramidShift + level));
+    }
+
+    void SongEndEditor::UpdatePyramid(uint32_t numSamples)
+    {
+        // called before publishing the rendered samples: the ui only reads complete buckets, they are never written again
+        auto first = m_numPyramidBuckets;
+        auto last = numSamples >> kPyramidShift;
+        if (first >= last)
+            return;
+        m_numPyramidBuckets = last;
+
+        auto* samples = m_samples.Items(first << kPyramidShift);
+        for (auto* bucket = m_pyramid[0].Items(first), *end = m_pyramid[0].Items(last); bucket < end; bucket++)
+        {
+            *bucket = { FLT_MAX, -FLT_MAX, 0.0f };
+            for (uint32_t i = 0; i < kPyramidBucketSize; i++)
+                bucket->Add(*samples++);
+        }
+        for (uint32_t level = 1; level < kNumPyramidLevels; level++)
+        {
+            // a parent is complete once its second child is
+            first >>= 1;
+            last >>= 1;
+            if (first >= last)
+                break;
+            auto* children = m_pyramid[level - 1].Items(first * 2);
+            for (auto* bucket = m_pyramid[level].Items(first), *end = m_pyramid[level].Items(last); bucket < end; bucket++, children += 2)
+            {
+                *bucket = children[0];
+                bucket->Add(children[1]);
+            }
+        }
+    }
+
+    SongEndEditor::Bucket SongEndEditor::QueryPyramid(uint32_t start, uint32_t end) const
+    {
+        // the unaligned edges from the samples, then the largest buckets fitting in the range
+        Bucket bucket = { FLT_MAX, -FLT_MAX, 0.0f };
+        for (; start < end && (start & (kPyramidBucketSize - 1)); start++)
+            bucket.Add(m_samples[start]);
+        for (; end > start && (end & (kPyramidBucketSize - 1)); end--)
+            bucket.Add(m_samples[end - 1]);
+        start >>= kPyramidShift;
+        end >>= kPyramidShift;
+        for (uint32_t level = 0; start < end; level++)
+        {
+            if (level == kNumPyramidLevels - 1)
+            {
+                for (; start < end; start++)
+                    bucket.Add(m_pyramid[level][start]);
+                break;
+            }
+            if (start & 1)
+                bucket.Add(m_pyramid[level][start++]);
+            if (end & 1)
+                bucket.Add(m_pyramid[level][--end]);
+            start >>= 1;
+            end >>= 1;
+        }
+        return bucket;
+    }
+
     inline uint32_t SongEndEditor::ReadCurrentSample() const
     {
         return std::atomic_ref(m_currentSample).load();
@@ -307,8 +427,9 @@ namespace rePlayer
         m_busySpinner->Info("Converting to mono");
 
         auto downsampleFactor = m_loopDetection.downsampleFactor;
-        std::vector<float> mono(m_samples.NumItems() / downsampleFactor);
-        for (size_t i = 0, e = mono.size(); i < e; i++)
+        auto& mono = m_fft->mono;
+        mono.Resize(m_samples.NumItems() / downsampleFactor);
+        for (size_t i = 0, e = mono.NumItems(); i < e; i++)
         {
             float sample = m_samples[i * downsampleFactor].left + m_samples[i * downsampleFactor].right;
             for (uint32_t j = 1; j < downsampleFactor; j++)
@@ -320,33 +441,32 @@ namespace rePlayer
         auto sampleRate = m_replay->GetSampleRate() / downsampleFactor;
 
         // compute autocorrelation using FFT convolution
-        auto autocorrelate = [](const std::vector<float>& x)
+        auto autocorrelate = [fft = m_fft](const Array<float>& x) -> const Array<float>&
         {
-            auto N = int(x.size());
+            auto N = int(x.NumItems());
             int Nfft = 1;
             while (Nfft < 2 * N) Nfft <<= 1;
 
-            fftwf_complex* X = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * (Nfft / 2 + 1));
-            fftwf_complex* R = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * (Nfft / 2 + 1));
-            float* in = (float*)fftwf_malloc(sizeof(float) * Nfft);
-            float* out = (float*)fftwf_malloc(sizeof(float) * Nfft);
+            // the buffers and the plans are rebuilt only when the size changes
+            fft->Resize(Nfft);
+            fftwf_complex* X = fft->spectrum;
+            fftwf_complex* R = fft->power;
+            float* in = fft->in;
+            float* out = fft->out;
                                                                              
             std::fill(in + N, in + Nfft, 0.0f);
 
-            float mean = std::accumulate(x.begin(), x.end(), 0.0f) / x.size();
+            float mean = std::accumulate(x.begin(), x.end(), 0.0f) / x.NumItems();
 
             for (int i = 0; i < N; ++i) {
                 float w = 0.5f * (1.0f - cosf(2.0f * 3.14159265358979323846f * i / (N - 1))); // Hann
                 in[i] = (x[i] - mean) * w;
             }
 
-            fftwf_plan fwd = fftwf_plan_dft_r2c_1d(Nfft, in, X, FFTW_ESTIMATE);
-            fftwf_plan inv = fftwf_plan_dft_c2r_1d(Nfft, R, out, FFTW_ESTIMATE);
-
             for (int lag = 1; lag < N; ++lag)
                 out[lag] /= float(N - lag);
 
-            fftwf_execute(fwd);
+            fftwf_execute(fft->forward);
 
             // power spectrum |X|^2
             for (int i = 0; i < Nfft / 2 + 1; i++) {
@@ -356,10 +476,11 @@ namespace rePlayer
                 R[i][1] = 0.0;
             }
 
-            fftwf_execute(inv);
+            fftwf_execute(fft->inverse);
 
             // normalize autocorrelation
-            std::vector<float> ac(N);
+            auto& ac = fft->autocorrelation;
+            ac.Resize(N);
 
             float r0 = out[0]; // total energy
             for (int lag = 0; lag < N; ++lag) {
@@ -367,20 +488,11 @@ namespace rePlayer
                 ac[lag] = (denom > 1e-6f) ? out[lag] / denom : 0.0f;
             }
 
-            fftwf_destroy_plan(fwd);
-            fftwf_destroy_plan(inv);
-            fftwf_free(X);
-            fftwf_free(R);
-            fftwf_free(in);
-            fftwf_free(out);
-
-            fftwf_cleanup();
-
             return ac;
         };
 
         // find the first significant autocorrelation peak (loop length)
-        auto detectLoopLength = [this](const std::vector<float>& ac, int minLag, int maxLag)
+        auto detectLoopLength = [this](const Array<float>& ac, int minLag, int maxLag)
         {
             // Global max for relative threshold
             float globalMax = 0.0f;
@@ -413,7 +525,7 @@ namespace rePlayer
 
                     float mv = ac[m];
                     if (m > 0) mv = std::max(mv, ac[m - 1]);
-                    if (m + 1 < (int)ac.size()) mv = std::max(mv, ac[m + 1]);
+                    if (m + 1 < (int)ac.NumItems()) mv = std::max(mv, ac[m + 1]);
 
                     if (mv > consistencyThresh * v)
                         good++;
@@ -467,8 +579,6 @@ namespace rePlayer
                 fftwf_destroy_plan(plan);
                 fftwf_free(fftIn);
                 fftwf_free(fftOut);
-
-                fftwf_cleanup();
             }
 
             void compute(const float* input, float* out)
@@ -619,7 +729,7 @@ namespace rePlayer
         m_busySpinner->Indent(1);
 
         m_busySpinner->Info("Autocorrelate");
-        auto ac = autocorrelate(mono);
+        auto& ac = autocorrelate(mono);
 
         // 2. Detect loop length (search between 0.5s and 30s for example)
         int loopMin = sampleRate * m_loopDetection.loopMin;
@@ -641,11 +751,11 @@ namespace rePlayer
         std::vector<std::vector<float>> features;
 
         auto* message = m_busySpinner->Info("MFCC %u%%", 0u);
-        for (size_t i = m_loopDetection.loopStart * sampleRate; i + FRAME < mono.size(); i += HOP)
+        for (size_t i = m_loopDetection.loopStart * sampleRate; i + FRAME < mono.NumItems(); i += HOP)
         {
             features.emplace_back(MFCCS);
             mfcc.compute(&mono[i], features.back().data());
-            m_busySpinner->UpdateMessageParam(message, uint32_t(((i + HOP) * 100ull) / mono.size()));
+            m_busySpinner->UpdateMessageParam(message, uint32_t(((i + HOP) * 100ull) / mono.NumItems()));
         }
         m_busySpinner->UpdateMessageParam(message, 100u);
 
@@ -1022,6 +1132,7 @@ namespace rePlayer
 
             m_samples.Resize(numSamples);
             memset(m_samples.Items(numAllocatedSamples), 0, (numSamples - numAllocatedSamples) * m_samples.ItemSize());
+            ResizePyramid();
             m_semaphore.Signal();
 
             m_wave->header.dwFlags = 0;
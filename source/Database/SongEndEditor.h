@@ -32,12 +32,27 @@ namespace rePlayer
             uint8_t rms;
         };
 
+        // min/max/sum of squares of the mono samples in a bucket of the waveform pyramid
+        struct Bucket
+        {
+            float min;
+            float max;
+            float sumSquares;
+
+            void Add(const Bucket& other);
+            void Add(const StereoSample& sample);
+        };
+
         struct Wave;
+        struct Fft;
 
     private:
         ~SongEndEditor() override;
 
         void Render();
+        void ResizePyramid();
+        void UpdatePyramid(uint32_t numSamples);
+        Bucket QueryPyramid(uint32_t start, uint32_t end) const;
         uint32_t ReadCurrentSample() const;
         void OpenAudio();
 
@@ -59,7 +74,15 @@ namespace rePlayer
         Replay* m_replay;
         std::string m_title;
 
+        // the whole subsong stays in memory: waveOut loops over it for the playback and the loop detection runs on it,
+        // so the render isn't streamed and the pyramid (rebuilt along with the samples) isn't kept once the editor is closed
         Array<StereoSample> m_samples;
+        // level n has a bucket per kPyramidBucketSize << n samples, only the fully rendered buckets are built
+        static constexpr uint32_t kPyramidShift = 6;
+        static constexpr uint32_t kPyramidBucketSize = 1 << kPyramidShift;
+        static constexpr uint32_t kNumPyramidLevels = 16;
+        Array<Bucket> m_pyramid[kNumPyramidLevels];
+        uint32_t m_numPyramidBuckets = 0; // render side
         Array<Frame> m_frames;
         Array<uint32_t> m_loops;
         float m_numMillisecondsPerPixel = FLT_MAX;
@@ -76,6 +99,7 @@ namespace rePlayer
         float m_waveScroll = 0.0f;
         uint32_t m_waveStartPosition = 0;
         Wave* m_wave = nullptr;
+        Fft* m_fft = nullptr;
         thread::Semaphore m_semaphore;
 
         // mouse & loop
@@ -44,7 +44,10 @@ namespace rePlayer
 
     void MusicID::MarkForSave()
     {
-        Core::GetDatabase(databaseId).Raise(Database::Flag::kSaveSongs);
+        // the sheet may have been changed without Edit (the player keeps the one it got at load), so journal it here
+        auto& db = Core::GetDatabase(databaseId);
+        db.Touch(subsongId.songId);
+        db.Raise(Database::Flag::kSaveSongs);
     }
 
     void MusicID::Track(TrackMode trackMode) const
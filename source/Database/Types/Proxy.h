@@ -2,6 +2,7 @@
 
 #include <Core.h>
 #include <Blob/Blob.h>
+#include <Blob/BlobSerializer.h>
 
 namespace core::io
 {
@@ -16,6 +17,8 @@ namespace rePlayer
     template <typename StaticType, typename DynamicType>
     struct Proxy
     {
+        typedef DynamicType Sheet;
+
         static StaticType* Create(DynamicType* buffer);
         DynamicType* Edit();
         DynamicType* Dynamic() const;
@@ -30,6 +33,8 @@ namespace rePlayer
         // serialize
         static StaticType* Load(io::File& file);
         void Save(io::File& file) const;
+        // blob data of the item (serialized in s for a proxy), empty when it doesn't fit in a blob
+        const Span<uint8_t> Pack(BlobSerializer& s) const;
 
         static constexpr int16_t kReconcileDelay = 300;
 
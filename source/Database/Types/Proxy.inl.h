@@ -22,6 +22,8 @@ namespace rePlayer
     template <typename StaticType, typename DynamicType>
     __declspec(noinline) DynamicType* Proxy<StaticType, DynamicType>::Edit()
     {
+        Core::OnEdit(reinterpret_cast<const StaticType*>(this));
+
         auto* proxy = reinterpret_cast<Info*>(this);
         if (proxy->dataSize != 0)
         {
@@ -102,7 +104,8 @@ namespace rePlayer
     inline StaticType* Proxy<StaticType, DynamicType>::Load(io::File& file)
     {
         StaticType* blob;
-        if (auto size = file.Read<uint16_t>())
+        auto size = file.Read<uint16_t>();
+        if (size > 0 && size <= Blob::kMaxDataSize)
         {
             blob = Blob::New<StaticType>(size);
             file.Read(static_cast<Blob*>(blob) + 1, size);
@@ -110,7 +113,17 @@ namespace rePlayer
         else
         {
             auto* edited = new DynamicType();
-            edited->Load(file);
+            if (size > 0)
+            {
+                // saved before the blobs were limited to kMaxDataSize: read in a temporary blob to become a sheet
+                auto* data = new (Alloc<StaticType>(size + sizeof(Blob))) StaticType();
+                data->dataSize = Blob::kMaxDataSize; // not a proxy
+                file.Read(static_cast<Blob*>(data) + 1, size);
+                data->CopyTo(edited);
+                Free(data);
+            }
+            else
+                edited->Load(file);
 
             blob = Blob::New<StaticType>(sizeof(StaticType));
             blob->id = edited->id;
@@ -144,5 +157,17 @@ namespace rePlayer
             file.Write(static_cast<const Blob*>(proxy) + 1, proxy->dataSize);
         }
     }
+
+    template <typename StaticType, typename DynamicType>
+    inline const Span<uint8_t> Proxy<StaticType, DynamicType>::Pack(BlobSerializer& s) const
+    {
+        auto* proxy = reinterpret_cast<const Info*>(this);
+        if (proxy->dataSize == 0)
+        {
+            s = Dynamic()->Serialize();
+            return s.Buffer();
+        }
+        return { reinterpret_cast<uint8_t*>(const_cast<Blob*>(static_cast<const Blob*>(proxy) + 1)), proxy->dataSize };
+    }
 }
 // namespace rePlayer
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "AudioOutputFile.h"
+#include "AudioOutputNull.h"
+#ifdef _WIN32
+#include "AudioOutputWaveOut.h"
+#endif
+
+namespace rePlayer
+{
+    AudioOutput* AudioOutput::Create(Type type, const char* filename)
+    {
+        switch (type)
+        {
+#ifdef _WIN32
+        case Type::kWaveOut:
+            return new AudioOutputWaveOut();
+#endif
+        case Type::kFile:
+            return new AudioOutputFile(filename);
+        default:
+            return new AudioOutputNull();
+        }
+    }
+
+    uint32_t AudioOutput::GetVolume(Type type)
+    {
+#ifdef _WIN32
+        if (type == Type::kWaveOut)
+            return AudioOutputWaveOut::GetVolume();
+#else
+        UnusedArg(type);
+#endif
+        return 0xffFF;
+    }
+
+    void AudioOutput::SetVolume(Type type, uint32_t volume)
+    {
+#ifdef _WIN32
+        if (type == Type::kWaveOut)
+            AudioOutputWaveOut::SetVolume(volume);
+#else
+        UnusedArg(type, volume);
+#endif
+    }
+}
+// namespace rePlayer
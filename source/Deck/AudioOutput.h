@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Audio/AudioTypes.h>
+#include <Core.h>
+
+#include <functional>
+
+namespace core::thread
+{
+    class Semaphore;
+}
+// namespace core::thread
+
+namespace rePlayer
+{
+    using namespace core;
+
+    // Audio sink of the Player: it consumes the Player ring buffer and pulls the samples it needs through a callback
+    class AudioOutput
+    {
+    public:
+        enum class Type : uint8_t
+        {
+            kWaveOut,
+            kNull,  // consumes a whole ring of samples each update period (headless)
+            kFile   // same as null, but also writes the consumed samples in a wav file
+        };
+
+        // render numSamples in the ring, starting at ringPos (never wraps around the end of the ring)
+        using Callback = std::function<void(uint32_t numSamples, uint32_t ringPos)>;
+
+    public:
+        static AudioOutput* Create(Type type, const char* filename = nullptr);
+        virtual ~AudioOutput() {}
+
+        // volume of the device behind the output type, from 0 to 0xffff (the outputs without a device are always at full volume)
+        static uint32_t GetVolume(Type type);
+        static void SetVolume(Type type, uint32_t volume);
+
+        // ring size has to be a power of 2; the wakeUp semaphore is signaled each time the output needs more samples
+        virtual bool Open(StereoSample* ring, uint32_t numSamples, uint32_t sampleRate, thread::Semaphore* wakeUp) = 0;
+
+        virtual void Pause() = 0;
+        virtual void Resume() = 0;
+        virtual void Reset() = 0;
+
+        // number of samples consumed since the last reset
+        virtual uint64_t GetPosition() const = 0;
+
+        // pull-model: render and submit everything the output can accept at this time
+        virtual void Update(const Callback& callback) = 0;
+
+        // longest time to wait for the wakeUp semaphore before the next update
+        virtual uint32_t GetUpdatePeriod() const = 0;
+
+        Type GetType() const { return m_type; }
+
+    protected:
+        AudioOutput(Type type) : m_type(type) {}
+
+    private:
+        const Type m_type;
+    };
+}
+// namespace rePlayer
@@ -0,0 +1,52 @@
+// Core
+#include <Core/Log.h>
+
+#include "AudioOutputFile.h"
+
+// dr_wav (implementation is in Export.cpp)
+#include <dr_wav.h>
+
+namespace rePlayer
+{
+    AudioOutputFile::AudioOutputFile(const char* filename)
+        : AudioOutputNull(Type::kFile)
+        , m_filename(filename ? filename : "rePlayer.wav")
+    {}
+
+    AudioOutputFile::~AudioOutputFile()
+    {
+        if (m_wav)
+        {
+            drwav_uninit(reinterpret_cast<drwav*>(m_wav));
+            delete reinterpret_cast<drwav*>(m_wav);
+        }
+    }
+
+    bool AudioOutputFile::Open(StereoSample* ring, uint32_t numSamples, uint32_t sampleRate, thread::Semaphore* wakeUp)
+    {
+        AudioOutputNull::Open(ring, numSamples, sampleRate, wakeUp);
+
+        drwav_data_format format;
+        format.container = drwav_container_riff;
+        format.format = DR_WAVE_FORMAT_IEEE_FLOAT;
+        format.channels = 2;
+        format.sampleRate = sampleRate;
+        format.bitsPerSample = 32;
+
+        auto* wav = new drwav;
+        if (!drwav_init_file_write(wav, m_filename.c_str(), &format, nullptr))
+        {
+            Log::Error("Audio: can't open \"%s\"\n", m_filename.c_str());
+            delete wav;
+            return true;
+        }
+        m_wav = wav;
+        return false;
+    }
+
+    void AudioOutputFile::OnConsume(const StereoSample* samples, uint32_t numSamples)
+    {
+        drwav_write_pcm_frames(reinterpret_cast<drwav*>(m_wav), numSamples, samples);
+    }
+}
+// namespace rePlayer
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+#include "AudioOutputNull.h"
+
+namespace rePlayer
+{
+    class AudioOutputFile : public AudioOutputNull
+    {
+    public:
+        AudioOutputFile(const char* filename);
+        ~AudioOutputFile() override;
+
+        bool Open(StereoSample* ring, uint32_t numSamples, uint32_t sampleRate, thread::Semaphore* wakeUp) override;
+
+    private:
+        void OnConsume(const StereoSample* samples, uint32_t numSamples) override;
+
+    private:
+        std::string m_filename;
+        void* m_wav = nullptr;
+    };
+}
+// namespace rePlayer
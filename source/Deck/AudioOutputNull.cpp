@@ -0,0 +1,75 @@
+#include "AudioOutputNull.h"
+
+// stl
+#include <atomic>
+
+namespace rePlayer
+{
+    bool AudioOutputNull::Open(StereoSample* ring, uint32_t numSamples, uint32_t sampleRate, thread::Semaphore* wakeUp)
+    {
+        UnusedArg(wakeUp); // nothing to wait for, the samples are consumed right after being rendered
+        m_ring = ring;
+        m_numSamples = numSamples;
+        m_sampleRate = sampleRate;
+        return false;
+    }
+
+    void AudioOutputNull::Pause()
+    {
+        std::atomic_ref(m_isPaused).store(true);
+    }
+
+    void AudioOutputNull::Resume()
+    {
+        std::atomic_ref(m_isPaused).store(false);
+    }
+
+    void AudioOutputNull::Reset()
+    {
+        std::atomic_ref(m_position).store(0);
+        m_fillPos = 0;
+    }
+
+    uint64_t AudioOutputNull::GetPosition() const
+    {
+        return std::atomic_ref(const_cast<uint64_t&>(m_position)).load();
+    }
+
+    void AudioOutputNull::Update(const Callback& callback)
+    {
+        auto numSamplesMask = m_numSamples - 1;
+        auto position = std::atomic_ref(m_position).load();
+        auto fillPos = m_fillPos;
+        for (auto waveEnd = position + m_numSamples; fillPos < waveEnd;)
+        {
+            auto count = uint32_t(Min(m_numSamples - (fillPos & numSamplesMask), waveEnd - fillPos));
+            callback(count, uint32_t(fillPos & numSamplesMask));
+            fillPos += count;
+        }
+        m_fillPos = fillPos;
+
+        // everything rendered is consumed at once (unless paused, to keep the pre-filled ring)
+        if (!std::atomic_ref(m_isPaused).load())
+        {
+            while (position < fillPos)
+            {
+                auto count = uint32_t(Min(m_numSamples - (position & numSamplesMask), fillPos - position));
+                OnConsume(m_ring + (position & numSamplesMask), count);
+                position += count;
+            }
+            std::atomic_ref(m_position).store(position);
+        }
+    }
+
+    uint32_t AudioOutputNull::GetUpdatePeriod() const
+    {
+        // a quarter of the ring: the headless playback runs ahead of real time without spinning the render thread
+        return Max((1000 * m_numSamples) / (4 * m_sampleRate), 1u);
+    }
+
+    void AudioOutputNull::OnConsume(const StereoSample* samples, uint32_t numSamples)
+    {
+        UnusedArg(samples, numSamples);
+    }
+}
+// namespace rePlayer
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "AudioOutput.h"
+
+namespace rePlayer
+{
+    class AudioOutputNull : public AudioOutput
+    {
+    public:
+        AudioOutputNull(Type type = Type::kNull) : AudioOutput(type) {}
+
+        bool Open(StereoSample* ring, uint32_t numSamples, uint32_t sampleRate, thread::Semaphore* wakeUp) override;
+
+        void Pause() override;
+        void Resume() override;
+        void Reset() override;
+
+        uint64_t GetPosition() const override;
+
+        void Update(const Callback& callback) override;
+
+        uint32_t GetUpdatePeriod() const override;
+
+    protected:
+        virtual void OnConsume(const StereoSample* samples, uint32_t numSamples);
+
+    protected:
+        StereoSample* m_ring = nullptr;
+        uint32_t m_numSamples = 0;
+        uint32_t m_sampleRate = 0;
+
+        uint64_t m_position = 0;
+        uint64_t m_fillPos = 0;
+        bool m_isPaused = false;
+    };
+}
+// namespace rePlayer
@@ -0,0 +1,143 @@
+// Core
+#include <Thread/Semaphore.h>
+
+#include "AudioOutputWaveOut.h"
+
+// Windows
+#include <mmeapi.h>
+#include <Mmreg.h>
+#pragma comment(lib, "winmm.lib")
+
+namespace rePlayer
+{
+    AudioOutputWaveOut::~AudioOutputWaveOut()
+    {
+        if (m_outHandle)
+        {
+            waveOutReset(m_outHandle);
+            for (auto& header : m_headers)
+                waveOutUnprepareHeader(m_outHandle, &header, sizeof(header));
+            waveOutClose(m_outHandle);
+        }
+    }
+
+    bool AudioOutputWaveOut::Open(StereoSample* ring, uint32_t numSamples, uint32_t sampleRate, thread::Semaphore* wakeUp)
+    {
+        WAVEFORMATEX waveFormat{};
+        waveFormat.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
+        waveFormat.nChannels = 2;
+        waveFormat.wBitsPerSample = 32;
+        waveFormat.nBlockAlign = waveFormat.nChannels * waveFormat.wBitsPerSample / 8;
+        waveFormat.nSamplesPerSec = sampleRate;
+        waveFormat.nAvgBytesPerSec = waveFormat.nSamplesPerSec * waveFormat.nBlockAlign;
+        waveFormat.cbSize = 0;
+
+        m_wakeUp = wakeUp;
+        m_numSamples = numSamples;
+        m_blockSize = numSamples / kNumBlocks;
+        m_sampleRate = sampleRate;
+
+        if (waveOutOpen(&m_outHandle, WAVE_MAPPER, &waveFormat, DWORD_PTR(OnWaveOut), DWORD_PTR(this), CALLBACK_FUNCTION) != S_OK)
+        {
+            m_outHandle = nullptr;
+            return true;
+        }
+
+        for (uint32_t i = 0; i < kNumBlocks; i++)
+        {
+            auto& header = m_headers[i];
+            header.lpData = reinterpret_cast<LPSTR>(ring + i * m_blockSize);
+            header.dwBufferLength = m_blockSize * sizeof(StereoSample);
+            waveOutPrepareHeader(m_outHandle, &header, sizeof(header));
+            header.dwFlags |= WHDR_DONE; // free to be submitted
+        }
+        return false;
+    }
+
+    void AudioOutputWaveOut::Pause()
+    {
+        waveOutPause(m_outHandle);
+    }
+
+    void AudioOutputWaveOut::Resume()
+    {
+        waveOutRestart(m_outHandle);
+    }
+
+    void AudioOutputWaveOut::Reset()
+    {
+        waveOutReset(m_outHandle);
+        m_lastPosition.store(0);
+        m_fillPos = 0;
+        m_submitPos = 0;
+    }
+
+    uint64_t AudioOutputWaveOut::GetPosition() const
+    {
+        MMTIME mmt{};
+        mmt.wType = TIME_BYTES;
+        waveOutGetPosition(m_outHandle, &mmt, sizeof(MMTIME));
+
+        // waveOut is counting bytes on 32 bits, so unwrap it from the last known position
+        static constexpr uint32_t kMask = 0xffFFffFF / sizeof(StereoSample);
+        auto lastPosition = m_lastPosition.load();
+        return lastPosition + ((mmt.u.cb / sizeof(StereoSample) - uint32_t(lastPosition)) & kMask);
+    }
+
+    void AudioOutputWaveOut::Update(const Callback& callback)
+    {
+        auto position = GetPosition();
+        m_lastPosition.store(position);
+
+        // render up to one ring ahead of the block being played (blocks already queued are left untouched)
+        auto numSamplesMask = m_numSamples - 1;
+        auto fillPos = m_fillPos;
+        for (auto waveEnd = position - (position % m_blockSize) + m_numSamples; fillPos < waveEnd;)
+        {
+            auto count = uint32_t(Min(m_numSamples - (fillPos & numSamplesMask), waveEnd - fillPos));
+            callback(count, uint32_t(fillPos & numSamplesMask));
+            fillPos += count;
+        }
+        m_fillPos = fillPos;
+
+        // queue the rendered blocks in ring order
+        for (auto submitPos = m_submitPos; submitPos + m_blockSize <= fillPos; submitPos += m_blockSize)
+        {
+            auto& header = m_headers[(submitPos / m_blockSize) % kNumBlocks];
+            if ((std::atomic_ref(header.dwFlags).load() & WHDR_DONE) == 0)
+                break;
+            waveOutWrite(m_outHandle, &header, sizeof(header));
+            m_submitPos = submitPos + m_blockSize;
+        }
+    }
+
+    uint32_t AudioOutputWaveOut::GetUpdatePeriod() const
+    {
+        // the callback wakes us up when a block is done, this is just a safety net
+        return (1000 * m_blockSize) / (2 * m_sampleRate);
+    }
+
+    uint32_t AudioOutputWaveOut::GetVolume()
+    {
+        DWORD value;
+        waveOutGetVolume(nullptr, &value);
+        return Max(value & 0xffFF, value >> 16);
+    }
+
+    void AudioOutputWaveOut::SetVolume(uint32_t volume)
+    {
+        waveOutSetVolume(nullptr, volume | (volume << 16));
+    }
+
+    void CALLBACK AudioOutputWaveOut::OnWaveOut(HWAVEOUT hwo, UINT uMsg, DWORD_PTR dwInstance, DWORD_PTR dwParam1, DWORD_PTR dwParam2)
+    {
+        UnusedArg(hwo, dwParam1, dwParam2);
+        if (uMsg == WOM_DONE)
+        {
+            auto* This = reinterpret_cast<AudioOutputWaveOut*>(dwInstance);
+            if (This->m_wakeUp)
+                This->m_wakeUp->Signal();
+        }
+    }
+}
+// namespace rePlayer
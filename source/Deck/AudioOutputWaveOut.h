@@ -0,0 +1,57 @@
+#pragma once
+
+#include "AudioOutput.h"
+
+// Windows
+#include <windows.h>
+#include <mmeapi.h>
+
+// stl
+#include <atomic>
+
+namespace rePlayer
+{
+    // the ring is split in blocks, each block is resubmitted as soon as waveOut is done with it and it has been rendered again
+    class AudioOutputWaveOut : public AudioOutput
+    {
+    public:
+        AudioOutputWaveOut() : AudioOutput(Type::kWaveOut) {}
+        ~AudioOutputWaveOut() override;
+
+        bool Open(StereoSample* ring, uint32_t numSamples, uint32_t sampleRate, thread::Semaphore* wakeUp) override;
+
+        void Pause() override;
+        void Resume() override;
+        void Reset() override;
+
+        uint64_t GetPosition() const override;
+
+        void Update(const Callback& callback) override;
+
+        uint32_t GetUpdatePeriod() const override;
+
+        // volume of the waveOut device, from 0 to 0xffff (the loudest side)
+        static uint32_t GetVolume();
+        static void SetVolume(uint32_t volume);
+
+    private:
+        static void CALLBACK OnWaveOut(HWAVEOUT hwo, UINT uMsg, DWORD_PTR dwInstance, DWORD_PTR dwParam1, DWORD_PTR dwParam2);
+
+    private:
+        static constexpr uint32_t kNumBlocks = 4;
+
+        HWAVEOUT m_outHandle{ nullptr };
+        WAVEHDR m_headers[kNumBlocks]{};
+
+        thread::Semaphore* m_wakeUp = nullptr;
+
+        uint32_t m_numSamples = 0;
+        uint32_t m_blockSize = 0;
+        uint32_t m_sampleRate = 0;
+
+        mutable std::atomic<uint64_t> m_lastPosition = 0;
+        uint64_t m_fillPos = 0;
+        uint64_t m_submitPos = 0;
+    };
+}
+// namespace rePlayer
@@ -130,6 +130,7 @@ namespace rePlayer
 
     void Deck::OnNewPlaylist()
     {
+        Core::GetPlaylist().CancelPreload();
         m_shelvedPlayer.Reset();
         m_nextPlayer.Reset();
         if (m_mode == Mode::Playlist)
@@ -334,6 +335,7 @@ namespace rePlayer
         m_currentMaxTextSize = 0.0f;
 
         // update the playback
+        FetchPreloadedSong();
         if (m_currentPlayer.IsValid())
         {
             // we do here some validation because the loaded song can have been updated/deleted...
@@ -346,7 +348,7 @@ namespace rePlayer
             if (m_shelvedPlayer.IsValid() && (m_shelvedPlayer->GetSubsong().isDiscarded || m_shelvedPlayer->GetMediaType() != m_shelvedPlayer->GetSong()->type || m_shelvedPlayer->GetId() != playlist.GetCurrentEntry()))
             {
                 m_shelvedPlayer = playlist.LoadCurrentSong();
-                m_nextPlayer = playlist.LoadNextSong(false);
+                PreloadNextSong(false);
             }
 
             // 2 - check solo vs playlist
@@ -364,7 +366,7 @@ namespace rePlayer
                         m_mode = Mode::Playlist;
                         m_currentPlayer = std::move(m_shelvedPlayer);
                         if (m_nextPlayer.IsValid() && (m_nextPlayer->GetSubsong().isDiscarded || m_nextPlayer->GetMediaType() != m_nextPlayer->GetSong()->type))
-                            m_nextPlayer = playlist.LoadNextSong(false);
+                            PreloadNextSong(false);
                         hasChanged = true;
                     }
                     else
@@ -374,11 +376,11 @@ namespace rePlayer
             else if (m_currentPlayer->GetSubsong().isDiscarded || m_currentPlayer->GetMediaType() != m_currentPlayer->GetSong()->type || m_currentPlayer->GetId() != playlist.GetCurrentEntry())
             {
                 m_currentPlayer = playlist.LoadCurrentSong();
-                m_nextPlayer = playlist.LoadNextSong(false);
+                PreloadNextSong(false);
                 hasChanged = true;
             }
             else if (m_nextPlayer.IsValid() && (m_nextPlayer->GetSubsong().isDiscarded || m_nextPlayer->GetMediaType() != m_nextPlayer->GetSong()->type))
-                m_nextPlayer = playlist.LoadNextSong(false);
+                PreloadNextSong(false);
             // we could validate here, but we might spam the servers if we move entries in the playlist
             //else
             //    ValidateNextSong();
@@ -719,7 +721,7 @@ namespace rePlayer
         if (m_currentPlayer.IsValid())
         {
             m_mode = Mode::Playlist;
-            m_nextPlayer = Core::GetPlaylist().LoadNextSong(false);
+            PreloadNextSong(false);
         }
         Player::SetVolume(m_volume, m_volumeCurve == VolumeCurve::Logarithmic);
 
@@ -804,7 +806,7 @@ namespace rePlayer
         {
             std::swap(m_currentPlayer, m_nextPlayer);
             Play();
-            m_nextPlayer = Core::GetPlaylist().LoadNextSong(true);
+            PreloadNextSong(true);
         }
         else
         {
@@ -816,12 +818,27 @@ namespace rePlayer
 
     void Deck::ValidateNextSong()
     {
+        FetchPreloadedSong();
         if (m_mode == Mode::Solo && m_shelvedPlayer.IsValid())
             Core::GetPlaylist().ValidateNextSong(m_nextPlayer);
         else if (m_mode == Mode::Playlist && m_currentPlayer.IsValid())
             Core::GetPlaylist().ValidateNextSong(m_nextPlayer);
     }
 
+    void Deck::PreloadNextSong(bool isAdvancing)
+    {
+        m_nextPlayer.Reset();
+        Core::GetPlaylist().PreloadNextSong(isAdvancing);
+    }
+
+    void Deck::FetchPreloadedSong()
+    {
+        // swap in the next song once the workers are done with it
+        auto player = Core::GetPlaylist().GetPreloadedSong();
+        if (player.IsValid())
+            m_nextPlayer = std::move(player);
+    }
+
     void Deck::Play(Tracking isTrackingEnabled)
     {
         if (m_currentPlayer.IsValid())
@@ -90,6 +90,8 @@ namespace rePlayer
         void PlayPreviousSong();
         void PlayNextSong();
         void ValidateNextSong();
+        void PreloadNextSong(bool isAdvancing);
+        void FetchPreloadedSong();
 
         void Play(Tracking isTrackingEnabled = Tracking::IsEnabled);
 
@@ -9,6 +9,7 @@
 #include <Graphics/Graphics.h>
 #include <RePlayer/Core.h>
 
+#include "AudioOutput.h"
 #include "Player.h"
 
 // TagLib
@@ -18,9 +19,6 @@
 
 // Windows
 #include <windows.h>
-#include <mmeapi.h>
-#include <Mmreg.h>
-#pragma comment(lib, "winmm.lib")
 
 // stl
 #include <atomic>
@@ -29,26 +27,91 @@
 
 namespace rePlayer
 {
-    struct Player::Wave
+    // gain ramp of the fade out, it stops after silenceRate silent samples in a row (returns the number of samples kept)
+    static uint32_t FadeOut(StereoSample* samples, uint32_t numSamples, float gain, float gainStep, uint32_t& silence, uint32_t silenceRate)
     {
-        HWAVEOUT outHandle{ nullptr };
-        WAVEHDR header{};
-    };
+        static constexpr float kEpsilon = 1.0f / 32767.0f;
+        auto isSilenceOver = [&silence, silenceRate](bool isSilent)
+        {
+            silence = isSilent ? silence + 1 : 0;
+            return silence >= silenceRate;
+        };
+
+        uint32_t i = 0;
+#if CORE_AUDIO_SSE2
+        auto vGain = _mm_set1_ps(gain);
+        auto vGainStep = _mm_set1_ps(gainStep);
+        auto vOffsets = _mm_setr_ps(0.0f, 0.0f, 1.0f, 1.0f);
+        auto vEpsilon = _mm_set1_ps(kEpsilon);
+        auto vAbsMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fFFffFF));
+        for (; i + 2 <= numSamples; i += 2)
+        {
+            auto gains = _mm_sub_ps(vGain, _mm_mul_ps(_mm_add_ps(_mm_set1_ps(float(i)), vOffsets), vGainStep));
+            auto s = _mm_mul_ps(_mm_loadu_ps(&samples[i].left), gains);
+            _mm_storeu_ps(&samples[i].left, s);
+            auto isSilent = _mm_movemask_ps(_mm_cmplt_ps(_mm_and_ps(s, vAbsMask), vEpsilon));
+            if (isSilenceOver((isSilent & 3) == 3))
+                return i + 1;
+            if (isSilenceOver((isSilent & 12) == 12))
+                return i + 2;
+        }
+#endif
+        for (; i < numSamples; i++)
+        {
+            auto s = samples[i] * (gain - i * gainStep);
+            samples[i] = s;
+            if (isSilenceOver(fabsf(s.left) < kEpsilon && fabsf(s.right) < kEpsilon))
+                return i + 1;
+        }
+        return numSamples;
+    }
+
+    static void SummarizeBlock(const StereoSample* samples, uint32_t numSamples, StereoSample& sumSquares, float& peak)
+    {
+        sumSquares = { 0.0f, 0.0f };
+        peak = 0.0f;
+        uint32_t i = 0;
+#if CORE_AUDIO_SSE2
+        auto vSum = _mm_setzero_ps();
+        auto vPeak = _mm_setzero_ps();
+        auto vAbsMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fFFffFF));
+        for (; i + 2 <= numSamples; i += 2)
+        {
+            auto s = _mm_loadu_ps(&samples[i].left);
+            vSum = _mm_add_ps(vSum, _mm_mul_ps(s, s));
+            vPeak = _mm_max_ps(vPeak, _mm_and_ps(s, vAbsMask));
+        }
+        alignas(16) float sums[4];
+        alignas(16) float peaks[4];
+        _mm_store_ps(sums, vSum);
+        _mm_store_ps(peaks, vPeak);
+        sumSquares = { sums[0] + sums[2], sums[1] + sums[3] };
+        peak = Max(Max(peaks[0], peaks[1]), Max(peaks[2], peaks[3]));
+#endif
+        for (; i < numSamples; i++)
+        {
+            sumSquares.left += samples[i].left * samples[i].left;
+            sumSquares.right += samples[i].right * samples[i].right;
+            peak = Max(peak, Max(fabsf(samples[i].left), fabsf(samples[i].right)));
+        }
+    }
 
-    SmartPtr<Player> Player::Create(MusicID id, SongSheet* song, Replay* replay, io::Stream* stream, bool isExport)
+    SmartPtr<Player> Player::Create(MusicID id, SongSheet* song, Replay* replay, io::Stream* stream, bool isExport, AudioOutput* output)
     {
         if (replay)
         {
             SmartPtr<Player> player(kAllocate, id, song, replay);
-            if (player->Init(stream, isExport))
+            if (player->Init(stream, isExport, output))
                 return nullptr;
             return player;
         }
+        delete output;
         return nullptr;
     }
 
     void Player::Play()
     {
+        WaitSeek();
         if (m_replay->IsStreaming() && !m_song->subsongs[m_id.subsongId.index].isPlayed)
         {
             m_song->subsongs[m_id.subsongId.index].isPlayed = true;
@@ -57,7 +120,7 @@ namespace rePlayer
         if (m_status == Status::Paused)
         {
             m_status = Status::Playing;
-            waveOutRestart(m_wave->outHandle);
+            m_output->Resume();
             ResumeThread();
             thread::KeepAwake(true);
         }
@@ -67,8 +130,6 @@ namespace rePlayer
             m_songSeek = 0;
             m_songPos = 0;
             m_songEnd = ~0ull;
-            m_wavePlayPos = 0;
-            m_waveFillPos = m_numSamples;
             m_patternsPos = 0;
 
             m_numLoops = m_replay->CanLoop() ? Core::GetDeck().IsEndless() ? INT_MAX : GetSubsong().state == SubsongState::Loop ? 1 : 0 : 0;
@@ -78,10 +139,10 @@ namespace rePlayer
 
             m_replay->ResetPlayback();
             m_replay->ApplySettings(m_song->metadata.Container());
+            m_replay->ResetVisuals();
+            m_visualsPos = 0;
 
-            Render(m_numSamples, 0);
-
-            waveOutWrite(m_wave->outHandle, &m_wave->header, sizeof(m_wave->header));
+            m_output->Update([this](uint32_t numSamples, uint32_t waveFillPos) { Render(numSamples, waveFillPos); });
             ResumeThread();
             thread::KeepAwake(true);
         }
@@ -89,9 +150,10 @@ namespace rePlayer
 
     void Player::Pause()
     {
+        WaitSeek();
         if (m_status == Status::Playing)
         {
-            waveOutPause(m_wave->outHandle);
+            m_output->Pause();
             SuspendThread();
             m_status = Status::Paused;
             thread::KeepAwake(false);
@@ -100,59 +162,63 @@ namespace rePlayer
 
     void Player::Stop()
     {
+        WaitSeek();
         if (!IsStopped())
         {
-            waveOutPause(m_wave->outHandle);
+            m_output->Pause();
             if (m_status == Status::Playing)
             {
                 SuspendThread();
                 thread::KeepAwake(false);
             }
             m_status = Status::Stopped;
-            waveOutReset(m_wave->outHandle);
+            m_output->Reset();
             m_songSeek = 0;
         }
     }
 
     void Player::Seek(uint32_t timeInMs)
     {
-        if (!IsStopped() && m_replay->IsSeekable())
+        WaitSeek();
+        if (!IsStopped() && IsSeekable())
         {
             m_hasSeeked = true;
 
-            waveOutPause(m_wave->outHandle);
+            m_output->Pause();
             if (m_status == Status::Playing)
                 SuspendThread();
-            waveOutReset(m_wave->outHandle);
+            m_output->Reset();
 
             m_songPos = 0;
             m_songEnd = ~0ull;
-            m_wavePlayPos = 0;
-            m_waveFillPos = m_numSamples;
             m_patternsPos = 0;
 
             m_numLoops = m_replay->CanLoop() ? Core::GetDeck().IsEndless() ? INT_MAX : GetSubsong().state == SubsongState::Loop ? 1 : 0 : 0;
             m_remainingFadeOut = m_replay->GetSampleRate() * 4;
             m_fadeOutSilence = 0;
 
-            timeInMs = m_replay->Seek(timeInMs);
-            Render(m_numSamples, 0);
-
-            if (m_status == Status::Paused)
-                waveOutPause(m_wave->outHandle);
-            waveOutWrite(m_wave->outHandle, &m_wave->header, sizeof(m_wave->header));
-            if (m_status == Status::Playing)
-                ResumeThread();
-
-            int64_t seekPos = m_replay->GetSampleRate();
-            seekPos *= timeInMs;
-            m_songSeek = uint32_t(seekPos / 1000);
+            if (m_replay->IsSeekable())
+                EndSeek(m_replay->Seek(timeInMs));
+            else
+            {
+                // rendering up to the position can take a while, the ui keeps going (the playback stays suspended until EndSeek)
+                m_isSeeking = true;
+                Core::AddJob([This = SmartPtr<Player>(this), timeInMs]()
+                {
+                    This->m_seekTimeInMs = This->SeekByRendering(timeInMs);
+                    Core::FromJob([This]()
+                    {
+                        This->WaitSeek();
+                    });
+                }, &m_seekJob);
+            }
         }
     }
 
     void Player::SetSubsong(uint16_t subsongIndex)
     {
         Stop();
+        ClearCheckpoints();
         m_id.subsongId.index = subsongIndex;
         m_replay->SetSubsong(subsongIndex);
         Play();
@@ -163,15 +229,11 @@ namespace rePlayer
         if (m_status == Status::Playing)
         {
             auto songEnd = m_songEnd;
-            MMTIME mmt{};
-            mmt.wType = TIME_BYTES;
-            waveOutGetPosition(m_wave->outHandle, &mmt, sizeof(MMTIME));
-
-            mmt.u.cb /= sizeof(StereoSample);
-            if (mmt.u.cb >= songEnd)
+            auto wavePlayPos = m_output->GetPosition();
+            if (wavePlayPos >= songEnd)
                 return EndingState::kEnded;
-            mmt.u.cb += (uint64_t(timeRangeInMs) * m_replay->GetSampleRate()) / 1000;
-            if (mmt.u.cb >= songEnd)
+            wavePlayPos += (uint64_t(timeRangeInMs) * m_replay->GetSampleRate()) / 1000;
+            if (wavePlayPos >= songEnd)
                 return EndingState::kEnding;
         }
         return EndingState::kNotEnding;
@@ -179,15 +241,11 @@ namespace rePlayer
 
     uint32_t Player::GetPlaybackTimeInMs() const
     {
-        if (m_wave->outHandle)
+        if (m_output)
         {
-            MMTIME mmt{};
-            mmt.wType = TIME_BYTES;
-            waveOutGetPosition(m_wave->outHandle, &mmt, sizeof(MMTIME));
-
-            mmt.u.cb /= sizeof(StereoSample);
-            if (mmt.u.cb < m_songEnd)
-                return uint32_t((1000ull * (mmt.u.cb + m_songSeek)) / m_replay->GetSampleRate());
+            auto wavePlayPos = m_output->GetPosition();
+            if (wavePlayPos < m_songEnd)
+                return uint32_t((1000ull * (wavePlayPos + m_songSeek)) / m_replay->GetSampleRate());
             return uint32_t((1000ull * (m_songEnd + m_songSeek)) / m_replay->GetSampleRate());
         }
         return 0;
@@ -247,48 +305,41 @@ namespace rePlayer
     Replay::Patterns Player::GetPatterns(uint32_t numLines, uint32_t charWidth, uint32_t spaceWidth, Replay::Patterns::Flags flags) const
     {
         Replay::Patterns patterns;
-        if (m_status != Status::Stopped)
+        if (m_status != Status::Stopped && !m_isSeeking)
         {
-            MMTIME mmt{};
-            mmt.wType = TIME_BYTES;
-            waveOutGetPosition(m_wave->outHandle, &mmt, sizeof(MMTIME));
-
-            mmt.u.cb /= sizeof(StereoSample);
-            patterns = m_replay->UpdatePatterns(mmt.u.cb - m_patternsPos, numLines, charWidth, spaceWidth, flags);
-            m_patternsPos = mmt.u.cb;
+            auto wavePlayPos = m_output->GetPosition();
+            m_replay->UpdateVisuals(wavePlayPos);
+            patterns = m_replay->UpdatePatterns(uint32_t(wavePlayPos) - m_patternsPos, numLines, charWidth, spaceWidth, flags);
+            m_patternsPos = uint32_t(wavePlayPos);
         }
         return patterns;
     }
 
     StereoSample Player::GetVuMeter() const
     {
-        if (m_status == Status::Stopped)
+        // the seek job is rendering in the ring
+        if (m_status == Status::Stopped || m_isSeeking)
             return { 0.0f, 0.0f };
 
         uint32_t numVuMeterSamples = 2 * m_replay->GetSampleRate() / 60;
 
-        MMTIME mmt{};
-        mmt.wType = TIME_BYTES;
-        waveOutGetPosition(m_wave->outHandle, &mmt, sizeof(MMTIME));
-        mmt.u.cb >>= 3;// / 2 channels / 4 bytes (32bit samples)
-        auto wavePlayPos = mmt.u.cb;
+        auto wavePlayPos = uint32_t(m_output->GetPosition());
         wavePlayPos += m_replay->GetSampleRate() / 30; // we should get our actual frame rate to guess the next 1 or 2 frames; here we are just predicting two frames at 60Hz
         wavePlayPos -= numVuMeterSamples / 2;
 
+        //Basic fake Vu Meter (todo, fft power), from the blocks covering the range
         StereoSample sum{ 0.0f, 0.0f };
-        auto numSamplesMask = m_numSamples - 1;
-        auto waveData = m_waveData;
-
-        //Basic fake Vu Meter (todo, fft power)
-        for (uint32_t i = 0; i < numVuMeterSamples; i++)
+        auto blockMask = m_numSamples / kSummarySize - 1;
+        auto block = wavePlayPos / kSummarySize;
+        auto numBlocks = (wavePlayPos % kSummarySize + numVuMeterSamples + kSummarySize - 1) / kSummarySize;
+        for (uint32_t i = 0; i < numBlocks; i++)
         {
-            auto pos = (wavePlayPos + i) & numSamplesMask;
-            auto v1 = waveData[pos].left;
-            auto v2 = waveData[pos].right;
-            sum.left += v1 * v1;
-            sum.right += v2 * v2;
+            auto& summary = m_waveSummaries[(block + i) & blockMask];
+            sum.left += summary.sumSquares.left;
+            sum.right += summary.sumSquares.right;
         }
-        return { sqrtf(sum.left / numVuMeterSamples), sqrtf(sum.right / numVuMeterSamples) };
+        auto numSummarySamples = float(numBlocks * kSummarySize);
+        return { sqrtf(sum.left / numSummarySamples), sqrtf(sum.right / numSummarySamples) };
     }
 
     void Player::DrawVisuals(float xMin, float yMin, float xMax, float yMax) const
@@ -299,16 +350,12 @@ namespace rePlayer
 
     void Player::DrawOscilloscope(float xMin, float yMin, float xMax, float yMax) const
     {
-        if (m_status != Status::Stopped)
+        if (m_status != Status::Stopped && !m_isSeeking)
         {
             ImDrawList* drawList = ImGui::GetWindowDrawList();
             auto color = 0x98D9B27A; // ImGui::GetColorU32(ImGuiCol_FrameBgActive);
 
-            MMTIME mmt{};
-            mmt.wType = TIME_BYTES;
-            waveOutGetPosition(m_wave->outHandle, &mmt, sizeof(MMTIME));
-            mmt.u.cb >>= 3;// / 2 channels / 4 bytes (32bit samples)
-            auto wavePlayPos = mmt.u.cb;
+            auto wavePlayPos = uint32_t(m_output->GetPosition());
             wavePlayPos += m_replay->GetSampleRate() / 30; // we should get our actual frame rate to guess the next 1 or 2 frames; here we are just predicting two frames at 60Hz
 
             uint32_t numOscilloscopeSamples = m_replay->GetSampleRate() / 100; // 10ms oscilloscope
@@ -432,13 +479,11 @@ namespace rePlayer
 
     uint32_t Player::GetVolume(bool isLogarithmic)
     {
-        DWORD value;
-        waveOutGetVolume(nullptr, &value);
-        value = Max(value & 0xffFF, value >> 16);
+        auto value = AudioOutput::GetVolume(AudioOutput::Type::kWaveOut);
         if (isLogarithmic)
         {
             const auto volume = logf(1000.0f * value / float(0xffFF)) / logf(1000.0f);
-            value = DWORD(volume * 0xffFF);
+            value = uint32_t(volume * 0xffFF);
         }
         return value;
     }
@@ -451,7 +496,7 @@ namespace rePlayer
             auto value = Saturate(exp(logf(1000.0f) * volume / float(0xffFF)) / 1000.0f);
             volume = uint32_t(value * 0xffFF);
         }
-        waveOutSetVolume(nullptr, volume | (volume << 16));
+        AudioOutput::SetVolume(AudioOutput::Type::kWaveOut, volume);
     }
 
     void Player::EnableEndless(bool isEnabled)
@@ -464,7 +509,6 @@ namespace rePlayer
         : m_id(id)
         , m_song(song)
         , m_replay(replay)
-        , m_wave(new Wave())
         , m_numSamples(1 << (32 - std::countl_zero(replay->GetSampleRate())))
     {}
 
@@ -477,39 +521,25 @@ namespace rePlayer
         while (!std::atomic_ref(m_isJobDone).load())
             thread::Sleep(0);
 
-        if (m_wave->outHandle)
-            waveOutClose(m_wave->outHandle);
-
+        delete m_output;
         delete m_replay;
-        delete m_wave;
         delete[] m_waveData;
+        delete[] m_waveSummaries;
     }
 
-    bool Player::Init(io::Stream* stream, bool isExport)
+    bool Player::Init(io::Stream* stream, bool isExport, AudioOutput* output)
     {
-        WAVEFORMATEX waveFormat{};
-        waveFormat.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
-        waveFormat.nChannels = 2;
-        waveFormat.wBitsPerSample = 32;
-        waveFormat.nBlockAlign = waveFormat.nChannels * waveFormat.wBitsPerSample / 8;
-        waveFormat.nSamplesPerSec = m_replay->GetSampleRate();
-        waveFormat.nAvgBytesPerSec = waveFormat.nSamplesPerSec * waveFormat.nBlockAlign;
-        waveFormat.cbSize = 0;
-
-        if (!isExport && waveOutOpen(&m_wave->outHandle, WAVE_MAPPER, &waveFormat, 0, 0, 0) != S_OK)
-            return true;
+        // export is rendering by itself, so it doesn't need a real output
+        if (output == nullptr)
+            output = AudioOutput::Create(isExport ? AudioOutput::Type::kNull : AudioOutput::Type::kWaveOut);
+        m_output = output;
 
         auto numSamples = m_numSamples;
         m_waveData = new StereoSample[numSamples];
+        m_waveSummaries = new WaveSummary[numSamples / kSummarySize]();
 
-        m_wave->header.dwFlags = WHDR_BEGINLOOP | WHDR_ENDLOOP;
-        m_wave->header.lpData = reinterpret_cast<LPSTR>(m_waveData);
-        m_wave->header.dwBufferLength = static_cast<uint32_t>(numSamples * sizeof(StereoSample));
-        m_wave->header.dwBytesRecorded = 0;
-        m_wave->header.dwUser = 0;
-        m_wave->header.dwLoops = 0xffFFffFF;
-        if (!isExport)
-            waveOutPrepareHeader(m_wave->outHandle, &m_wave->header, sizeof(m_wave->header));
+        if (output->Open(m_waveData, numSamples, m_replay->GetSampleRate(), &m_semaphore))
+            return true;
 
         SongSheet* song = m_song;
         m_replay->SetSubsong(m_id.subsongId.index);
@@ -521,12 +551,8 @@ namespace rePlayer
 
         if (!isExport)
         {
-            Render(m_numSamples, 0);
-            m_wavePlayPos = 0;
-            m_waveFillPos = m_numSamples;
-
-            waveOutPause(m_wave->outHandle);
-            waveOutWrite(m_wave->outHandle, &m_wave->header, sizeof(m_wave->header));
+            output->Pause();
+            output->Update([this](uint32_t numSamples, uint32_t waveFillPos) { Render(numSamples, waveFillPos); });
             m_status = Status::Paused;
 
             Core::AddJob([this]()
@@ -604,38 +630,16 @@ namespace rePlayer
 
     void Player::ThreadUpdate()
     {
-        const auto numSamples = m_numSamples;
-        const auto numSamplesMask = numSamples - 1;
+        auto updatePeriod = m_output->GetUpdatePeriod();
         while (std::atomic_ref(m_isRunning).load())
         {
             auto startTime = std::chrono::high_resolution_clock::now();
 
-            MMTIME mmt{};
-            mmt.wType = TIME_BYTES;
-            waveOutGetPosition(m_wave->outHandle, &mmt, sizeof(MMTIME));
-            mmt.u.cb /= sizeof(StereoSample);
-            auto wavePlayPos = mmt.u.cb;
-            auto waveFillPos = m_waveFillPos;
-            if (m_wavePlayPos > wavePlayPos) // loop or something wrong happened; need to detect when waveOut had a failure
-            {
-                m_songSeek += m_wavePlayPos; // simulate a seek to keep track of current time
-                waveFillPos = (waveFillPos & numSamplesMask) | (wavePlayPos & ~numSamplesMask);
-                waveFillPos += numSamples;
-            }
-            m_wavePlayPos = wavePlayPos;
-
-            wavePlayPos = wavePlayPos + numSamples;
-            while (waveFillPos < wavePlayPos)
-            {
-                auto count = Min(numSamples - (waveFillPos & numSamplesMask), wavePlayPos - waveFillPos);
-                Render(count, waveFillPos & numSamplesMask);
-                waveFillPos += count;
-            }
-
-            m_waveFillPos = waveFillPos;
+            // the output is pulling the samples it needs, then wakes us up through the semaphore when it needs more
+            m_output->Update([this](uint32_t numSamples, uint32_t waveFillPos) { Render(numSamples, waveFillPos); });
 
             auto timeSpent = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - startTime).count();
-            auto waitTime = std::atomic_ref(m_isWaiting).load() ? INFINITE : (timeSpent < 5) ? uint32_t(5 - timeSpent) : 0;
+            auto waitTime = std::atomic_ref(m_isWaiting).load() ? INFINITE : (timeSpent < updatePeriod) ? uint32_t(updatePeriod - timeSpent) : 0;
             std::atomic_ref(m_waitTime).store(waitTime);
             m_semaphore.Wait(waitTime);
             if (waitTime == INFINITE)
@@ -648,6 +652,10 @@ namespace rePlayer
     {
         auto subsongState = m_replay->CanLoop() ? GetSubsong().state : SubsongState::Standard;
         auto waveData = m_waveData;
+        auto renderPos = waveFillPos;
+        auto renderSize = numSamples;
+        auto visualsPos = m_visualsPos;
+        m_visualsPos += numSamples;
         uint32_t previousCount = 0xffFFffFF;
         while (numSamples)
         {
@@ -680,9 +688,11 @@ namespace rePlayer
 
                 m_songEnd = m_songPos;
                 memset(waveData + waveFillPos, 0, numSamples * sizeof(StereoSample));
+                Summarize(renderPos, renderSize);
                 return;
             }
 
+            m_replay->SetVisualsPosition(visualsPos + waveFillPos - renderPos);
             auto count = m_replay->Render(waveData + waveFillPos, numSamples);
             if (count == 0)
             {
@@ -695,17 +705,11 @@ namespace rePlayer
                         subsongState = SubsongState::Standard;
 
                         //detect the loop (last 0.125s skipping the last 2 frames at 50Hz)
-                        uint32_t mask = m_numSamples - 1;
-                        for (uint32_t i = Min(m_replay->GetSampleRate() / 25, m_numSamples), e = Min(m_replay->GetSampleRate() / 8, m_numSamples); i < e; i++)
-                        {
-                            auto pos = (waveFillPos - i - 1) & mask;
-
-                            if (fabsf(waveData[pos].left) > 0.01f || fabsf(waveData[pos].right) > 0.01f)
-                            {
-                                subsongState = SubsongState::Fadeout;
-                                break;
-                            }
-                        }
+                        Summarize(renderPos, waveFillPos - renderPos);
+                        auto s = Min(m_replay->GetSampleRate() / 25, m_numSamples);
+                        auto e = Min(m_replay->GetSampleRate() / 8, m_numSamples);
+                        if (s < e && GetPeak(waveFillPos - e, e - s) > 0.01f)
+                            subsongState = SubsongState::Fadeout;
 
                         //send message to the database to update the song
                         m_song->subsongs[m_id.subsongId.index].state = subsongState;
@@ -722,38 +726,15 @@ namespace rePlayer
                 if (m_numLoops < 0)
                 {
                     uint32_t fadeOutSize = Min(count, m_remainingFadeOut);
-                    float fadeOutRatio = m_fadeOutRatio;
-                    float fadeOut = m_remainingFadeOut * m_fadeOutRatio;
                     uint32_t silenceRate = m_replay->GetSampleRate() / 2;
-                    auto fadeOutSilence = m_fadeOutSilence;
-                    for (uint32_t i = 0; i < fadeOutSize; i++)
+                    auto numFadedSamples = FadeOut(waveData + waveFillPos, fadeOutSize, m_remainingFadeOut * m_fadeOutRatio, m_fadeOutRatio, m_fadeOutSilence, silenceRate);
+                    if (numFadedSamples < fadeOutSize)
                     {
-                        auto left = waveData[waveFillPos].left * fadeOut;
-                        auto right = waveData[waveFillPos].right * fadeOut;
-
-                        waveData[waveFillPos].left = left;
-                        waveData[waveFillPos].right = right;
-
-                        waveFillPos++;
-                        fadeOut += fadeOutRatio;
-
-                        static constexpr float kEpsilon = 1.0f / 32767.0f;
-                        if (fabsf(left) < kEpsilon && fabsf(right) < kEpsilon)
-                        {
-                            // to help reduce long silences
-                            fadeOutSilence++;
-                            if (fadeOutSilence >= silenceRate)
-                            {
-                                fadeOutSize = i + 1;
-                                m_remainingFadeOut = fadeOutSize;
-                                break;
-
-                            }
-                        }
-                        else
-                            fadeOutSilence = 0;
+                        // to help reduce long silences
+                        fadeOutSize = numFadedSamples;
+                        m_remainingFadeOut = fadeOutSize;
                     }
-                    m_fadeOutSilence = fadeOutSilence;
+                    waveFillPos += fadeOutSize;
 
                     if (fadeOutSize < count)
                     {
@@ -795,6 +776,153 @@ namespace rePlayer
             }
             previousCount = count;
         }
+        Summarize(renderPos, renderSize);
+    }
+
+    void Player::Summarize(uint32_t waveFillPos, uint32_t numSamples)
+    {
+        // refresh the whole blocks touched by the rendered samples
+        auto blockMask = m_numSamples / kSummarySize - 1;
+        auto block = waveFillPos / kSummarySize;
+        auto numBlocks = Min((waveFillPos % kSummarySize + numSamples + kSummarySize - 1) / kSummarySize, blockMask + 1);
+        for (; numBlocks; numBlocks--, block++)
+        {
+            auto& summary = m_waveSummaries[block & blockMask];
+            SummarizeBlock(m_waveData + (block & blockMask) * kSummarySize, kSummarySize, summary.sumSquares, summary.peak);
+        }
+    }
+
+    float Player::GetPeak(uint32_t wavePos, uint32_t numSamples) const
+    {
+        // whole blocks come from the summaries
+        auto mask = m_numSamples - 1;
+        float peak = 0.0f;
+        while (numSamples > 0)
+        {
+            wavePos &= mask;
+            if ((wavePos % kSummarySize) == 0 && numSamples >= kSummarySize)
+            {
+                peak = Max(peak, m_waveSummaries[wavePos / kSummarySize].peak);
+                wavePos += kSummarySize;
+                numSamples -= kSummarySize;
+            }
+            else
+            {
+                peak = Max(peak, Max(fabsf(m_waveData[wavePos].left), fabsf(m_waveData[wavePos].right)));
+                wavePos++;
+                numSamples--;
+            }
+        }
+        return peak;
+    }
+
+    uint32_t Player::SeekByRendering(uint32_t timeInMs)
+    {
+        uint64_t sampleRate = m_replay->GetSampleRate();
+        auto seekPos = (timeInMs * sampleRate) / 1000;
+
+        // restart from the closest checkpoint before the seek position, else from the start of the song
+        const Checkpoint* closestCheckpoint = nullptr;
+        for (auto& checkpoint : m_checkpoints)
+        {
+            if (checkpoint.pos > seekPos)
+                break;
+            closestCheckpoint = &checkpoint;
+        }
+        uint64_t pos = 0;
+        if (closestCheckpoint)
+        {
+            m_replay->RestoreSnapshot(closestCheckpoint->state);
+            pos = closestCheckpoint->pos;
+        }
+        else
+        {
+            m_replay->ResetPlayback();
+            m_replay->ApplySettings(m_song->metadata.Container());
+        }
+
+        // then render silently as fast as possible in the (paused) wave buffer, saving the checkpoints on the way
+        bool canSnapshot = m_replay->CanSnapshot();
+        auto checkpointInterval = sampleRate * m_checkpointInterval;
+        auto nextCheckpoint = (pos / checkpointInterval + 1) * checkpointInterval;
+        while (pos < seekPos)
+        {
+            auto numSamples = uint32_t(Min(uint64_t(m_numSamples), seekPos - pos, nextCheckpoint - pos));
+            auto count = m_replay->Render(m_waveData, numSamples);
+            if (count == 0) // end of the song
+                break;
+            pos += count;
+            if (pos >= nextCheckpoint)
+            {
+                if (canSnapshot)
+                    AddCheckpoint(pos);
+                checkpointInterval = sampleRate * m_checkpointInterval;
+                nextCheckpoint = (pos / checkpointInterval + 1) * checkpointInterval;
+            }
+        }
+        return uint32_t((pos * 1000) / sampleRate);
+    }
+
+    void Player::AddCheckpoint(uint64_t pos)
+    {
+        // a previous seek may already have saved the ones after
+        uint32_t index = 0;
+        while (index < m_checkpoints.NumItems() && m_checkpoints[index].pos < pos)
+            index++;
+        if (index < m_checkpoints.NumItems() && m_checkpoints[index].pos == pos)
+            return;
+
+        auto* checkpoint = m_checkpoints.Insert(index, Checkpoint{ pos });
+        m_replay->SaveSnapshot(checkpoint->state);
+        m_checkpointsSize += checkpoint->state.Size();
+
+        // over budget: keep one checkpoint out of two
+        while (m_checkpointsSize > kCheckpointBudget)
+        {
+            m_checkpointInterval *= 2;
+            auto checkpointInterval = uint64_t(m_replay->GetSampleRate()) * m_checkpointInterval;
+            m_checkpoints.RemoveIf([this, checkpointInterval](auto& checkpoint)
+            {
+                if ((checkpoint.pos % checkpointInterval) == 0)
+                    return false;
+                m_checkpointsSize -= checkpoint.state.Size();
+                return true;
+            });
+        }
+    }
+
+    void Player::ClearCheckpoints()
+    {
+        m_checkpoints.Clear();
+        m_checkpointsSize = 0;
+        m_checkpointInterval = kCheckpointInterval;
+    }
+
+    void Player::EndSeek(uint32_t timeInMs)
+    {
+        m_replay->ResetVisuals();
+        m_visualsPos = 0;
+
+        if (m_status == Status::Paused)
+            m_output->Pause();
+        m_output->Update([this](uint32_t numSamples, uint32_t waveFillPos) { Render(numSamples, waveFillPos); });
+        if (m_status == Status::Playing)
+            ResumeThread();
+
+        int64_t seekPos = m_replay->GetSampleRate();
+        seekPos *= timeInMs;
+        m_songSeek = uint32_t(seekPos / 1000);
+    }
+
+    void Player::WaitSeek()
+    {
+        // the seek job may still be rendering: everything touching the replay waits for it
+        if (m_isSeeking)
+        {
+            m_isSeeking = false; // WaitJobs runs the main thread jobs, the one queued by the seek job included
+            Core::WaitJobs(m_seekJob);
+            EndSeek(m_seekTimeInMs);
+        }
     }
 
     void Player::ResumeThread()
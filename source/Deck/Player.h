@@ -5,13 +5,18 @@
 #include <Database/Types/MusicID.h>
 #include <Replays/Replay.h>
 #include <Thread/Semaphore.h>
+#include <Thread/Workers.h>
 
 namespace rePlayer
 {
+    class AudioOutput;
+
     class Player : public RefCounted
     {
         friend class SmartPtr<Player>;
+        friend class Benchmark;
         friend class Export;
+        friend class LibraryAnalyzer;
     public:
         enum EndingState
         {
@@ -21,7 +26,8 @@ namespace rePlayer
         };
 
     public:
-        static SmartPtr<Player> Create(MusicID id, SongSheet* song, Replay* replay, io::Stream* stream, bool isExport = false);
+        // the player owns the output (a waveOut output is created if none is provided)
+        static SmartPtr<Player> Create(MusicID id, SongSheet* song, Replay* replay, io::Stream* stream, bool isExport = false, AudioOutput* output = nullptr);
 
         void Play();
         void Pause();
@@ -64,11 +70,18 @@ namespace rePlayer
         Player(MusicID id, SongSheet* song, Replay* replay);
         ~Player() override;
 
-        bool Init(io::Stream* stream, bool isExport);
+        bool Init(io::Stream* stream, bool isExport, AudioOutput* output);
 
         void ThreadUpdate();
 
         void Render(uint32_t numSamples, uint32_t waveFillPos);
+        void Summarize(uint32_t waveFillPos, uint32_t numSamples);
+        float GetPeak(uint32_t wavePos, uint32_t numSamples) const;
+        uint32_t SeekByRendering(uint32_t timeInMs);
+        void AddCheckpoint(uint64_t pos);
+        void ClearCheckpoints();
+        void EndSeek(uint32_t timeInMs);
+        void WaitSeek();
         void ResumeThread();
         void SuspendThread();
 
@@ -76,27 +89,41 @@ namespace rePlayer
         void DrawPatterns(float xMin, float yMin, float xMax, float yMax) const;
 
     private:
-        struct Wave;
-
         static constexpr uint32_t kCharWidth = 3;
         static constexpr uint32_t kCharHeight = 5;
+        static constexpr uint32_t kSummarySize = 256; // samples per block of m_waveSummaries
+        static constexpr uint32_t kCheckpointInterval = 5; // seconds
+        static constexpr uint64_t kCheckpointBudget = 64 * 1024 * 1024; // bytes of snapshots kept per player
+
+        struct Checkpoint
+        {
+            uint64_t pos;
+            Array<uint8_t> state;
+        };
+
+        // published by the render for each block of the ring, so the ui doesn't have to read the samples
+        struct WaveSummary
+        {
+            StereoSample sumSquares;
+            float peak;
+        };
 
     private:
         MusicID m_id;
         SmartPtr<SongSheet> m_song;
         Replay* m_replay;
 
-        Wave* m_wave = nullptr;
+        AudioOutput* m_output = nullptr;
 
         thread::Semaphore m_semaphore;
 
         StereoSample* m_waveData = nullptr;
+        WaveSummary* m_waveSummaries = nullptr;
         uint64_t m_songEnd = ~0ull;
         uint64_t m_songSeek = 0;
         uint64_t m_songPos = 0;
-        uint32_t m_wavePlayPos = 0;
-        uint32_t m_waveFillPos = 0;
         mutable uint32_t m_patternsPos = 0;
+        uint64_t m_visualsPos = 0; // samples rendered since the last reset of the output
         const uint32_t m_numSamples;
 
         int32_t m_numLoops = 0;
@@ -116,6 +143,15 @@ namespace rePlayer
             Playing
         } m_status;
 
+        thread::JobCounter m_seekJob; // SeekByRendering runs on a worker, the replay is left alone until it's done
+        uint32_t m_seekTimeInMs = 0;
+        bool m_isSeeking = false;
+
+        // replay snapshots saved by SeekByRendering, sorted by position; the interval doubles each time they go over the budget
+        Array<Checkpoint> m_checkpoints;
+        uint64_t m_checkpointsSize = 0;
+        uint32_t m_checkpointInterval = kCheckpointInterval;
+
         std::string m_extraInfo;
     };
 }
@@ -16,6 +16,8 @@ namespace rePlayer
 
     inline void Player::ApplySettings()
     {
+        WaitSeek();
+        ClearCheckpoints();
         m_replay->ApplySettings(m_song->metadata.Container());
     }
 
@@ -31,7 +33,8 @@ namespace rePlayer
 
     inline bool Player::IsSeekable() const
     {
-        return m_replay->IsSeekable();
+        // replays without Seek are seeked by rendering
+        return m_replay->IsSeekable() || !m_replay->IsStreaming();
     }
 
     inline MusicID Player::GetId() const
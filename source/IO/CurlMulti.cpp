@@ -0,0 +1,135 @@
+#include "CurlMulti.h"
+
+// Windows
+#include <windows.h>
+
+// stl
+#include <condition_variable>
+#include <thread>
+
+namespace rePlayer
+{
+    CurlMulti::CurlMulti()
+        : m_multi(curl_multi_init())
+    {
+        curl_multi_setopt(m_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        curl_multi_setopt(m_multi, CURLMOPT_MAX_HOST_CONNECTIONS, kMaxHostConnections);
+        curl_multi_setopt(m_multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, kMaxConnections);
+        curl_multi_setopt(m_multi, CURLMOPT_MAXCONNECTS, kMaxConnections);
+
+        m_thread = new std::thread([this]() { Run(); });
+#ifdef _WIN64
+        ::SetThreadDescription(m_thread->native_handle(), L"rePlayer Curl");
+#endif
+    }
+
+    CurlMulti::~CurlMulti()
+    {
+        m_isClosing.store(true);
+        curl_multi_wakeup(m_multi);
+        m_thread->join();
+        delete m_thread;
+
+        // whatever is left is aborted
+        Array<Request> requests;
+        m_mutex.lock();
+        requests.Swap(m_requests);
+        m_mutex.unlock();
+        for (auto& request : requests)
+        {
+            if (request.callback)
+                request.callback(CURLE_ABORTED_BY_CALLBACK);
+        }
+        while (m_transfers.IsNotEmpty())
+            Complete(m_transfers.Last().curl, CURLE_ABORTED_BY_CALLBACK);
+
+        curl_multi_cleanup(m_multi);
+    }
+
+    void CurlMulti::Add(CURL* curl, Callback&& callback)
+    {
+        m_mutex.lock();
+        m_requests.Add({ curl, std::move(callback) });
+        m_mutex.unlock();
+        curl_multi_wakeup(m_multi);
+    }
+
+    void CurlMulti::Cancel(CURL* curl)
+    {
+        m_mutex.lock();
+        m_requests.Add({ curl, nullptr });
+        m_mutex.unlock();
+        curl_multi_wakeup(m_multi);
+    }
+
+    CURLcode CurlMulti::Perform(CURL* curl)
+    {
+        // notified under the lock: the caller can't return (and release the result) before the curl thread is done with it
+        struct
+        {
+            std::mutex mutex;
+            std::condition_variable condition;
+            CURLcode curlCode = CURLE_OK;
+            bool isDone = false;
+        } result;
+        Add(curl, [&result](CURLcode curlCode)
+        {
+            std::scoped_lock lock(result.mutex);
+            result.curlCode = curlCode;
+            result.isDone = true;
+            result.condition.notify_one();
+        });
+
+        std::unique_lock lock(result.mutex);
+        result.condition.wait(lock, [&result]() { return result.isDone; });
+        return result.curlCode;
+    }
+
+    void CurlMulti::Run()
+    {
+        Array<Request> requests;
+        while (!m_isClosing.load())
+        {
+            m_mutex.lock();
+            requests.Swap(m_requests);
+            m_mutex.unlock();
+            for (auto& request : requests)
+            {
+                if (request.callback)
+                {
+                    curl_multi_add_handle(m_multi, request.curl);
+                    m_transfers.Add(std::move(request));
+                }
+                else
+                    Complete(request.curl, CURLE_ABORTED_BY_CALLBACK);
+            }
+            requests.Clear();
+
+            int numRunningTransfers = 0;
+            curl_multi_perform(m_multi, &numRunningTransfers);
+
+            int numMessages = 0;
+            while (auto* message = curl_multi_info_read(m_multi, &numMessages))
+            {
+                if (message->msg == CURLMSG_DONE)
+                    Complete(message->easy_handle, message->data.result);
+            }
+
+            // sleep until some socket activity, a curl timeout or a wakeup from Add/Cancel
+            curl_multi_poll(m_multi, nullptr, 0, 1000, nullptr);
+        }
+    }
+
+    void CurlMulti::Complete(CURL* curl, CURLcode curlCode)
+    {
+        auto* transfer = m_transfers.FindIf([curl](auto& transfer) { return transfer.curl == curl; });
+        if (transfer == nullptr) // cancelled after its completion
+            return;
+
+        curl_multi_remove_handle(m_multi, curl);
+        auto callback = std::move(transfer->callback);
+        m_transfers.RemoveAtFast(uint32_t(transfer - m_transfers.Items()));
+        callback(curlCode);
+    }
+}
+// namespace rePlayer
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Containers/Array.h>
+
+#include <curl/curl.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+namespace std
+{
+    class thread;
+}
+// namespace std
+
+namespace rePlayer
+{
+    using namespace core;
+
+    // all the transfers are driven by a single thread on a curl multi handle:
+    // the connections (and dns/tls sessions) are reused between the transfers, http/2 streams are multiplexed
+    // and the connections per host are capped, so the sources don't hammer the same server
+    class CurlMulti
+    {
+    public:
+        // called on the curl thread when the transfer is done, the handle can be added again from there (reconnection)
+        using Callback = std::function<void(CURLcode curlCode)>;
+
+        CurlMulti();
+        ~CurlMulti();
+
+        void Add(CURL* curl, Callback&& callback);
+        // the callback of a running transfer is called with CURLE_ABORTED_BY_CALLBACK
+        void Cancel(CURL* curl);
+
+        // blocking, same as curl_easy_perform (never from a callback)
+        CURLcode Perform(CURL* curl);
+
+    private:
+        // an empty callback is a cancel
+        struct Request
+        {
+            CURL* curl;
+            Callback callback;
+        };
+
+    private:
+        void Run();
+        void Complete(CURL* curl, CURLcode curlCode);
+
+    private:
+        CURLM* m_multi;
+        std::thread* m_thread;
+        std::atomic<bool> m_isClosing{ false };
+
+        std::mutex m_mutex;
+        Array<Request> m_requests; // from the other threads, in order (a cancel can be followed by the same handle added again)
+        Array<Request> m_transfers; // running, curl thread only
+
+        static constexpr long kMaxHostConnections = 6;
+        static constexpr long kMaxConnections = 32;
+    };
+}
+// namespace rePlayer
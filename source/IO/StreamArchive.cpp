@@ -12,6 +12,9 @@
 #include <libarchive/archive.h>
 #include <libarchive/archive_entry.h>
 
+// stl
+#include <algorithm>
+
 namespace rePlayer
 {
     SmartPtr<StreamArchive> StreamArchive::Create(const std::string& filename, bool isPackage)
@@ -26,20 +29,11 @@ namespace rePlayer
     {
         if (stream)
         {
-            SmartPtr<StreamArchive> archiveStream(kAllocate, stream, isPackage, nullptr);
-            if (archiveStream->m_stream)
+            SmartPtr<StreamArchive> archiveStream(kAllocate, stream, isPackage, nullptr, nullptr);
+            if (archiveStream->m_stream && archiveStream->FindEntry([](auto& entry) { return entry.isFile; }, 0))
             {
-                while (archive_read_next_header(archiveStream->m_archive, &archiveStream->m_entry) == ARCHIVE_OK)
-                {
-                    if (archive_entry_mode(archiveStream->m_entry) & _S_IFREG)
-                    {
-                        archiveStream->m_entryFilename = archive_entry_pathname(archiveStream->m_entry);
-                        archiveStream->m_entrySize = uint32_t(archive_entry_size(archiveStream->m_entry));
-                        archiveStream->AddFilename(archiveStream->m_entryFilename);
-                        return archiveStream;
-                    }
-                    archiveStream->m_entryIndex++;
-                }
+                archiveStream->AddFilename(archiveStream->m_entryFilename);
+                return archiveStream;
             }
         }
         return nullptr;
@@ -50,28 +44,29 @@ namespace rePlayer
         if (m_streamMemory.IsValid())
             return m_streamMemory->Read(buffer, size);
 
+        // never past the end of the entry: the block loader would reopen the archive and decompress it all again
+        // (without a size in the header, it reads up to the end of the data)
+        if (m_isEntrySizeSet)
+        {
+            auto entryPosition = uint64_t(m_entryPosition);
+            size = entryPosition < m_entrySize ? Min(size, m_entrySize - entryPosition) : 0;
+        }
+
         auto* dest = reinterpret_cast<uint8_t*>(buffer);
-        auto sizeLeft = int64_t(size);
+        auto sizeLeft = size;
         while (sizeLeft > 0)
         {
-            auto remainingSize = int64_t(m_entryDataBlockSize) - m_entryDataBlockPosition;
-            if (remainingSize == 0)
+            auto position = uint64_t(m_entryPosition);
+            if (position < m_blockPosition || position - m_blockPosition >= m_block.NumItems<uint64_t>())
             {
-                la_int64_t dataBlockOffset;
-                if (archive_read_data_block(m_archive, (const void**)&m_entryDataBlock, &m_entryDataBlockSize, &dataBlockOffset) != ARCHIVE_OK)
-                {
-                    m_entryDataBlockSize = 0;
-                    m_entryDataBlockPosition = 0;
-                    return size - sizeLeft;
-                }
-                remainingSize = m_entryDataBlockSize;
-                m_entryDataBlockPosition = 0;
+                if (!LoadBlock(position))
+                    break;
             }
-            auto sizeToCopy = Min(sizeLeft, remainingSize);
-            memcpy(dest, m_entryDataBlock + m_entryDataBlockPosition, size_t(sizeToCopy));
+            auto blockOffset = position - m_blockPosition;
+            auto sizeToCopy = Min(sizeLeft, m_block.NumItems<uint64_t>() - blockOffset);
+            memcpy(dest, m_block.Items(blockOffset), size_t(sizeToCopy));
             dest += sizeToCopy;
             m_entryPosition += sizeToCopy;
-            m_entryDataBlockPosition += sizeToCopy;
             sizeLeft -= sizeToCopy;
         }
 
@@ -83,45 +78,21 @@ namespace rePlayer
         if (m_streamMemory.IsValid())
             return m_streamMemory->Seek(offset, whence);
 
-        auto position = m_entryPosition;
         switch (whence)
         {
         case kSeekBegin:
             break;
         case kSeekCurrent:
-            offset = position + offset;
+            offset = m_entryPosition + offset;
             break;
         case kSeekEnd:
             offset = m_entrySize + offset;
         }
-        if (position > offset)
-        {
-            ReOpen();
-            position = 0;
-        }
-
-        while (position < offset)
-        {
-            auto remainingSize = int64_t(m_entryDataBlockSize) - m_entryDataBlockPosition;
-            if (remainingSize == 0)
-            {
-                la_int64_t dataBlockOffset;
-                if (archive_read_data_block(m_archive, (const void**)&m_entryDataBlock, &m_entryDataBlockSize, &dataBlockOffset) != ARCHIVE_OK)
-                {
-                    m_entryDataBlockSize = 0;
-                    m_entryDataBlockPosition = 0;
-                    m_entryPosition = position;
-                    return Status::kFail;
-                }
-                remainingSize = m_entryDataBlockSize;
-                m_entryDataBlockPosition = 0;
-            }
-            auto size = Min(offset - position, remainingSize);
-            position += size;
-            m_entryDataBlockPosition += size;
-        }
-        m_entryPosition = position;
+        if (offset < 0 || (m_isEntrySizeSet && uint64_t(offset) > m_entrySize))
+            return Status::kFail;
 
+        // the data is decompressed (or fetched from the cache) on the next read
+        m_entryPosition = offset;
         return Status::kOk;
     }
 
@@ -147,22 +118,18 @@ namespace rePlayer
         return data;
     }
 
-    StreamArchive::StreamArchive(io::Stream* stream, bool isPackage, io::Stream* root)
+    StreamArchive::StreamArchive(io::Stream* stream, bool isPackage, io::Stream* root, Index* index)
         : io::Stream(root)
         , m_stream(stream)
-        , m_archive(archive_read_new())
+        , m_index(index)
         , m_isPackage(isPackage)
     {
-        stream->Seek(0, kSeekBegin);
+        if (index)
+            return;
 
-        archive_read_support_filter_all(m_archive);
-        archive_read_support_format_all(m_archive);
-
-        archive_read_set_read_callback(m_archive, reinterpret_cast<archive_read_callback*>(ArchiveRead));
-        archive_read_set_seek_callback(m_archive, reinterpret_cast<archive_seek_callback*>(ArchiveSeek));
-        archive_read_set_skip_callback(m_archive, reinterpret_cast<archive_skip_callback*>(ArchiveSkip));
-        archive_read_set_callback_data(m_archive, this);
-        if (archive_read_open1(m_archive) == ARCHIVE_OK)
+        // first stream of the archive: make sure it can be opened
+        m_index.New();
+        if (OpenArchive())
         {
             // maybe we added a magic header at the end of the file
             auto position = stream->GetPosition();
@@ -177,7 +144,7 @@ namespace rePlayer
                     || (buf[i] >= '0' && buf[i] <= '9')))
                     return;
             }
-            m_comments.assign(buf, buf + 8);
+            m_index->comments.assign(buf, buf + 8);
         }
         else
             m_stream.Reset();
@@ -185,46 +152,29 @@ namespace rePlayer
 
     StreamArchive::~StreamArchive()
     {
-        archive_read_free(m_archive);
+        if (m_archive)
+            archive_read_free(m_archive);
     }
 
     SmartPtr<io::Stream> StreamArchive::OnOpen(const std::string& filename)
     {
-        SmartPtr<StreamArchive> stream(kAllocate, m_stream->Clone(), m_isPackage, GetRoot());
-        if (stream->m_stream.IsValid())
-        {
-            while (archive_read_next_header(stream->m_archive, &stream->m_entry) == ARCHIVE_OK)
-            {
-                auto* entryName = archive_entry_pathname(stream->m_entry);
-                if (_stricmp(entryName, filename.c_str()) == 0)
-                {
-                    stream->m_entryFilename = entryName;
-                    stream->m_entrySize = uint32_t(archive_entry_size(stream->m_entry));
-                    return stream;
-                }
-                stream->m_entryIndex++;
-            }
-        }
+        SmartPtr<StreamArchive> stream(kAllocate, m_stream->Clone(), m_isPackage, GetRoot(), m_index);
+        if (stream->m_stream.IsValid() && stream->FindEntry([&filename](auto& entry) { return _stricmp(entry.name.c_str(), filename.c_str()) == 0; }, 0))
+            return stream;
         return nullptr;
     }
 
     SmartPtr<io::Stream> StreamArchive::OnClone()
     {
-        SmartPtr<StreamArchive> stream(kAllocate, m_stream->Clone(), m_isPackage, GetRoot());
+        SmartPtr<StreamArchive> stream(kAllocate, m_stream->Clone(), m_isPackage, GetRoot(), m_index);
         if (stream->m_stream.IsValid())
         {
             if (m_streamMemory.IsValid())
                 stream->m_streamMemory = m_streamMemory->Clone();
-            while (archive_read_next_header(stream->m_archive, &stream->m_entry) == ARCHIVE_OK)
-            {
-                if (stream->m_entryIndex == m_entryIndex)
-                {
-                    stream->m_entryFilename = m_entryFilename;
-                    stream->m_entrySize = m_entrySize;
-                    return stream;
-                }
-                stream->m_entryIndex++;
-            }
+            stream->m_entryFilename = m_entryFilename;
+            stream->m_entryIndex = m_entryIndex;
+            stream->m_entrySize = m_entrySize;
+            stream->m_isEntrySizeSet = m_isEntrySizeSet;
             return stream;
         }
         return nullptr;
@@ -234,27 +184,53 @@ namespace rePlayer
     {
         if (isForced || !m_isPackage)
         {
-            SmartPtr<StreamArchive> stream(kAllocate, m_stream->Clone(), m_isPackage, GetRoot());
-            if (stream->m_stream.IsValid())
+            SmartPtr<StreamArchive> stream(kAllocate, m_stream->Clone(), m_isPackage, GetRoot(), m_index);
+            if (stream->m_stream.IsValid() && stream->FindEntry([](auto& entry) { return entry.isFile; }, m_entryIndex + 1))
+                return stream;
+        }
+        return nullptr;
+    }
+
+    template <typename Predicate>
+    bool StreamArchive::FindEntry(Predicate&& predicate, uint32_t entryIndex)
+    {
+        for (;;)
+        {
+            // look in the index first, then read the headers nobody has read yet
             {
-                while (archive_read_next_header(stream->m_archive, &stream->m_entry) == ARCHIVE_OK)
+                thread::ScopedSpinLock lock(m_index->lock);
+                for (auto numEntries = m_index->entries.NumItems(); entryIndex < numEntries; entryIndex++)
                 {
-                    if (stream->m_entryIndex > m_entryIndex && archive_entry_mode(stream->m_entry) & _S_IFREG)
+                    auto& entry = m_index->entries[entryIndex];
+                    if (predicate(entry))
                     {
-                        stream->m_entryFilename = archive_entry_pathname(stream->m_entry);
-                        stream->m_entrySize = uint32_t(archive_entry_size(stream->m_entry));
-                        return stream;
+                        m_entryFilename = entry.name;
+                        m_entryIndex = entryIndex;
+                        m_entrySize = entry.size;
+                        m_isEntrySizeSet = entry.isSizeSet;
+                        return true;
                     }
-                    stream->m_entryIndex++;
                 }
+                if (m_index->isComplete)
+                    return false;
             }
+            if (m_archive == nullptr && !OpenArchive())
+                return false;
+            if (!ReadHeader())
+                return false;
         }
-        return nullptr;
     }
 
-    void StreamArchive::ReOpen()
+    bool StreamArchive::OpenArchive()
     {
-        archive_read_free(m_archive);
+        if (m_archive)
+            archive_read_free(m_archive);
+        m_archive = nullptr;
+        m_headerIndex = 0;
+        m_dataBlockIndex = 0;
+        m_dataPosition = 0;
+        if (m_stream.IsInvalid())
+            return false;
 
         m_archive = archive_read_new();
 
@@ -266,21 +242,179 @@ namespace rePlayer
         archive_read_set_skip_callback(m_archive, reinterpret_cast<archive_skip_callback*>(ArchiveSkip));
         archive_read_set_callback_data(m_archive, this);
 
-        m_entryPosition = 0;
-        m_entryDataBlockSize = 0;
-        m_entryDataBlockPosition = 0;
-
+        m_cache.Resize(kCacheSize);
         m_stream->Seek(0, kSeekBegin);
-        archive_read_open1(m_archive);
-        for (uint32_t i = 0; i <= m_entryIndex; i++)
-            archive_read_next_header(m_archive, &m_entry);
+        if (archive_read_open1(m_archive) != ARCHIVE_OK)
+        {
+            archive_read_free(m_archive);
+            m_archive = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    bool StreamArchive::ReadHeader()
+    {
+        auto isOk = archive_read_next_header(m_archive, &m_entry) == ARCHIVE_OK;
+
+        thread::ScopedSpinLock lock(m_index->lock);
+        if (m_headerIndex == m_index->entries.NumItems())
+        {
+            if (!isOk)
+                m_index->isComplete = true;
+            else
+            {
+                auto* name = archive_entry_pathname(m_entry);
+                auto isSizeSet = archive_entry_size_is_set(m_entry) != 0;
+                m_index->entries.Add({ .name = name ? name : "", .size = isSizeSet ? uint64_t(archive_entry_size(m_entry)) : 0, .isSizeSet = isSizeSet, .isFile = (archive_entry_mode(m_entry) & _S_IFREG) != 0 });
+            }
+        }
+        if (isOk)
+        {
+            m_headerIndex++;
+            m_dataBlockIndex = 0;
+            m_dataPosition = 0;
+        }
+        return isOk;
+    }
+
+    bool StreamArchive::LoadBlock(uint64_t position)
+    {
+        auto entryKey = uint64_t(m_entryIndex) << 32;
+        {
+            thread::ScopedSpinLock lock(m_index->lock);
+            auto& blockEnds = m_index->entries[m_entryIndex].blockEnds;
+            auto* blockEnd = std::upper_bound(blockEnds.begin(), blockEnds.end(), position);
+            if (blockEnd != blockEnds.end())
+            {
+                auto blockIndex = uint32_t(blockEnd - blockEnds.begin());
+                if (auto* slot = m_index->blockSlots.FindItemByKey(entryKey | blockIndex))
+                {
+                    auto& block = m_index->blocks[*slot];
+                    block.lastUse = ++m_index->clock;
+                    m_block.Clear();
+                    m_block.Add(block.data.Items(), block.data.NumItems());
+                    m_blockPosition = blockIndex > 0 ? blockEnds[blockIndex - 1] : 0;
+                    return true;
+                }
+            }
+        }
+
+        // not in the cache: decompress, from the start of the archive only when the data is behind
+        if (m_archive == nullptr || m_headerIndex != m_entryIndex + 1 || m_dataPosition > position)
+        {
+            if (!OpenArchive())
+                return false;
+            while (m_headerIndex <= m_entryIndex)
+            {
+                if (!ReadHeader())
+                    return false;
+            }
+        }
+        for (;;)
+        {
+            const void* data = nullptr;
+            size_t size = 0;
+            la_int64_t dataBlockOffset = 0;
+            auto result = archive_read_data_block(m_archive, &data, &size, &dataBlockOffset);
+            if (result != ARCHIVE_OK && result != ARCHIVE_EOF)
+                return false;
+
+            // sparse entries: the holes between the data blocks (and up to the end of the entry) are zeros
+            uint64_t holeSize = 0;
+            if (result == ARCHIVE_EOF)
+            {
+                size = 0;
+                if (!m_isEntrySizeSet)
+                {
+                    SetEntrySize(m_dataPosition);
+                    return false;
+                }
+                if (m_dataPosition >= m_entrySize)
+                    return false;
+                holeSize = m_entrySize - m_dataPosition;
+            }
+            else if (uint64_t(dataBlockOffset) > m_dataPosition)
+                holeSize = uint64_t(dataBlockOffset) - m_dataPosition;
+
+            auto* blockData = reinterpret_cast<const uint8_t*>(data);
+            Array<uint8_t> sparseData;
+            if (holeSize > 0)
+            {
+                sparseData.Resize(uint32_t(holeSize));
+                memset(sparseData.Items(), 0, size_t(holeSize));
+                sparseData.Add(blockData, uint32_t(size));
+                blockData = sparseData.Items();
+                size = sparseData.NumItems();
+            }
+
+            auto blockPosition = m_dataPosition;
+            m_dataPosition += size;
+            CacheBlock(m_dataBlockIndex++, blockData, size);
+            if (position < m_dataPosition)
+            {
+                m_block.Clear();
+                m_block.Add(blockData, uint32_t(size));
+                m_blockPosition = blockPosition;
+                return true;
+            }
+        }
+    }
+
+    void StreamArchive::SetEntrySize(uint64_t size)
+    {
+        // found at the end of the data, for this stream and the ones opened after
+        m_entrySize = size;
+        m_isEntrySizeSet = true;
+
+        thread::ScopedSpinLock lock(m_index->lock);
+        auto& entry = m_index->entries[m_entryIndex];
+        entry.size = size;
+        entry.isSizeSet = true;
+    }
+
+    void StreamArchive::CacheBlock(uint32_t blockIndex, const uint8_t* data, size_t size)
+    {
+        auto key = (uint64_t(m_entryIndex) << 32) | blockIndex;
+
+        thread::ScopedSpinLock lock(m_index->lock);
+        auto& blockEnds = m_index->entries[m_entryIndex].blockEnds;
+        if (blockIndex == blockEnds.NumItems())
+            blockEnds.Add(m_dataPosition);
+        if (size == 0 || m_index->blockSlots.FindItemByKey(key))
+            return;
+
+        // evict the least recently used blocks
+        auto& blocks = m_index->blocks;
+        while (m_index->blocksSize + size > kMaxCachedBlocksSize && blocks.IsNotEmpty())
+        {
+            uint32_t oldest = 0;
+            for (uint32_t i = 1, numBlocks = blocks.NumItems(); i < numBlocks; i++)
+            {
+                if (blocks[i].lastUse < blocks[oldest].lastUse)
+                    oldest = i;
+            }
+            m_index->blocksSize -= blocks[oldest].data.NumItems();
+            m_index->blockSlots.RemoveByKey(blocks[oldest].key);
+            auto lastIndex = blocks.NumItems() - 1;
+            if (oldest != lastIndex)
+            {
+                std::swap(blocks[oldest], blocks[lastIndex]);
+                m_index->blockSlots[blocks[oldest].key] = oldest;
+            }
+            blocks.Pop();
+        }
+
+        m_index->blockSlots[key] = blocks.NumItems();
+        blocks.Add({ .key = key, .lastUse = ++m_index->clock, .data = Array<uint8_t>(data, uint32_t(size)) });
+        m_index->blocksSize += size;
     }
 
     int64_t StreamArchive::ArchiveRead(struct archive* a, StreamArchive* stream, const void** buf)
     {
         (void)a;
-        *buf = stream->m_cache;
-        return int64_t(stream->m_stream->Read(stream->m_cache, kCacheSize));
+        *buf = stream->m_cache.Items();
+        return int64_t(stream->m_stream->Read(stream->m_cache.Items(), kCacheSize));
     }
 
     int64_t StreamArchive::ArchiveSeek(struct archive* a, StreamArchive* stream, int64_t request, int whence)
@@ -299,4 +433,4 @@ namespace rePlayer
         return skip;
     }
 }
-// namespace rePlayer
\ No newline at end of file
+// namespace rePlayer
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <Containers/HashMap.h>
 #include <IO/Stream.h>
+#include <Thread/SpinLock.h>
 
 struct archive;
 struct archive_entry;
@@ -24,22 +26,59 @@ namespace rePlayer
 
         [[nodiscard]] const std::string& GetName() const final { return m_entryFilename; }
 
-        [[nodiscard]] std::string GetComments() const final { return m_comments; }
+        [[nodiscard]] std::string GetComments() const final { return m_index->comments; }
 
         const Span<const uint8_t> Read() final;
 
     private:
-        static constexpr uint32_t kCacheSize = 4096;
+        static constexpr uint32_t kCacheSize = 65536;
+        static constexpr uint64_t kMaxCachedBlocksSize = 32 * 1024 * 1024;
+
+        // shared by all the streams opened from the same archive:
+        // the entries found so far and the last decompressed blocks (lru)
+        struct Index : public RefCounted
+        {
+            struct Entry
+            {
+                std::string name;
+                uint64_t size;
+                bool isSizeSet; // not all the formats store it in the header, it's known once the entry is decompressed
+                bool isFile;
+                Array<uint64_t> blockEnds; // end offset of each block decompressed so far
+            };
+            struct Block
+            {
+                uint64_t key; // entry index << 32 | block index
+                uint64_t lastUse;
+                Array<uint8_t> data;
+            };
+
+            thread::SpinLock lock;
+            Array<Entry> entries;
+            bool isComplete = false; // all the headers have been read
+            Array<Block> blocks;
+            HashMap<uint64_t, uint32_t> blockSlots; // key to index in blocks
+            uint64_t blocksSize = 0;
+            uint64_t clock = 0;
+            std::string comments;
+        };
 
     private:
-        StreamArchive(io::Stream* stream, bool isPackage, io::Stream* root);
+        StreamArchive(io::Stream* stream, bool isPackage, io::Stream* root, Index* index);
         ~StreamArchive() final;
 
         [[nodiscard]] SmartPtr<Stream> OnOpen(const std::string& filename) final;
         [[nodiscard]] SmartPtr<Stream> OnClone() final;
         [[nodiscard]] SmartPtr<Stream> OnNext(bool isForced) final;
 
-        void ReOpen();
+        template <typename Predicate>
+        bool FindEntry(Predicate&& predicate, uint32_t firstEntryIndex);
+
+        bool OpenArchive();
+        bool ReadHeader();
+        bool LoadBlock(uint64_t position);
+        void SetEntrySize(uint64_t size);
+        void CacheBlock(uint32_t blockIndex, const uint8_t* data, size_t size);
 
         static int64_t ArchiveRead(struct archive* a, StreamArchive* stream, const void** buf);
         static int64_t ArchiveSeek(struct archive* a, StreamArchive* stream, int64_t request, int whence);
@@ -47,21 +86,25 @@ namespace rePlayer
 
     private:
         SmartPtr<io::Stream> m_stream;
-        uint8_t m_cache[kCacheSize];
+        SmartPtr<Index> m_index;
 
-        archive* m_archive;
+        // libarchive state, only opened when a block is not in the cache
+        archive* m_archive = nullptr;
         archive_entry* m_entry;
+        Array<uint8_t> m_cache;
+        uint32_t m_headerIndex = 0; // number of headers read
+        uint32_t m_dataBlockIndex = 0;
+        uint64_t m_dataPosition = 0;
 
-        std::string m_comments;
         std::string m_entryFilename;
         bool m_isPackage = false;
         uint32_t m_entryIndex = 0;
-        uint64_t m_entrySize;
+        uint64_t m_entrySize = 0;
+        bool m_isEntrySizeSet = false;
         int64_t m_entryPosition = 0;
-        uint8_t* m_entryDataBlock;
-        size_t m_entryDataBlockSize = 0;
-        int64_t m_entryDataBlockPosition = 0;
+        Array<uint8_t> m_block; // copy of the block at m_blockPosition
+        uint64_t m_blockPosition = 0;
         SmartPtr<io::Stream> m_streamMemory;
     };
 }
-// namespace rePlayer
\ No newline at end of file
+// namespace rePlayer
@@ -7,6 +7,7 @@
 #include <Thread/Thread.h>
 
 // rePlayer
+#include <IO/CurlMulti.h>
 #include <Replayer/Core.h>
 
 // curl
@@ -62,9 +63,9 @@ namespace rePlayer
                     if (m_isLatencyEnabled)
                     {
                         // wait
-                        thread::Sleep(1);
                         if (!isStarving)
                             Log::Warning("StreamUrl: wait (starving)\n");
+                        Wait([&]() { return atomicHead.load() != head || std::atomic_ref(m_state).load() >= State::kEnd; });
                     }
                     else
                     {
@@ -101,16 +102,15 @@ namespace rePlayer
             while (remainingSize > 0)
             {
                 auto availableSize = atomicHead - tail;
-                for (; availableSize == 0;)
+                if (availableSize == 0)
                 {
-                    if (std::atomic_ref(m_state) >= State::kEnd && atomicHead == tail)
+                    Wait([&]() { return atomicHead.load() != tail || std::atomic_ref(m_state).load() >= State::kEnd; });
+                    availableSize = atomicHead - tail;
+                    if (availableSize == 0)
                     {
                         m_tail = tail;
                         return size - remainingSize;
                     }
-
-                    thread::Sleep(1);
-                    availableSize = atomicHead - tail;
                 }
 
                 availableSize = uint32_t(Min(remainingSize, uint64_t(availableSize)));
@@ -151,12 +151,7 @@ namespace rePlayer
                     m_isReadingChunk = true;
                     m_isJobDone = false;
                     m_infos.Clear();
-                    Core::AddJob([this]()
-                    {
-                        Update();
-                    });
-                    while (std::atomic_ref(m_state) < State::kDownload)
-                        thread::Sleep(1);
+                    Start();
                 }
                 return Status::kOk;
             }
@@ -167,12 +162,10 @@ namespace rePlayer
                 offset += m_tail;
             else if (whence == SeekWhence::kSeekEnd)
             {
-                while (std::atomic_ref(m_state) < State::kEnd)
-                    thread::Sleep(1);
+                Wait([this]() { return std::atomic_ref(m_state).load() >= State::kEnd; });
                 offset += m_head;
             }
-            while (offset > int64_t(std::atomic_ref(m_head)) && std::atomic_ref(m_state) < State::kEnd)
-                thread::Sleep(1);
+            Wait([this, offset]() { return offset <= int64_t(std::atomic_ref(m_head).load()) || std::atomic_ref(m_state).load() >= State::kEnd; });
             if (offset >= 0 && offset <= int64_t(std::atomic_ref(m_head)))
             {
                 m_tail = uint32_t(offset);
@@ -186,8 +179,7 @@ namespace rePlayer
     {
         if (m_type == Type::kStreaming)
             return 0;
-        while (std::atomic_ref(m_state) < State::kEnd)
-            thread::Sleep(1);
+        Wait([this]() { return std::atomic_ref(m_state).load() >= State::kEnd; });
         return m_head;
     }
 
@@ -279,8 +271,7 @@ namespace rePlayer
         if (m_type == Type::kStreaming)
             return { nullptr, size_t(0) };
 
-        while (std::atomic_ref(m_state) < State::kEnd)
-            thread::Sleep(1);
+        Wait([this]() { return std::atomic_ref(m_state).load() >= State::kEnd; });
         return { m_data.Items(), uint32_t(m_head) };
     }
 
@@ -330,12 +321,7 @@ namespace rePlayer
         curl_easy_setopt(m_curl, CURLOPT_LOW_SPEED_LIMIT, 30L); // 30 bytes per sec
         curl_easy_setopt(m_curl, CURLOPT_LOW_SPEED_TIME, 5L); // 5 seconds check
 
-        Core::AddJob([this]()
-        {
-            Update();
-        });
-        while (std::atomic_ref(m_state) < State::kDownload)
-            thread::Sleep(1);
+        Start();
     }
 
     StreamUrl::~StreamUrl()
@@ -414,8 +400,7 @@ namespace rePlayer
         if (m_type == Type::kStreaming)
             return nullptr;
 
-        while (std::atomic_ref(m_state) < State::kEnd)
-            thread::Sleep(1);
+        Wait([this]() { return std::atomic_ref(m_state).load() >= State::kEnd; });
 
         auto stream = io::StreamMemory::Create(m_url, m_data.Items(), m_data.Size(), true, this);
         return stream;
@@ -452,34 +437,44 @@ namespace rePlayer
     void StreamUrl::Close()
     {
         std::atomic_ref(this->m_state).store(State::kCancel);
-        while (!std::atomic_ref(m_isJobDone).load())
-            thread::Sleep(1);
+        if (!std::atomic_ref(m_isJobDone).load())
+            Core::GetCurl().Cancel(m_curl);
+        Wait([this]() { return std::atomic_ref(m_isJobDone).load(); });
     }
 
-    void StreamUrl::Update()
+    void StreamUrl::Start()
     {
-        CURLcode curlCode;
-        for (;;)
+        Core::GetCurl().Add(m_curl, [this](CURLcode curlCode)
+        {
+            OnCurlDone(curlCode);
+        });
+        Wait([this]() { return std::atomic_ref(m_state).load() >= State::kDownload; });
+    }
+
+    void StreamUrl::OnCurlDone(int result)
+    {
+        // on the curl thread
+        auto curlCode = CURLcode(result);
+        if (m_type == Type::kStreaming && std::atomic_ref(m_state).load() != State::kCancel
+            && (curlCode == CURLE_OK || curlCode == CURLE_RECV_ERROR || curlCode == CURLE_OPERATION_TIMEDOUT || curlCode == CURLE_PARTIAL_FILE))
         {
-            curlCode = curl_easy_perform(m_curl);
-            if (m_type == Type::kStreaming)
-            {
-                if (curlCode == CURLE_WRITE_ERROR || std::atomic_ref(m_state).load() == State::kCancel)
-                    break;
-                if (curlCode != CURLE_OK && curlCode != CURLE_RECV_ERROR && curlCode != CURLE_OPERATION_TIMEDOUT && curlCode != CURLE_PARTIAL_FILE)
-                    break;
-            }
-            else
-                break;
             Log::Warning("StreamUrl: connection reset \"%s\"\n", curl_easy_strerror(curlCode));
             m_tail = 0;
             m_metadataSize = 0;
             m_chunkSize = 0;
             m_isReadingChunk = true;
             m_infos.Clear();
+            Core::GetCurl().Add(m_curl, [this](CURLcode curlCode)
+            {
+                OnCurlDone(curlCode);
+            });
+            // closed in the mean time, its cancel may have been handled before the handle was added back
+            if (std::atomic_ref(m_state).load() == State::kCancel)
+                Core::GetCurl().Cancel(m_curl);
+            return;
         }
 
-        if (curlCode == CURLE_OK || curlCode == CURLE_WRITE_ERROR)
+        if (curlCode == CURLE_OK || curlCode == CURLE_WRITE_ERROR || curlCode == CURLE_ABORTED_BY_CALLBACK)
         {
             std::atomic_ref(m_state).store(State::kEnd);
         }
@@ -490,6 +485,7 @@ namespace rePlayer
         }
 
         std::atomic_ref(m_isJobDone).store(true);
+        Notify();
     }
 
     size_t StreamUrl::OnCurlHeader(const char* buffer, size_t size, size_t count, StreamUrl* stream)
@@ -662,6 +658,7 @@ namespace rePlayer
                 atomicHead += uint32_t(size);
             }
         }
+        stream->Notify();
         return size;
     }
 
@@ -761,5 +758,19 @@ namespace rePlayer
         info->title = title;
         info->artist = artist;
     }
+
+    template <typename Predicate>
+    inline void StreamUrl::Wait(Predicate&& isDone) const
+    {
+        std::unique_lock lock(m_mutex);
+        m_condition.wait(lock, isDone);
+    }
+
+    void StreamUrl::Notify()
+    {
+        // under the lock, so a reader can't miss it between its check and its sleep (nor be gone before it's sent)
+        std::scoped_lock lock(m_mutex);
+        m_condition.notify_all();
+    }
 }
 // namespace rePlayer
\ No newline at end of file
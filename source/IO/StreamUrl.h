@@ -4,6 +4,7 @@
 #include <IO/Stream.h>
 #include <Thread/SpinLock.h>
 
+#include <condition_variable>
 #include <mutex>
 
 typedef void CURL;
@@ -52,11 +53,17 @@ namespace rePlayer
 
         void Close();
 
-        void Update();
+        void Start();
+        void OnCurlDone(int result);
         static size_t OnCurlHeader(const char* buffer, size_t size, size_t count, StreamUrl* radio);
         static size_t OnCurlWrite(const uint8_t* data, size_t size, size_t count, StreamUrl* radio);
         void ExtractMetadata();
 
+        // the readers sleep until the curl thread has received some data (or is done)
+        template <typename Predicate>
+        void Wait(Predicate&& isDone) const;
+        void Notify();
+
     private:
         CURL* m_curl = nullptr;
         curl_slist* m_httpHeaders = nullptr;
@@ -103,7 +110,8 @@ namespace rePlayer
         bool m_isJobDone;
 
         Array<uint8_t> m_data;
-        std::mutex m_mutex;
+        mutable std::mutex m_mutex;
+        mutable std::condition_variable m_condition;
         mutable thread::SpinLock m_spinLock;
 
         Array<SmartPtr<StreamUrl>> m_links;
@@ -13,10 +13,12 @@
 #include <Deck/Deck.h>
 #include <Deck/Player.h>
 #include <IO/StreamArchive.h>
+#include <Library/LibraryAnalyzer.h>
 #include <Library/LibraryArtistsUI.h>
 #include <Library/LibraryBrowserUI.h>
 #include <Library/LibraryDatabase.h>
 #include <Library/LibraryFileImport.h>
+#include <Library/LibraryPrefetcher.h>
 #include <Library/LibrarySongsUI.h>
 #include <Library/Sources/AmigaMusicPreservation.h>
 #include <Library/Sources/AtariSAPMusicArchive.h>
@@ -49,6 +51,37 @@ namespace rePlayer
 {
     const char* const Library::ms_songsFilename = MusicPath "songs" MusicExt;
     const char* const Library::ms_artistsFilename = MusicPath "artists" MusicExt;
+    const char* const Library::ms_journalFilename = MusicPath "journal" MusicExt;
+    const char* const Library::ms_oldJournalFilename = MusicPath "journal" MusicExt ".old";
+
+    template <typename PackedType>
+    static bool SaveCompacted(const char* filename, const PackedType& packed, bool hasBackup)
+    {
+        // written aside then swapped, Library::Load picks the new file if the swap has been interrupted
+        std::string newFilename = filename;
+        newFilename += ".new";
+        {
+            auto file = io::File::OpenForWrite(newFilename.c_str());
+            if (!file.IsValid())
+                return false;
+            file.Write(kMusicFileStamp);
+            packed.Save(file);
+        }
+        if (!hasBackup)
+        {
+            std::string backupFileame = filename;
+            backupFileame += ".bak";
+            io::File::Copy(filename, backupFileame.c_str());
+        }
+        // the file loaded stays mapped: it can't be deleted, only renamed aside until the next start
+        if (!io::File::Delete(filename))
+        {
+            std::string oldFilename = filename;
+            oldFilename += ".old";
+            io::File::Move(filename, oldFilename.c_str());
+        }
+        return io::File::Move(newFilename.c_str(), filename);
+    }
 
     Library::Library()
         : Window("Library", ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoScrollbar)
@@ -70,11 +103,19 @@ namespace rePlayer
 
         Load();
 
+        m_prefetcher = new Prefetcher(*this);
+        m_analyzer = new LibraryAnalyzer(*this);
+
         Enable(true);
     }
 
     Library::~Library()
     {
+        Core::WaitJobs(m_compaction);
+
+        delete m_analyzer;
+        delete m_prefetcher;
+
         for (auto source : m_sources)
             delete source;
 
@@ -86,6 +127,28 @@ namespace rePlayer
     void Library::DisplaySettings()
     {
         ImGui::Checkbox("Auto merge on download in Library", &m_isMergingOnDownload);
+        uint32_t prefetchMin = 0;
+        uint32_t prefetchMax = 16;
+        ImGui::SliderScalar("Prefetch", ImGuiDataType_U32, &m_numPrefetchedSongs, &prefetchMin, &prefetchMax, "%u upcoming songs", ImGuiSliderFlags_AlwaysClamp);
+        uint32_t budgetMin = 8;
+        uint32_t budgetMax = 1024;
+        ImGui::SliderScalar("Prefetch budget", ImGuiDataType_U32, &m_prefetchBudget, &budgetMin, &budgetMax, "%u MB", ImGuiSliderFlags_AlwaysClamp);
+        ImGui::Checkbox("Find the duration of the unplayed songs in the background", &m_isAnalyzing);
+        uint32_t analysisMin = 1;
+        uint32_t analysisMax = 100;
+        ImGui::SliderScalar("Analysis budget", ImGuiDataType_U32, &m_analysisBudget, &analysisMin, &analysisMax, "%u%% of a core", ImGuiSliderFlags_AlwaysClamp);
+    }
+
+    void Library::CancelJobs()
+    {
+        m_analyzer->Cancel();
+        m_prefetcher->Cancel();
+        Core::WaitJobs(m_compaction);
+    }
+
+    void Library::Prefetch(const Array<SongID>& songIds)
+    {
+        m_prefetcher->Prefetch(songIds);
     }
 
     SmartPtr<core::io::Stream> Library::GetStream(Song* song)
@@ -127,7 +190,13 @@ namespace rePlayer
             for (uint32_t i = 0; i < songSheet->sourceIds.NumItems(); i++)
             {
                 auto sourceId = songSheet->sourceIds[i];
-                auto importedSong = m_sources[sourceId.sourceId]->ImportSong(sourceId, filename);
+                Source::Import importedSong;
+                uint32_t prefetchedCrc = 0;
+                bool isPrefetched = m_prefetcher->Take(songSheet->id, sourceId, importedSong, prefetchedCrc);
+                if (!isPrefetched)
+                    importedSong = m_sources[sourceId.sourceId]->ImportSong(sourceId, filename);
+                else if (importedSong.stream.IsValid())
+                    importedSong.stream->SetName(filename);
                 stream = importedSong.stream;
                 if (stream.IsValid())
                 {
@@ -145,55 +214,59 @@ namespace rePlayer
                     // build the crc of the file
                     auto moduleData = stream->Read();
                     auto fileSize = static_cast<uint32_t>(moduleData.Size());
-                    auto fileCrc = crc32(0L, Z_NULL, 0);
-                    fileCrc = crc32_z(fileCrc, moduleData.Items(), moduleData.Size());
+                    auto fileCrc = prefetchedCrc;
+                    if (!isPrefetched)
+                    {
+                        fileCrc = crc32(0L, Z_NULL, 0);
+                        fileCrc = crc32_z(fileCrc, moduleData.Items(), moduleData.Size());
+                    }
                     if (fileSize != songSheet->fileSize || fileCrc != songSheet->fileCrc)
                     {
                         // file has changed
                         songSheet->subsongs[0].isDirty = true;
                         songSheet->fileSize = fileSize;
                         songSheet->fileCrc = fileCrc;
+                        m_db.UpdateFileIndex(song);
                     }
 
                     // Already in the database?
                     if (m_isMergingOnDownload)
                     {
-                        for (auto* otherSong : m_db.Songs())
+                        auto* otherSong = m_db.FindSong(fileSize, fileCrc, [this, song](Song* dbSong)
                         {
-                            if (song != otherSong && otherSong->GetFileSize() == fileSize && otherSong->GetFileCrc() == fileCrc && !m_db.HasDeletedSubsongs(otherSong->GetId()))
+                            return song != dbSong && !m_db.HasDeletedSubsongs(dbSong->GetId());
+                        });
+                        if (otherSong)
+                        {
+                            auto* primarySong = songSheet;
+                            auto* otherSongSheet = otherSong->Edit();
+                            if (primarySong->sourceIds[0].Priority() >= otherSongSheet->sourceIds[0].Priority())
                             {
-                                auto* primarySong = songSheet;
-                                auto* otherSongSheet = otherSong->Edit();
-                                if (primarySong->sourceIds[0].Priority() >= otherSongSheet->sourceIds[0].Priority())
-                                {
-                                    std::swap(primarySong, otherSongSheet);
-                                    moduleData = { nullptr, 0u };
-                                    stream.Reset();
-                                }
+                                std::swap(primarySong, otherSongSheet);
+                                moduleData = { nullptr, 0u };
+                                stream.Reset();
+                            }
 
-                                Log::Message("Merge: ID_%06X \"[%s]%s\" with ID_%06X \"[%s]%s\"\n", uint32_t(otherSongSheet->id), otherSongSheet->type.GetExtension(), m_db.GetTitleAndArtists(otherSongSheet->id).c_str()
-                                    , uint32_t(primarySong->id), primarySong->type.GetExtension(), m_db.GetTitleAndArtists(primarySong->id).c_str());
+                            Log::Message("Merge: ID_%06X \"[%s]%s\" with ID_%06X \"[%s]%s\"\n", uint32_t(otherSongSheet->id), otherSongSheet->type.GetExtension(), m_db.GetTitleAndArtists(otherSongSheet->id).c_str()
+                                , uint32_t(primarySong->id), primarySong->type.GetExtension(), m_db.GetTitleAndArtists(primarySong->id).c_str());
 
-                                for (auto oldSourceId : otherSongSheet->sourceIds)
-                                {
-                                    primarySong->sourceIds.Add(oldSourceId);
-                                    m_sources[oldSourceId.sourceId]->DiscardSong(oldSourceId, primarySong->id);
-                                }
-                                primarySong->sourceIds.Container().RemoveIf([](auto& entry)
-                                {
-                                    return entry.sourceId == SourceID::FileImportID;
-                                });
-
-                                // reset the source of the discarded song to avoid messing up with the original source when discarding
-                                otherSongSheet->sourceIds.Clear();
-                                otherSongSheet->sourceIds.Add(SourceID(SourceID::FileImportID, 0));
-                                for (uint16_t j = 0; j <= otherSongSheet->lastSubsongIndex; j++)
-                                {
-                                    if (!otherSongSheet->subsongs[j].isDiscarded)
-                                        m_db.DeleteSubsong(SubsongID(otherSongSheet->id, j), true);
-                                }
+                            for (auto oldSourceId : otherSongSheet->sourceIds)
+                            {
+                                primarySong->sourceIds.Add(oldSourceId);
+                                m_sources[oldSourceId.sourceId]->DiscardSong(oldSourceId, primarySong->id);
+                            }
+                            primarySong->sourceIds.Container().RemoveIf([](auto& entry)
+                            {
+                                return entry.sourceId == SourceID::FileImportID;
+                            });
 
-                                break;
+                            // reset the source of the discarded song to avoid messing up with the original source when discarding
+                            otherSongSheet->sourceIds.Clear();
+                            otherSongSheet->sourceIds.Add(SourceID(SourceID::FileImportID, 0));
+                            for (uint16_t j = 0; j <= otherSongSheet->lastSubsongIndex; j++)
+                            {
+                                if (!otherSongSheet->subsongs[j].isDiscarded)
+                                    m_db.DeleteSubsong(SubsongID(otherSongSheet->id, j), true);
                             }
                         }
                     }
@@ -244,33 +317,69 @@ namespace rePlayer
     }
 
     SmartPtr<Player> Library::LoadSong(const MusicID musicId)
+    {
+        auto stream = OpenSong(musicId);
+        if (stream.IsInvalid())
+            return nullptr;
+
+        // song is available, try to play it
+        auto* song = m_db[musicId.subsongId]->Edit();
+        auto metadata(song->metadata);
+        auto* replay = Core::GetReplays().Load(stream, song->metadata.Container(), song->type, song->fileSize, song->fileCrc);
+        return LoadSong(musicId, stream, replay, metadata != song->metadata);
+    }
+
+    SmartPtr<io::Stream> Library::OpenSong(const MusicID musicId)
     {
         assert(musicId.databaseId == DatabaseID::kLibrary);
-        SmartPtr<Player> player;
         SmartPtr<Song> dbSong = m_db[musicId.subsongId];
         if (dbSong == nullptr)
-            return player;
+            return nullptr;
 
-        auto* song = dbSong->Edit();
         SmartPtr<io::Stream> stream = GetStream(dbSong);
         if (stream.IsInvalid())
         {
             // can't load it, tag it
+            auto* song = dbSong->Edit();
             if (!song->subsongs[0].isUnavailable)
             {
                 song->subsongs[0].isUnavailable = true;
                 m_db.Raise(Database::Flag::kSaveSongs);
             }
-            return player;
         }
+        return stream;
+    }
 
-        // song is available, try to play it
-        auto metadata(song->metadata);
-        if (auto replay = Core::GetReplays().Load(stream, song->metadata.Container(), song->type))
+    SmartPtr<Player> Library::LoadSong(const MusicID musicId, SmartPtr<io::Stream> stream, Replay* replay, bool hasMetadataChanged)
+    {
+        SmartPtr<Player> player;
+        bool hasChanged = false;
+        if (auto* song = UpdateSong(musicId, stream, replay, hasMetadataChanged, hasChanged))
+        {
+            player = Player::Create(musicId, song, replay, stream);
+            if (player.IsValid())
+                player->MarkSongAsNew(hasChanged);
+        }
+        return player;
+    }
+
+    SongSheet* Library::UpdateSong(const MusicID musicId, io::Stream* stream, Replay* replay, bool hasMetadataChanged, bool& hasChanged)
+    {
+        assert(musicId.databaseId == DatabaseID::kLibrary);
+        SongSheet* playableSong = nullptr;
+        SmartPtr<Song> dbSong = m_db[musicId.subsongId];
+        if (dbSong == nullptr)
+        {
+            delete replay;
+            return playableSong;
+        }
+
+        auto* song = dbSong->Edit();
+        if (replay)
         {
             auto oldType = song->type;
             auto type = replay->GetMediaType();
-            bool hasChanged = oldType != type || metadata != song->metadata;
+            hasChanged = oldType != type || hasMetadataChanged;
             song->type = type;
             if (oldType.ext != type.ext && !song->subsongs[0].isArchive)
                 m_db.Move(stream->GetName(), dbSong, "LoadSong");
@@ -314,8 +423,7 @@ namespace rePlayer
             }
             if (musicId.subsongId.index < numSubsongs)
             {
-                player = Player::Create(musicId, song, replay, stream);
-                player->MarkSongAsNew(hasChanged);
+                playableSong = song;
                 Log::Message("%s: loaded %06X%02X \"%s.%s\"\n", Core::GetReplays().GetName(song->type.replay), uint32_t(musicId.subsongId.songId), uint32_t(musicId.subsongId.index), m_db.GetTitleAndArtists(musicId.subsongId).c_str(), song->type.GetExtension());
             }
             else
@@ -336,7 +444,23 @@ namespace rePlayer
             }
             Log::Warning("Can't find a suitable replay for ID_%06X \"[%s]%s\"\n", uint32_t(song->id), song->type.GetExtension(), m_db.GetTitleAndArtists(musicId.subsongId).c_str());
         }
-        return player;
+        return playableSong;
+    }
+
+    thread::Task Library::DownloadSong(const MusicID musicId)
+    {
+        // same test as GetStream: not in the library folder yet and only available from its source
+        assert(musicId.databaseId == DatabaseID::kLibrary);
+        auto* song = m_db[musicId.subsongId];
+        if (song == nullptr || song->GetFileSize() > 0 || song->IsInvalid())
+            return {};
+        auto sourceId = song->GetSourceId(0);
+        if (sourceId.sourceId == SourceID::FileImportID)
+            return {};
+        return [prefetcher = m_prefetcher, songId = song->GetId(), sourceId, source = m_sources[sourceId.sourceId], path = m_db.GetFullpath(song)]()
+        {
+            prefetcher->Download(songId, sourceId, source, path);
+        };
     }
 
     std::string Library::OnGetWindowTitle()
@@ -402,6 +526,7 @@ namespace rePlayer
         m_songs->OnEndUpdate();
         m_artists->OnEndUpdate();
         m_busySpinner->Update();
+        m_analyzer->Update();
     }
 
     void Library::OnApplySettings()
@@ -1307,6 +1432,18 @@ namespace rePlayer
 
     void Library::Load()
     {
+        for (auto* filename : { ms_songsFilename, ms_artistsFilename })
+        {
+            std::string newFilename = filename;
+            newFilename += ".new";
+            if (!io::File::IsExisting(filename) && io::File::IsExisting(newFilename.c_str()))
+                io::File::Move(newFilename.c_str(), filename);
+            // set aside by the last compaction while mapped
+            std::string oldFilename = filename;
+            oldFilename += ".old";
+            io::File::Delete(oldFilename.c_str());
+        }
+
         auto file = io::File::OpenForRead(ms_songsFilename);
         if (file.IsValid())
         {
@@ -1337,6 +1474,26 @@ namespace rePlayer
             }
         }
 
+        // replay the changes saved since the last compaction (the old journal is there when it has been interrupted)
+        for (auto* filename : { ms_oldJournalFilename, ms_journalFilename })
+        {
+            file = io::File::OpenForRead(filename);
+            if (file.IsValid())
+            {
+                if (file.Read<uint32_t>() != kMusicFileStamp)
+                {
+                    assert(0 && "file read error");
+                    return;
+                }
+                if (m_db.LoadJournal(file) != Status::kOk)
+                {
+                    assert(0 && "file read error");
+                    return;
+                }
+                m_isCompactionNeeded |= filename == ms_oldJournalFilename || file.GetSize() > kCompactionSize;
+            }
+        }
+
         for (auto* source : m_sources)
             source->Load();
 
@@ -1350,39 +1507,23 @@ namespace rePlayer
 
         auto saveFlags = m_db.Fetch();
 
-        if (saveFlags.IsEnabled(Database::Flag::kSaveSongs))
+        // only the changed songs and artists are appended to the journal, the database files are rewritten by the compaction
+        if (saveFlags.value)
         {
-            if (!m_hasSongsBackup)
-            {
-                std::string backupFileame = ms_songsFilename;
-                backupFileame += ".bak";
-                io::File::Copy(ms_songsFilename, backupFileame.c_str());
-                m_hasSongsBackup = true;
-            }
-            auto file = io::File::OpenForWrite(ms_songsFilename);
+            auto file = io::File::OpenForAppend(ms_journalFilename);
             if (file.IsValid())
             {
-                file.Write(kMusicFileStamp);
-                m_db.SaveSongs(file);
+                if (file.GetSize() == 0)
+                    file.Write(kMusicFileStamp);
+                m_db.SaveJournal(file);
+                m_isCompactionNeeded |= file.GetSize() > kCompactionSize;
             }
+            else
+                m_db.Raise(saveFlags);
         }
 
-        if (saveFlags.IsEnabled(Database::Flag::kSaveArtists))
-        {
-            if (!m_hasArtistsBackup)
-            {
-                std::string backupFileame = ms_artistsFilename;
-                backupFileame += ".bak";
-                io::File::Copy(ms_artistsFilename, backupFileame.c_str());
-                m_hasArtistsBackup = true;
-            }
-            auto file = io::File::OpenForWrite(ms_artistsFilename);
-            if (file.IsValid())
-            {
-                file.Write(kMusicFileStamp);
-                m_db.SaveArtists(file);
-            }
-        }
+        if (m_isCompactionNeeded && m_compaction.IsDone())
+            Compact();
 
         // todo: remove validation
         if (saveFlags.value)
@@ -1395,6 +1536,29 @@ namespace rePlayer
             source->Save();
     }
 
+    void Library::Compact()
+    {
+        // the journal has just been flushed: the snapshot matches it, so replaying it over the new files is harmless
+        // the journal is set aside to be deleted by the job, unless an interrupted compaction has already left one
+        if (!io::File::IsExisting(ms_oldJournalFilename))
+            io::File::Move(ms_journalFilename, ms_oldJournalFilename);
+
+        auto* snapshot = new Database::Snapshot;
+        m_db.TakeSnapshot(*snapshot);
+        auto hasBackup = m_hasBackup;
+        m_hasBackup = true;
+        m_isCompactionNeeded = false;
+
+        Core::AddJob([snapshot, hasBackup]()
+        {
+            if (SaveCompacted(ms_songsFilename, snapshot->songs, hasBackup) && SaveCompacted(ms_artistsFilename, snapshot->artists, hasBackup))
+                io::File::Delete(ms_oldJournalFilename);
+            else
+                Log::Error("Library: can't compact the database\n");
+            delete snapshot;
+        }, &m_compaction);
+    }
+
     void Library::ValidateArtist(const Artist* const artist) const
     {
         uint32_t numSongs = 0;
@@ -5,6 +5,7 @@
 #include <Containers/Array.h>
 #include <Containers/SmartPtr.h>
 #include <Core/Window.h>
+#include <Thread/Workers.h>
 
 namespace core::io
 {
@@ -15,13 +16,16 @@ namespace core::io
 namespace rePlayer
 {
     class BusySpinner;
+    class LibraryAnalyzer;
     class LibraryDatabase;
     class Player;
+    class Replay;
     class SongEditor;
     struct MusicID;
 
     class Library : public Window
     {
+        friend class LibraryAnalyzer;
         friend class LibraryDatabase;
         friend class SongEditor;
     public:
@@ -32,9 +36,22 @@ namespace rePlayer
 
         void Validate();
         void Save();
+        // on exit, before the replays and the sources go away
+        void CancelJobs();
 
         SmartPtr<core::io::Stream> GetStream(Song* song);
         SmartPtr<Player> LoadSong(const MusicID musicId);
+        // LoadSong in two steps, the replay can be loaded by a worker in between
+        SmartPtr<core::io::Stream> OpenSong(const MusicID musicId);
+        SmartPtr<Player> LoadSong(const MusicID musicId, SmartPtr<core::io::Stream> stream, Replay* replay, bool hasMetadataChanged);
+        // the database side of LoadSong: returns the song to create the player with (or nullptr, the replay is then deleted)
+        SongSheet* UpdateSong(const MusicID musicId, core::io::Stream* stream, Replay* replay, bool hasMetadataChanged, bool& hasChanged);
+        // the download of OpenSong, to run on a worker before it (empty when there's nothing to download)
+        thread::Task DownloadSong(const MusicID musicId);
+
+        // get the upcoming songs ready in the background, so GetStream doesn't have to download them
+        void Prefetch(const Array<SongID>& songIds);
+        uint32_t NumPrefetchedSongs() const { return m_numPrefetchedSongs; }
 
     private:
         template <typename ParentDatabaseUI>
@@ -44,6 +61,7 @@ namespace rePlayer
         class BrowserUI;
 
         class FileImport;
+        class Prefetcher;
 
         enum class Tab : int8_t
         {
@@ -70,6 +88,7 @@ namespace rePlayer
         void ProcessImports();
 
         void Load();
+        void Compact();
 
         //DEBUG
         void ValidateArtist(const Artist* const artist) const;
@@ -84,10 +103,16 @@ namespace rePlayer
         static constexpr uint64_t kSelectableSources = ((1ull << SourceID::NumSourceIDs) - 1ull) & ~((1ull << SourceID::FileImportID) | (1ull << SourceID::URLImportID));
         uint64_t m_selectedSources = kSelectableSources;
 
-        bool m_hasSongsBackup = false;
-        bool m_hasArtistsBackup = false;
+        bool m_hasBackup = false;
+        bool m_isCompactionNeeded = false;
+        thread::JobCounter m_compaction;
 
         Serialized<bool> m_isMergingOnDownload = { "AutoMerge", false };
+        Serialized<uint32_t> m_numPrefetchedSongs = { "PrefetchSongs", 4 };
+        Serialized<uint32_t> m_prefetchBudget = { "PrefetchBudget", 64 }; // MB
+        Serialized<bool> m_isAnalyzing = { "Analyze", false };
+        Serialized<uint32_t> m_analysisBudget = { "AnalysisBudget", 10 }; // % of a core
+        Serialized<uint32_t> m_analysisCursor = { "AnalysisCursor", 0u }; // last song analyzed
 
         Serialized<Tab> m_currentTab = { "Tab", Tab::Songs };
         Tab m_selectedTab = Tab::None;
@@ -126,10 +151,16 @@ namespace rePlayer
         } m_imports;
 
         FileImport* m_fileImport = nullptr;
+        Prefetcher* m_prefetcher = nullptr;
+        LibraryAnalyzer* m_analyzer = nullptr;
         Serialized<std::string> m_lastFileDialogPath = "LastFileDialogPath";
 
         static const char* const ms_songsFilename;
         static const char* const ms_artistsFilename;
+        static const char* const ms_journalFilename;
+        static const char* const ms_oldJournalFilename;
+
+        static constexpr uint64_t kCompactionSize = 4 << 20; // journal size triggering a rewrite of the database files
     };
 }
 // namespace rePlayer
@@ -0,0 +1,337 @@
+// Core
+#include <IO/StreamFile.h>
+
+// rePlayer
+#include <Deck/Player.h>
+#include <IO/StreamArchive.h>
+#include <Library/Library.h>
+#include <Library/LibraryDatabase.h>
+#include <RePlayer/Core.h>
+#include <RePlayer/Replays.h>
+#include <Replays/Replay.h>
+
+#include "LibraryAnalyzer.h"
+
+// stl
+#include <atomic>
+#include <cmath>
+
+namespace rePlayer
+{
+    LibraryAnalyzer::LibraryAnalyzer(Library& library)
+        : m_library(library)
+    {}
+
+    LibraryAnalyzer::~LibraryAnalyzer()
+    {
+        Cancel();
+    }
+
+    void LibraryAnalyzer::Update()
+    {
+        auto& db = m_library.m_db;
+        if (m_isCancelled || std::atomic_ref(m_isBusy).load())
+            return;
+
+        // the results wait for their song to be released
+        for (uint32_t i = 0; i < m_pendingResults.NumItems();)
+        {
+            if (ApplyResults(m_pendingResults[i].songId, m_pendingResults[i].results))
+                m_pendingResults.RemoveAt(i);
+            else
+                i++;
+        }
+
+        if (auto* analysis = m_analysis)
+        {
+            if (analysis->isDone)
+            {
+                if (!ApplyResults(analysis->song->id, analysis->results))
+                    m_pendingResults.Add({ analysis->song->id, std::move(analysis->results) });
+                delete analysis;
+                m_analysis = nullptr;
+            }
+            else
+            {
+                // cpu budget (percentage of a core): the next slice waits in proportion of the time spent rendering the last one
+                if (analysis->renderTime)
+                {
+                    auto budget = Clamp(uint32_t(m_library.m_analysisBudget), 1u, 100u);
+                    m_nextSliceTime = std::chrono::steady_clock::now() + std::chrono::microseconds((analysis->renderTime * (100 - budget)) / budget);
+                    analysis->renderTime = 0;
+                }
+                if (m_library.m_isAnalyzing && std::chrono::steady_clock::now() >= m_nextSliceTime)
+                    StartSlice();
+                return;
+            }
+        }
+
+        if (!m_library.m_isAnalyzing || m_idleRevision == db.SongsRevision())
+            return;
+
+        // the next pending song after the cursor, once at the end it waits for the database to change
+        auto cursor = SongID(uint32_t(m_library.m_analysisCursor));
+        for (auto* song : db.Songs())
+        {
+            auto songId = song->GetId();
+            if (songId <= cursor || !IsPending(song) || m_analyzedSongs.FindItemByKey(songId))
+                continue;
+
+            m_library.m_analysisCursor = uint32_t(songId);
+            m_analyzedSongs.Insert(songId, true);
+
+            // the player works on a copy, only the results are written back to the database
+            SmartPtr<SongSheet> songSheet = new SongSheet();
+            song->CopyTo(songSheet);
+            if (songSheet->subsongs[0].isDirty) // the subsongs are built on the first load
+                continue;
+
+            m_analysis = new Analysis{ songSheet, db.GetFullpath(song), song->IsArchive(), song->IsPackage() };
+            StartSlice();
+            return;
+        }
+        m_library.m_analysisCursor = 0u;
+        m_idleRevision = db.SongsRevision();
+    }
+
+    void LibraryAnalyzer::Cancel()
+    {
+        std::atomic_ref(m_isCancelled).store(true);
+        Core::WaitJobs(m_jobs);
+        delete m_analysis;
+        m_analysis = nullptr;
+    }
+
+    bool LibraryAnalyzer::IsPending(Song* song)
+    {
+        // only the files already in the library, nothing is downloaded for this
+        if (song->IsInvalid() || song->IsUnavailable() || song->GetFileSize() == 0)
+            return false;
+        for (uint16_t i = 0, e = song->GetLastSubsongIndex(); i <= e; i++)
+        {
+            if (!song->IsSubsongDiscarded(i) && song->GetSubsongState(i) == SubsongState::Undefined && song->GetSubsongDurationCs(i) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    bool LibraryAnalyzer::IsReplaceable(const Song* song)
+    {
+        // same rule as the proxies reconcile: nothing else than the database holds the song (or its sheet)
+        auto* proxy = reinterpret_cast<const Song::Info*>(song);
+        return proxy->refCount == 1 && (proxy->dataSize != 0 || proxy->buffer->refCount == 1);
+    }
+
+    void LibraryAnalyzer::StartSlice()
+    {
+        m_isBusy = true;
+        Core::AddJob([this, analysis = m_analysis]()
+        {
+            auto start = std::chrono::steady_clock::now();
+            Slice(analysis);
+            auto renderTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+            analysis->renderTime = Max(uint64_t(renderTime), 1ull);
+            std::atomic_ref(m_isBusy).store(false);
+        }, &m_jobs);
+    }
+
+    void LibraryAnalyzer::Slice(Analysis* analysis)
+    {
+        if (analysis->stream.IsInvalid())
+        {
+            if (analysis->isArchive)
+                analysis->stream = StreamArchive::Create(analysis->filename, analysis->isPackage);
+            else
+                analysis->stream = io::StreamFile::Create(analysis->filename);
+            if (analysis->stream.IsInvalid())
+            {
+                analysis->isDone = true;
+                return;
+            }
+        }
+
+        // play the subsongs once, whatever the deck settings are: the player detects the end (standard or fade out) and fixes the duration
+        auto start = std::chrono::steady_clock::now();
+        while (!IsCancelled())
+        {
+            if (analysis->player.IsInvalid() && !StartSubsong(analysis))
+            {
+                analysis->isDone = true;
+                return;
+            }
+
+            auto* player = analysis->player.Get();
+            auto songPos = player->m_songPos;
+            player->Render(player->m_numSamples, 0);
+            AddToEnvelope(analysis, player->m_waveData, uint32_t(player->m_songPos - songPos));
+            if (player->m_songEnd != ~0ull || player->m_songPos >= uint64_t(kMaxDuration) * player->m_replay->GetSampleRate())
+                EndSubsong(analysis);
+
+            if (std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(kSliceDuration))
+                return;
+        }
+    }
+
+    bool LibraryAnalyzer::StartSubsong(Analysis* analysis)
+    {
+        auto* song = analysis->song.Get();
+        for (; analysis->subsongIndex <= song->lastSubsongIndex; analysis->subsongIndex++)
+        {
+            auto& subsong = song->subsongs[analysis->subsongIndex];
+            if (subsong.isDiscarded || subsong.state != SubsongState::Undefined || subsong.durationCs != 0)
+                continue;
+
+            auto subsongStream = analysis->stream->Clone();
+            auto* replay = Core::GetReplays().Load(subsongStream, song->metadata.Container(), song->type, song->fileSize, song->fileCrc);
+            if (replay == nullptr)
+                continue;
+            if (replay->IsStreaming())
+            {
+                // never ends
+                delete replay;
+                continue;
+            }
+            auto player = Player::Create(MusicID(SubsongID(song->id, analysis->subsongIndex), DatabaseID::kLibrary), song, replay, subsongStream, true);
+            if (player.IsInvalid())
+                continue;
+            player->m_numLoops = 0;
+            player->m_hasSeeked = false;
+
+            analysis->player = player;
+            analysis->envelope.Clear();
+            analysis->envelopeBlockSize = Max(replay->GetSampleRate() / 100, 1u);
+            analysis->envelopeCount = 0;
+            analysis->envelopeSum = 0.0f;
+            return true;
+        }
+        return false;
+    }
+
+    void LibraryAnalyzer::EndSubsong(Analysis* analysis)
+    {
+        auto index = analysis->subsongIndex;
+        auto& subsong = analysis->song->subsongs[index];
+        if (analysis->player->m_songEnd != ~0ull)
+            analysis->results.Add({ index, subsong.state, subsong.durationCs }); // fixed by the player in the copy
+        else if (auto durationCs = FindLoop(analysis->envelope))
+            analysis->results.Add({ index, SubsongState::Fadeout, durationCs });
+
+        analysis->player.Reset();
+        analysis->subsongIndex++;
+    }
+
+    void LibraryAnalyzer::AddToEnvelope(Analysis* analysis, const StereoSample* samples, uint32_t numSamples)
+    {
+        auto blockSize = analysis->envelopeBlockSize;
+        auto count = analysis->envelopeCount;
+        auto sum = analysis->envelopeSum;
+        for (uint32_t i = 0; i < numSamples; i++)
+        {
+            auto mono = (samples[i].left + samples[i].right) * 0.5f;
+            sum += mono * mono;
+            if (++count == blockSize)
+            {
+                analysis->envelope.Add(sqrtf(sum / blockSize));
+                count = 0;
+                sum = 0.0f;
+            }
+        }
+        analysis->envelopeCount = count;
+        analysis->envelopeSum = sum;
+    }
+
+    uint32_t LibraryAnalyzer::FindLoop(const Array<float>& envelope)
+    {
+        // the song didn't end: the last seconds of the envelope are compared with the ones before them,
+        // the best matching lag is the loop length and the repetition is followed back to find where the loop starts
+        auto numBlocks = envelope.NumItems();
+        if (numBlocks < kMinLoopDuration + kLoopWindow)
+            return 0;
+
+        auto similarity = [](const float* a, const float* b)
+        {
+            float diff = 0.0f;
+            float sum = 0.0f;
+            for (uint32_t i = 0; i < kLoopWindow; i++)
+            {
+                diff += fabsf(a[i] - b[i]);
+                sum += a[i] + b[i];
+            }
+            return sum > kLoopWindow * 1e-3f ? 1.0f - diff / sum : 0.0f; // silence doesn't loop
+        };
+
+        auto* blocks = envelope.Items();
+        auto tailPos = numBlocks - kLoopWindow;
+        auto maxLag = Min(tailPos, kMaxLoopDuration);
+        Array<float> similarities(maxLag + 1);
+        uint32_t bestLag = 0;
+        float bestSimilarity = 0.0f;
+        for (uint32_t lag = kMinLoopDuration; lag <= maxLag; lag++)
+        {
+            similarities[lag] = similarity(blocks + tailPos, blocks + tailPos - lag);
+            if (similarities[lag] > bestSimilarity)
+            {
+                bestSimilarity = similarities[lag];
+                bestLag = lag;
+            }
+        }
+        if (bestSimilarity < kLoopSimilarity)
+            return 0;
+
+        // the multiples of the loop match as well, keep the shortest one
+        for (uint32_t lag = kMinLoopDuration; lag < bestLag; lag++)
+        {
+            auto remainder = bestLag % lag;
+            if (similarities[lag] >= bestSimilarity - 0.01f && Min(remainder, lag - remainder) <= kLoopTolerance)
+            {
+                bestLag = lag;
+                break;
+            }
+        }
+
+        auto loopStart = tailPos - bestLag;
+        for (auto step = kLoopWindow / 4; loopStart >= step && similarity(blocks + loopStart - step, blocks + loopStart - step + bestLag) >= kLoopSimilarity;)
+            loopStart -= step;
+
+        // the intro and one loop
+        return loopStart + bestLag;
+    }
+
+    bool LibraryAnalyzer::ApplyResults(SongID songId, const Array<Result>& results)
+    {
+        auto& db = m_library.m_db;
+        if (results.IsEmpty() || !db.IsValid(songId))
+            return true;
+        auto* song = db[songId];
+        if (!IsReplaceable(song))
+            return false;
+
+        // the subsongs may have been played (or edited) in the mean time
+        SmartPtr<SongSheet> songSheet = new SongSheet();
+        song->CopyTo(songSheet);
+        bool isDirty = false;
+        for (auto& result : results)
+        {
+            if (result.index <= songSheet->lastSubsongIndex && songSheet->subsongs[result.index].state == SubsongState::Undefined && songSheet->subsongs[result.index].durationCs == 0)
+            {
+                songSheet->subsongs[result.index].state = result.state;
+                songSheet->subsongs[result.index].durationCs = result.durationCs;
+                isDirty = true;
+            }
+        }
+        if (isDirty)
+        {
+            // the updated song goes in as a proxy, the core reconciles it back to a blob
+            db.Reconcile(songId, Song::Create(songSheet));
+            db.Touch(songId);
+            db.Raise(Database::Flag::kSaveSongs);
+        }
+        return true;
+    }
+
+    inline bool LibraryAnalyzer::IsCancelled() const
+    {
+        return std::atomic_ref(m_isCancelled).load();
+    }
+}
+// namespace rePlayer
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <Containers/Array.h>
+#include <Containers/HashMap.h>
+#include <Containers/SmartPtr.h>
+#include <Database/Types/Song.h>
+#include <Thread/Workers.h>
+
+#include <chrono>
+#include <string>
+
+namespace core::io
+{
+    class Stream;
+}
+// namespace core::io
+
+namespace rePlayer
+{
+    class Library;
+    class Player;
+
+    // renders the library subsongs never played to the end, one song at a time, to find their duration and how they end
+    // the rendering is done by short jobs spaced out to fit the cpu budget, so a worker is never held for long
+    // the cursor (last song analyzed) is saved with the settings, so it carries on after a restart
+    class LibraryAnalyzer
+    {
+    public:
+        LibraryAnalyzer(Library& library);
+        ~LibraryAnalyzer();
+
+        void Update();
+        // waits for the slice being rendered, nothing is started after
+        void Cancel();
+
+    private:
+        struct Result
+        {
+            uint16_t index;
+            SubsongState state;
+            uint32_t durationCs;
+        };
+
+        struct PendingResults
+        {
+            SongID songId;
+            Array<Result> results;
+        };
+
+        // the song being analyzed, only touched by its slice job (or by the main thread in between)
+        struct Analysis
+        {
+            SmartPtr<SongSheet> song; // a copy, the database only gets the results
+            std::string filename;
+            bool isArchive;
+            bool isPackage;
+            SmartPtr<io::Stream> stream;
+
+            SmartPtr<Player> player; // of the subsong being rendered
+            uint16_t subsongIndex = 0;
+            Array<float> envelope; // rms of each centisecond rendered, for the loop detection
+            uint32_t envelopeBlockSize = 0;
+            uint32_t envelopeCount = 0;
+            float envelopeSum = 0.0f;
+
+            Array<Result> results;
+            uint64_t renderTime = 0; // of the last slice, in microseconds
+            bool isDone = false;
+        };
+
+    private:
+        static bool IsPending(Song* song);
+        static bool IsReplaceable(const Song* song);
+
+        void StartSlice();
+        void Slice(Analysis* analysis);
+        bool StartSubsong(Analysis* analysis);
+        void EndSubsong(Analysis* analysis);
+        static void AddToEnvelope(Analysis* analysis, const StereoSample* samples, uint32_t numSamples);
+        static uint32_t FindLoop(const Array<float>& envelope);
+
+        bool ApplyResults(SongID songId, const Array<Result>& results);
+
+        bool IsCancelled() const;
+
+    private:
+        Library& m_library;
+
+        thread::JobCounter m_jobs;
+        Analysis* m_analysis = nullptr;
+        std::chrono::steady_clock::time_point m_nextSliceTime;
+        bool m_isBusy = false; // a slice is being rendered
+        bool m_isCancelled = false;
+        uint32_t m_idleRevision = ~0u; // nothing left to analyze in this revision of the database
+        HashMap<SongID, bool> m_analyzedSongs; // this session, the failures are only retried on the next one
+        Array<PendingResults> m_pendingResults; // their songs are held by a player or an editor
+
+        static constexpr uint32_t kMaxDuration = 60 * 15; // in seconds, beyond the song is left for the player to find its end
+        static constexpr uint32_t kSliceDuration = 20; // in milliseconds of rendering per job
+        // loop detection on the envelope, in centiseconds
+        static constexpr uint32_t kMinLoopDuration = 500;
+        static constexpr uint32_t kMaxLoopDuration = 30000;
+        static constexpr uint32_t kLoopWindow = 1000;
+        static constexpr uint32_t kLoopTolerance = 10; // between a loop and its multiples
+        static constexpr float kLoopSimilarity = 0.95f;
+    };
+}
+// namespace rePlayer
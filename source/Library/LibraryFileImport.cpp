@@ -581,22 +581,12 @@ namespace rePlayer
         const auto pathExtension = guessedExtension;
         const auto pathStem = path.stem().u8string();
 
-        std::u8string prefix;
-        for (uint16_t i = 0;; i++)
+        if (MediaType::FindExtension(reinterpret_cast<const char*>(guessedExtension.c_str()), guessedExtension.size()) == eExtension::Unknown)
         {
-            if (i == uint16_t(eExtension::Count))
-            {
-                if (!prefix.empty())
-                    guessedExtension = prefix;
-                break;
-            }
-            if (_stricmp(reinterpret_cast<const char*>(guessedExtension.c_str()), MediaType::extensionNames[i]) == 0)
-                break;
-            if (prefix.empty() && _strnicmp(MediaType::extensionNames[i], reinterpret_cast<const char*>(pathStem.c_str()), MediaType::extensionLengths[i]) == 0)
-            {
-                if (MediaType::extensionLengths[i] == pathStem.size() || pathStem[MediaType::extensionLengths[i]] == '.')
-                    prefix = reinterpret_cast<const char8_t*>(MediaType::extensionNames[i]);
-            }
+            // a prefix is everything before the first dot of the stem
+            auto prefixSize = Min(pathStem.find('.'), pathStem.size());
+            if (MediaType::FindExtension(reinterpret_cast<const char*>(pathStem.c_str()), prefixSize) != eExtension::Unknown)
+                guessedExtension = pathStem.substr(0, prefixSize);
         }
         return Core::GetReplays().Find(reinterpret_cast<const char*>(guessedExtension.c_str()));
     }
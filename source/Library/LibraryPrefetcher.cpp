@@ -0,0 +1,258 @@
+// Core
+#include <IO/StreamFile.h>
+
+// rePlayer
+#include <Library/LibraryDatabase.h>
+#include <RePlayer/Core.h>
+
+#include "LibraryPrefetcher.h"
+
+// zlib
+#include <zlib.h>
+
+// stl
+#include <chrono>
+#include <filesystem>
+
+namespace rePlayer
+{
+    Library::Prefetcher::Prefetcher(Library& library)
+        : m_library(library)
+    {}
+
+    Library::Prefetcher::~Prefetcher()
+    {
+        Cancel();
+    }
+
+    void Library::Prefetcher::Cancel()
+    {
+        m_mutex.lock();
+        m_isCancelled = true;
+        m_requests.Clear();
+        m_mutex.unlock();
+        Core::WaitJobs(m_jobs);
+    }
+
+    void Library::Prefetcher::Prefetch(const Array<SongID>& songIds)
+    {
+        // no download when the library disk is (almost) full, they would end up there once played
+        std::error_code ec;
+        auto space = std::filesystem::space(SongsPath, ec);
+        bool canDownload = ec || space.available >= kMinFreeDiskSpace + (uint64_t(m_library.m_prefetchBudget) << 20);
+
+        std::scoped_lock lock(m_mutex);
+        m_requests.Clear();
+        for (auto songId : songIds)
+        {
+            if (IsKnown(songId))
+                continue;
+            auto* song = m_library.m_db[songId];
+            if (song == nullptr || song->IsInvalid())
+                continue;
+
+            // already in the library folder: only warm up the system file cache
+            // otherwise download it from the main source, the next ones are left to GetStream
+            auto sourceId = song->GetSourceId(0);
+            if (song->GetFileSize() > 0)
+                m_requests.Add({ songId, sourceId, m_library.m_db.GetFullpath(song), false });
+            else if (sourceId.sourceId != SourceID::FileImportID && canDownload)
+                m_requests.Add({ songId, sourceId, m_library.m_db.GetFullpath(song), true });
+        }
+        Next();
+    }
+
+    bool Library::Prefetcher::Take(SongID songId, SourceID sourceId, Source::Import& importedSong, uint32_t& fileCrc)
+    {
+        std::unique_lock lock(m_mutex);
+        if (m_currentRequest && m_currentRequest->isDownload && m_currentRequest->songId == songId)
+        {
+            // still queued behind the other jobs: GetStream is faster, else it's on its way and is waited for a bit
+            // (the job stores its entry before signaling)
+            if (!m_currentRequest->isStarted)
+                m_currentRequest->isCancelled = true;
+            else
+            {
+                m_prefetched.wait_for(lock, std::chrono::milliseconds(kTakeTimeout), [this, songId]()
+                {
+                    return m_currentRequest == nullptr || m_currentRequest->songId != songId;
+                });
+            }
+        }
+
+        auto* entry = m_entries.FindIf([songId, sourceId](auto& entry)
+        {
+            return entry.songId == songId && entry.sourceId == sourceId;
+        });
+        bool isFound = entry != nullptr;
+        if (isFound)
+        {
+            if (songId == m_downloadedSongId)
+                m_downloadedSongId = SongID::Invalid;
+            importedSong = std::move(entry->importedSong);
+            fileCrc = entry->fileCrc;
+            m_entriesSize -= entry->size;
+            m_entries.RemoveAtFast(entry - m_entries.Items());
+        }
+        Next();
+        return isFound;
+    }
+
+    void Library::Prefetcher::Download(SongID songId, SourceID sourceId, Source* source, const std::string& path)
+    {
+        {
+            std::unique_lock lock(m_mutex);
+            if (m_isCancelled)
+                return;
+            // the prefetch may be on it already
+            m_requests.RemoveIf([songId](auto& request)
+            {
+                return request.songId == songId;
+            });
+            if (m_currentRequest && m_currentRequest->songId == songId)
+            {
+                if (!m_currentRequest->isStarted)
+                    m_currentRequest->isCancelled = true;
+                else
+                {
+                    m_prefetched.wait(lock, [this, songId]()
+                    {
+                        return m_currentRequest == nullptr || m_currentRequest->songId != songId;
+                    });
+                }
+            }
+            if (auto* entry = m_entries.FindIf([songId, sourceId](auto& entry) { return entry.songId == songId && entry.sourceId == sourceId; }))
+            {
+                entry->lastUse = ++m_clock;
+                m_downloadedSongId = songId;
+                return;
+            }
+        }
+
+        auto* entry = new Entry{ songId, sourceId };
+        Import(entry, source, path);
+
+        std::scoped_lock lock(m_mutex);
+        m_downloadedSongId = songId;
+        Store(entry);
+    }
+
+    void Library::Prefetcher::Next()
+    {
+        // called under the lock
+        if (m_currentRequest || m_isCancelled || m_requests.IsEmpty())
+            return;
+
+        auto* request = m_currentRequest = new Request(std::move(m_requests[0]));
+        m_requests.RemoveAt(0);
+
+        auto* source = request->isDownload ? m_library.m_sources[request->sourceId.sourceId] : nullptr;
+        Core::AddJob([this, request, source]()
+        {
+            m_mutex.lock();
+            request->isStarted = true;
+            auto isCancelled = request->isCancelled || m_isCancelled;
+            m_mutex.unlock();
+
+            auto* entry = new Entry{ request->songId, request->sourceId };
+            if (isCancelled)
+            {
+                // GetStream took over
+            }
+            else if (source)
+                Import(entry, source, request->path);
+            else
+            {
+                // read it through once, so it's in the system file cache when the song is loaded
+                auto stream = io::StreamFile::Create(request->path);
+                if (stream.IsValid())
+                {
+                    auto* buffer = core::Alloc<uint8_t>(kWarmUpChunkSize);
+                    while (stream->Read(buffer, kWarmUpChunkSize) == kWarmUpChunkSize)
+                        continue;
+                    core::Free(buffer);
+                }
+            }
+
+            OnPrefetched(request, entry);
+        }, &m_jobs);
+    }
+
+    void Library::Prefetcher::Import(Entry* entry, Source* source, const std::string& path)
+    {
+        entry->importedSong = source->ImportSong(entry->sourceId, path);
+        if (entry->importedSong.stream.IsValid())
+        {
+            // GetStream needs the crc, build it here
+            auto data = entry->importedSong.stream->Read();
+            entry->fileCrc = crc32_z(crc32(0L, Z_NULL, 0), data.Items(), data.Size());
+            entry->size = data.Size();
+        }
+    }
+
+    void Library::Prefetcher::OnPrefetched(Request* request, Entry* entry)
+    {
+        // still in the job, so a waiting Take finds the entry
+        std::scoped_lock lock(m_mutex);
+        Store(entry);
+        delete request;
+        m_currentRequest = nullptr;
+        m_prefetched.notify_all();
+        Next();
+    }
+
+    void Library::Prefetcher::Store(Entry* entry)
+    {
+        // called under the lock
+        // failed downloads are left to GetStream, but a missing song has to be reported to the database
+        if (entry->importedSong.stream.IsValid() || entry->importedSong.isMissing)
+        {
+            entry->lastUse = ++m_clock;
+            m_entriesSize += entry->size;
+            m_entries.Add(std::move(*entry));
+            Evict();
+        }
+        delete entry;
+    }
+
+    void Library::Prefetcher::Evict()
+    {
+        // least recently prefetched first (a download bigger than the whole budget doesn't stay, unless it's the song being preloaded)
+        auto budget = uint64_t(m_library.m_prefetchBudget) << 20;
+        while (m_entriesSize > budget)
+        {
+            uint32_t oldest = ~0u;
+            for (uint32_t i = 0, e = m_entries.NumItems(); i < e; i++)
+            {
+                if (m_entries[i].songId != m_downloadedSongId && (oldest == ~0u || m_entries[i].lastUse < m_entries[oldest].lastUse))
+                    oldest = i;
+            }
+            if (oldest == ~0u)
+                break;
+            m_entriesSize -= m_entries[oldest].size;
+            m_entries.RemoveAtFast(oldest);
+        }
+    }
+
+    bool Library::Prefetcher::IsKnown(SongID songId)
+    {
+        if (m_currentRequest && m_currentRequest->songId == songId)
+            return true;
+        for (auto& request : m_requests)
+        {
+            if (request.songId == songId)
+                return true;
+        }
+        for (auto& entry : m_entries)
+        {
+            if (entry.songId == songId)
+            {
+                // still wanted, move it to the back of the lru
+                entry.lastUse = ++m_clock;
+                return true;
+            }
+        }
+        return false;
+    }
+}
+// namespace rePlayer
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Containers/Array.h>
+#include <Database/Types/MusicID.h>
+#include <Library/Library.h>
+#include <Thread/Workers.h>
+
+#include <condition_variable>
+#include <mutex>
+
+namespace rePlayer
+{
+    // downloads (or reads through the system file cache the files of) the upcoming songs on a worker, one at a time
+    // Take is called from GetStream, on the main thread or on the export jobs: it never joins the job
+    class Library::Prefetcher
+    {
+    public:
+        Prefetcher(Library& library);
+        ~Prefetcher();
+
+        // waits for the song in flight, nothing is started after
+        void Cancel();
+
+        // replaces the pending requests, the one in flight keeps going
+        void Prefetch(const Array<SongID>& songIds);
+        // hands over a prefetched download to GetStream (waits a bit for it if it's being downloaded, else GetStream downloads it)
+        bool Take(SongID songId, SourceID sourceId, Source::Import& importedSong, uint32_t& fileCrc);
+        // downloads the song on the calling worker (the preload of the playlist), Take hands it over to GetStream
+        void Download(SongID songId, SourceID sourceId, Source* source, const std::string& path);
+
+    private:
+        struct Request
+        {
+            SongID songId;
+            SourceID sourceId;
+            std::string path;
+            bool isDownload;
+            bool isStarted = false;
+            bool isCancelled = false; // taken before its job had a worker
+        };
+
+        struct Entry
+        {
+            SongID songId;
+            SourceID sourceId;
+            Source::Import importedSong;
+            uint32_t fileCrc = 0;
+            uint64_t size = 0;
+            uint64_t lastUse = 0;
+        };
+
+    private:
+        void Next();
+        static void Import(Entry* entry, Source* source, const std::string& path);
+        void OnPrefetched(Request* request, Entry* entry);
+        void Store(Entry* entry);
+        void Evict();
+
+        bool IsKnown(SongID songId);
+
+    private:
+        Library& m_library;
+
+        std::mutex m_mutex; // everything below
+        Array<Request> m_requests;
+        Request* m_currentRequest = nullptr;
+        std::condition_variable m_prefetched; // signaled each time the request in flight is done
+        thread::JobCounter m_jobs;
+        bool m_isCancelled = false;
+
+        Array<Entry> m_entries; // lru, in memory until played
+        uint64_t m_entriesSize = 0;
+        uint64_t m_clock = 0;
+        SongID m_downloadedSongId = SongID::Invalid; // the last Download, kept until taken
+
+        static constexpr uint32_t kTakeTimeout = 1000; // ms
+        static constexpr uint64_t kMinFreeDiskSpace = 256ull << 20; // the played downloads are saved in the library
+        static constexpr uint32_t kWarmUpChunkSize = 65536;
+    };
+}
+// namespace rePlayer
@@ -29,6 +29,7 @@ namespace rePlayer
         };
 
     private:
+        void Prepare();
         void Unmerge(int32_t unmergedEntryIndex);
         void Remerge(int32_t rootEntryIndex);
         void Process(DatabaseUI<ParentDatabaseUI>& songs);
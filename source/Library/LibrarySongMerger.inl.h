@@ -36,48 +36,72 @@ namespace rePlayer
         if (ImGui::Selectable("Merge songs"))
         {
             m_isStarted = true;
-
-            std::sort(m_entries.begin(), m_entries.end(), [](auto& l, auto& r)
+            Prepare();
+            ImGui::CloseCurrentPopup();
+        }
+        ImGui::EndDisabled();
+        ImGui::BeginDisabled(m_entries.IsEmpty());
+        if (ImGui::Selectable("Merge duplicates"))
+        {
+            // add all the songs sharing the same file as the selected ones
+            for (uint32_t i = 0, e = m_entries.NumItems(); i < e; i++)
             {
-                auto lFileSize = l.song->GetFileSize();
-                auto rFileSize = r.song->GetFileSize();
-                if (lFileSize != rFileSize)
-                    return (uint64_t(lFileSize) - 1) < (uint64_t(rFileSize) - 1);
+                auto* song = m_entries[i].song.Get();
+                songs.m_db.FindSong(song->GetFileSize(), song->GetFileCrc(), [this](Song* dbSong)
+                {
+                    if (m_entries.Find(dbSong->GetId()) == nullptr)
+                        m_entries.Add({ dbSong });
+                    return false;
+                });
+            }
+            m_isStarted = m_entries.NumItems() >= 2;
+            if (m_isStarted)
+                Prepare();
+            ImGui::CloseCurrentPopup();
+        }
+        ImGui::EndDisabled();
+    }
 
-                if (lFileSize == 0)
-                    return _stricmp(l.song->GetName(), r.song->GetName()) < 0;
+    template <typename ParentDatabaseUI>
+    void Library::DatabaseUI<ParentDatabaseUI>::SongMerger::Prepare()
+    {
+        std::sort(m_entries.begin(), m_entries.end(), [](auto& l, auto& r)
+        {
+            auto lFileSize = l.song->GetFileSize();
+            auto rFileSize = r.song->GetFileSize();
+            if (lFileSize != rFileSize)
+                return (uint64_t(lFileSize) - 1) < (uint64_t(rFileSize) - 1);
 
-                auto lFileCrc = l.song->GetFileCrc();
-                auto rFileCrc = r.song->GetFileCrc();
-                if (lFileCrc != rFileCrc)
-                    return lFileCrc < rFileCrc;
+            if (lFileSize == 0)
+                return _stricmp(l.song->GetName(), r.song->GetName()) < 0;
 
-                auto lSourceId = l.song->GetSourceId(0).Priority();
-                auto rSourceId = r.song->GetSourceId(0).Priority();
-                return lSourceId < rSourceId;
-            });
+            auto lFileCrc = l.song->GetFileCrc();
+            auto rFileCrc = r.song->GetFileCrc();
+            if (lFileCrc != rFileCrc)
+                return lFileCrc < rFileCrc;
 
-            for (uint32_t i = 1, e = m_entries.NumItems(); i < e; i++)
-            {
-                if (m_entries[i].song->GetFileSize() == 0 || m_entries[i - 1].song->GetFileSize() != m_entries[i].song->GetFileSize())
-                    continue;
-                if (m_entries[i - 1].song->GetFileCrc() != m_entries[i].song->GetFileCrc())
-                    continue;
+            auto lSourceId = l.song->GetSourceId(0).Priority();
+            auto rSourceId = r.song->GetSourceId(0).Priority();
+            return lSourceId < rSourceId;
+        });
 
-                if (m_entries[i - 1].parentId == SongID::Invalid)
-                {
-                    m_numMergedEntries++;
-                    m_entries[i - 1].isRoot = true;
-                    m_entries[i - 1].canMerge = true;
-                    m_entries[i].parentId = m_entries[i - 1].song->GetId();
-                }
-                else
-                    m_entries[i].parentId = m_entries[i - 1].parentId;
-            }
+        for (uint32_t i = 1, e = m_entries.NumItems(); i < e; i++)
+        {
+            if (m_entries[i].song->GetFileSize() == 0 || m_entries[i - 1].song->GetFileSize() != m_entries[i].song->GetFileSize())
+                continue;
+            if (m_entries[i - 1].song->GetFileCrc() != m_entries[i].song->GetFileCrc())
+                continue;
 
-            ImGui::CloseCurrentPopup();
+            if (m_entries[i - 1].parentId == SongID::Invalid)
+            {
+                m_numMergedEntries++;
+                m_entries[i - 1].isRoot = true;
+                m_entries[i - 1].canMerge = true;
+                m_entries[i].parentId = m_entries[i - 1].song->GetId();
+            }
+            else
+                m_entries[i].parentId = m_entries[i - 1].parentId;
         }
-        ImGui::EndDisabled();
     }
 
     template <typename ParentDatabaseUI>
@@ -682,7 +682,7 @@ namespace rePlayer
 
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, Buffer::Writer);
         curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
-        auto curlError = curl_easy_perform(curl);
+        auto curlError = Core::GetCurl().Perform(curl);
         SmartPtr<io::Stream> stream;
         bool isEntryMissing = false;
         if (curlError == CURLE_OK && buffer.IsNotEmpty())
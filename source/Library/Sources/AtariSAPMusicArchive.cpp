@@ -10,6 +10,7 @@
 
 // rePlayer
 #include <Database/Database.h>
+#include <IO/CurlMulti.h>
 #include <Database/Types/Countries.h>
 #include <RePlayer/Core.h>
 #include <RePlayer/Replays.h>
@@ -220,7 +221,7 @@ namespace rePlayer
 
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, Buffer::Writer);
         curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
-        auto curlError = curl_easy_perform(curl);
+        auto curlError = Core::GetCurl().Perform(curl);
         SmartPtr<io::Stream> stream;
         bool isEntryMissing = false;
         if (curlError == CURLE_OK && buffer.IsNotEmpty())
@@ -1092,7 +1093,7 @@ namespace rePlayer
 
             curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, Buffer::Writer);
             curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
-            curl_easy_perform(curl);
+            Core::GetCurl().Perform(curl);
             curl_easy_cleanup(curl);
 
             if (buffer.IsNotEmpty() && strstr(buffer.Items<char>(), "const asma =") == buffer.Items<char>())
@@ -9,6 +9,7 @@
 
 // rePlayer
 #include <Database/Database.h>
+#include <IO/CurlMulti.h>
 #include <RePlayer/Core.h>
 #include <UI/BusySpinner.h>
 
@@ -22,7 +23,7 @@ namespace rePlayer
 {
     static inline int Download(CURL* curl)
     {
-        auto curlError = curl_easy_perform(curl);
+        auto curlError = Core::GetCurl().Perform(curl);
         if (curlError == CURLE_OK)
         {
             return 0;
@@ -98,22 +99,17 @@ namespace rePlayer
         if (DownloadDatabase(busySpinner))
             return;
 
-        std::string lName = ToLower(name);
-        for (uint32_t i = 1, e = m_db.artists.NumItems(); i < e; ++i)
+        m_db.artistsIndex.Find(name, [&](uint32_t i)
         {
             auto& dbArtist = m_db.artists[i];
-            std::string lArtist = ToLower(dbArtist.name(m_db.strings));
-            if (strstr(lArtist.c_str(), lName.c_str()))
-            {
-                artists.matches.Push();
-                auto& newArtist = artists.matches.Last();
-                newArtist.id = SourceID(kID, FindArtist(dbArtist.name(m_db.strings)));
-                newArtist.name = dbArtist.name(m_db.strings);
-                char buf[32];
-                sprintf(buf, "%u %s", dbArtist.numSongs, dbArtist.numSongs <= 1 ? "song" : "songs");
-                newArtist.description = buf;
-            }
-        }
+            artists.matches.Push();
+            auto& newArtist = artists.matches.Last();
+            newArtist.id = SourceID(kID, FindArtist(dbArtist.name(m_db.strings)));
+            newArtist.name = dbArtist.name(m_db.strings);
+            char buf[32];
+            sprintf(buf, "%u %s", dbArtist.numSongs, dbArtist.numSongs <= 1 ? "song" : "songs");
+            newArtist.description = buf;
+        });
     }
 
     void SourceHighVoltageSIDCollection::ImportArtist(SourceID importedArtistID, SourceResults& results, BusySpinner& busySpinner)
@@ -155,21 +151,10 @@ namespace rePlayer
         if (DownloadDatabase(busySpinner))
             return;
 
-        std::string lName = ToLower(name);
-
-        for (uint32_t i = 0, e = m_db.songs.NumItems(); i < e; i++)
+        m_db.songsIndex.Find(name, [&](uint32_t i)
         {
-            const auto& dbSong = m_db.songs[i];
-            std::string dbSongName(dbSong.name(m_db.strings));
-            for (auto* c = dbSongName.data(); c = strchr(c, '_');)
-                *c = ' ';
-
-            std::string rName = ToLower(dbSongName);
-            if (strstr(rName.c_str(), lName.c_str()) == nullptr)
-                continue;
-
-            AddSong(dbSong, collectedSongs, false);
-        }
+            AddSong(m_db.songs[i], collectedSongs, false);
+        });
     }
 
     Source::Import SourceHighVoltageSIDCollection::ImportSong(SourceID sourceId, const std::string& path)
@@ -1095,6 +1080,21 @@ namespace rePlayer
                 }
             }
         }
+
+        // build the search indices once, the queries only walk the posting lists
+        for (uint32_t i = 1, e = m_db.artists.NumItems(); i < e; i++)
+            m_db.artistsIndex.Add(i, m_db.artists[i].name(m_db.strings));
+        m_db.artistsIndex.Build();
+        std::string songName;
+        for (uint32_t i = 1, e = m_db.songs.NumItems(); i < e; i++)
+        {
+            songName = m_db.songs[i].name(m_db.strings);
+            for (auto* c = songName.data(); c = strchr(c, '_');)
+                *c = ' ';
+            m_db.songsIndex.Add(i, songName.c_str());
+        }
+        m_db.songsIndex.Build();
+
         busySpinner.UpdateMessageParam(message, 100);
     }
 
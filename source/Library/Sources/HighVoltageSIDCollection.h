@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../Source.h"
+#include "SearchIndex.h"
 
 #include <Thread/SpinLock.h>
 
@@ -131,6 +132,8 @@ namespace rePlayer
             Array<HvscArtist> artists;
             Array<HvscSong> songs;
             Array<char> strings;
+            SearchIndex artistsIndex;
+            SearchIndex songsIndex;
         } m_db;
 
         Array<uint32_t> m_availableSongIds;
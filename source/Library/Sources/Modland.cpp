@@ -9,6 +9,7 @@
 
 // rePlayer
 #include <Database/Database.h>
+#include <IO/CurlMulti.h>
 #include <RePlayer/Core.h>
 #include <RePlayer/Replays.h>
 #include <UI/BusySpinner.h>
@@ -450,22 +451,17 @@ namespace rePlayer
             return;
 
         busySpinner.Info("looking for artists");
-        std::string lName = ToLower(name);
-        for (uint32_t i = 1, e = m_db.artists.NumItems(); i < e; ++i)
+        m_db.artistsIndex.Find(name, [&](uint32_t i)
         {
             auto& dbArtist = m_db.artists[i];
-            std::string lArtist = ToLower(dbArtist.name(m_db.strings));
-            if (strstr(lArtist.c_str(), lName.c_str()))
-            {
-                artists.matches.Push();
-                auto& newArtist = artists.matches.Last();
-                newArtist.id = SourceID(kID, FindArtist(dbArtist.name(m_db.strings)));
-                newArtist.name = dbArtist.name(m_db.strings);
-                char buf[32];
-                sprintf(buf, "%u %s", dbArtist.numSongs, dbArtist.numSongs <= 1 ? "song" : "songs");
-                newArtist.description = buf;
-            }
-        }
+            artists.matches.Push();
+            auto& newArtist = artists.matches.Last();
+            newArtist.id = SourceID(kID, FindArtist(dbArtist.name(m_db.strings)));
+            newArtist.name = dbArtist.name(m_db.strings);
+            char buf[32];
+            sprintf(buf, "%u %s", dbArtist.numSongs, dbArtist.numSongs <= 1 ? "song" : "songs");
+            newArtist.description = buf;
+        });
     }
 
     void SourceModland::ImportArtist(SourceID importedArtistID, SourceResults& results, BusySpinner& busySpinner)
@@ -513,22 +509,11 @@ namespace rePlayer
                 return;
         }
 
-        std::string lName = ToLower(name);
-
-        auto* message = busySpinner.Info("looking for songs: %u%%", 0);
-        for (uint32_t i = 0, e = m_db.songs.NumItems(); i < e; i++)
+        busySpinner.Info("looking for songs");
+        m_db.songsIndex.Find(name, [&](uint32_t i)
         {
-            busySpinner.UpdateMessageParam(message, uint32_t(((1ull + i) * 100ull) / e));
-
-            const auto& dbSong = m_db.songs[i];
-            std::string dbSongName(dbSong.name(m_db.strings));
-
-            std::string rName = ToLower(dbSongName);
-            if (strstr(rName.c_str(), lName.c_str()) == nullptr)
-                continue;
-
-            AddSong(dbSong, collectedSongs, false);
-        }
+            AddSong(m_db.songs[i], collectedSongs, false);
+        });
     }
 
     Source::Import SourceModland::ImportSong(SourceID sourceId, const std::string& path)
@@ -564,7 +549,7 @@ namespace rePlayer
 
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, Buffer::Writer);
         curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
-        auto curlError = curl_easy_perform(curl);
+        auto curlError = Core::GetCurl().Perform(curl);
         SmartPtr<io::Stream> stream;
         bool isEntryMissing = false;
         if (curlError == CURLE_OK && buffer.IsNotEmpty())
@@ -1556,7 +1541,7 @@ namespace rePlayer
         curl_easy_setopt(curl, CURLOPT_WRITEDATA, &curlBuffer);
         SmartPtr<io::Stream> stream;
         bool isEntryMissing = false;
-        auto curlError = curl_easy_perform(curl);
+        auto curlError = Core::GetCurl().Perform(curl);
         if (curlError == CURLE_OK)
         {
             struct ArchiveBuffer : public Array<uint8_t>
@@ -1614,7 +1599,7 @@ namespace rePlayer
             {
                 Log::Message("\"%s\"...", url.c_str());
                 curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-                curlError = curl_easy_perform(curl);
+                curlError = Core::GetCurl().Perform(curl);
                 if (curlError == CURLE_OK)
                 {
                     archive_entry_set_pathname(entry, name.c_str());
@@ -1775,7 +1760,7 @@ namespace rePlayer
                 curl_free(e);
                 Log::Message("\"%s\"...", url.c_str());
                 curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-                auto curlError = curl_easy_perform(curl);
+                auto curlError = Core::GetCurl().Perform(curl);
                 if (curlError == CURLE_OK && curlBuffer.IsNotEmpty())
                 {
                     if (curlBuffer.Size() < 256 && strstr((const char*)curlBuffer.begin(), "404 Not Found"))
@@ -2002,7 +1987,7 @@ namespace rePlayer
 
             curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, Buffer::Writer);
             curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
-            if (curl_easy_perform(curl) == CURLE_OK)
+            if (Core::GetCurl().Perform(curl) == CURLE_OK)
             {
                 auto* zipArchive = archive_read_new();
                 archive_read_support_compression_all(zipArchive);
@@ -2257,6 +2242,15 @@ namespace rePlayer
                 }
             }
         }
+
+        // build the search indices once, the queries only walk the posting lists
+        for (uint32_t i = 1, e = m_db.artists.NumItems(); i < e; i++)
+            m_db.artistsIndex.Add(i, m_db.artists[i].name(m_db.strings));
+        m_db.artistsIndex.Build();
+        for (uint32_t i = 1, e = m_db.songs.NumItems(); i < e; i++)
+            m_db.songsIndex.Add(i, m_db.songs[i].name(m_db.strings));
+        m_db.songsIndex.Build();
+
         if (busySpinner)
             busySpinner->UpdateMessageParam(message, 100);
     }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../Source.h"
+#include "SearchIndex.h"
 
 #include <Thread/SpinLock.h>
 
@@ -232,6 +233,8 @@ namespace rePlayer
             Array<ModlandSong> songs;
             Array<ModlandItem> items;
             Array<char> strings;
+            SearchIndex artistsIndex;
+            SearchIndex songsIndex;
         } m_db;
 
         Array<uint32_t> m_availableSongIds;
@@ -0,0 +1,84 @@
+#include "SearchIndex.h"
+
+// stl
+#include <algorithm>
+
+namespace rePlayer
+{
+    void SearchIndex::Add(uint32_t entry, const char* name)
+    {
+        if (name == nullptr || name[0] == 0)
+            return;
+        auto* newName = m_names.Push();
+        newName->entry = entry;
+        newName->offset = m_text.NumItems();
+        for (; *name; name++)
+            m_text.Add(Lower(*name));
+        m_text.Add('\0');
+    }
+
+    void SearchIndex::Build()
+    {
+        // collect all the (trigram, name) pairs, sorted by trigram then name
+        Array<uint64_t> pairs;
+        for (uint32_t nameIndex = 0, numNames = m_names.NumItems(); nameIndex < numNames; nameIndex++)
+        {
+            auto* name = m_text.Items(m_names[nameIndex].offset);
+            for (; name[0] && name[1] && name[2]; name++)
+                pairs.Add((uint64_t(Trigram(name)) << 32) | nameIndex);
+        }
+        std::sort(pairs.begin(), pairs.end());
+
+        m_trigrams.Clear();
+        m_postingOffsets.Clear();
+        m_postings.Clear();
+        m_postings.Reserve(pairs.NumItems());
+        uint64_t lastPair = ~0ull;
+        for (auto pair : pairs)
+        {
+            if (pair == lastPair) // same trigram more than once in a name
+                continue;
+            auto trigram = uint32_t(pair >> 32);
+            if (m_trigrams.IsEmpty() || m_trigrams.Last() != trigram)
+            {
+                m_trigrams.Add(trigram);
+                m_postingOffsets.Add(m_postings.NumItems());
+            }
+            m_postings.Add(uint32_t(pair));
+            lastPair = pair;
+        }
+        m_postingOffsets.Add(m_postings.NumItems());
+    }
+
+    void SearchIndex::Reset()
+    {
+        m_text.Reset();
+        m_names.Reset();
+        m_trigrams.Reset();
+        m_postingOffsets.Reset();
+        m_postings.Reset();
+    }
+
+    bool SearchIndex::Contains(const Name& name, const char* string, uint32_t length) const
+    {
+        auto* text = m_text.Items(name.offset);
+        for (; *text; text++)
+        {
+            uint32_t i = 0;
+            while (i < length && text[i] == Lower(string[i]))
+                i++;
+            if (i == length)
+                return true;
+        }
+        return length == 0;
+    }
+
+    uint32_t SearchIndex::FindTrigram(uint32_t trigram) const
+    {
+        auto it = std::lower_bound(m_trigrams.begin(), m_trigrams.end(), trigram);
+        if (it == m_trigrams.end() || *it != trigram)
+            return ~0u;
+        return uint32_t(it - m_trigrams.begin());
+    }
+}
+// namespace rePlayer
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <Containers/Array.h>
+
+namespace rePlayer
+{
+    using namespace core;
+
+    // trigram index for the case insensitive substring searches in the source catalogs
+    class SearchIndex
+    {
+    public:
+        // the names of an entry have to be added in a row, so the entry is reported only once
+        void Add(uint32_t entry, const char* name);
+        void Build();
+        void Reset();
+
+        bool IsEmpty() const;
+
+        // onFound(entry) for each entry with a name containing the string; no allocation
+        template <typename OnFound>
+        void Find(const char* string, OnFound&& onFound) const;
+
+    private:
+        struct Name
+        {
+            uint32_t entry;
+            uint32_t offset; // in m_text
+        };
+
+        static char Lower(char c);
+        static uint32_t Trigram(const char* str);
+
+        bool Contains(const Name& name, const char* string, uint32_t length) const;
+        uint32_t FindTrigram(uint32_t trigram) const;
+
+    private:
+        Array<char> m_text; // lower case names
+        Array<Name> m_names;
+        Array<uint32_t> m_trigrams; // sorted
+        Array<uint32_t> m_postingOffsets; // first posting of each trigram (+ the end)
+        Array<uint32_t> m_postings; // names containing the trigram, in ascending order
+    };
+
+    inline bool SearchIndex::IsEmpty() const
+    {
+        return m_names.IsEmpty();
+    }
+
+    inline char SearchIndex::Lower(char c)
+    {
+        return c >= 'A' && c <= 'Z' ? c + 'a' - 'A' : c;
+    }
+
+    inline uint32_t SearchIndex::Trigram(const char* str)
+    {
+        return (uint32_t(uint8_t(Lower(str[0]))) << 16) | (uint32_t(uint8_t(Lower(str[1]))) << 8) | uint32_t(uint8_t(Lower(str[2])));
+    }
+
+    template <typename OnFound>
+    inline void SearchIndex::Find(const char* string, OnFound&& onFound) const
+    {
+        auto length = uint32_t(strlen(string));
+        auto lastEntry = ~0u;
+        auto report = [&](const Name& name)
+        {
+            if (name.entry != lastEntry && Contains(name, string, length))
+            {
+                lastEntry = name.entry;
+                onFound(name.entry);
+            }
+        };
+
+        if (length < 3)
+        {
+            for (auto& name : m_names)
+                report(name);
+            return;
+        }
+
+        // walk the shortest posting list, the candidates are checked against the whole string
+        auto bestTrigram = ~0u;
+        auto bestNumPostings = ~0u;
+        for (uint32_t i = 0; i + 3 <= length; i++)
+        {
+            auto trigramIndex = FindTrigram(Trigram(string + i));
+            if (trigramIndex == ~0u)
+                return;
+            auto numPostings = m_postingOffsets[trigramIndex + 1] - m_postingOffsets[trigramIndex];
+            if (numPostings < bestNumPostings)
+            {
+                bestTrigram = trigramIndex;
+                bestNumPostings = numPostings;
+            }
+        }
+        for (uint32_t i = m_postingOffsets[bestTrigram], e = m_postingOffsets[bestTrigram + 1]; i < e; i++)
+            report(m_names[m_postings[i]]);
+    }
+}
+// namespace rePlayer
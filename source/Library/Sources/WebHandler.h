@@ -5,6 +5,7 @@
 #include <Core/String.h>
 
 // rePlayer
+#include <IO/CurlMulti.h>
 #include <Replayer/Core.h>
 
 // curl
@@ -75,7 +76,6 @@ namespace rePlayer
                 curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, false);
                 curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1);
                 curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
-                curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
                 curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
                 curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1);
 
@@ -94,7 +94,7 @@ namespace rePlayer
             curl_easy_setopt(curl, CURLOPT_URL, url);
 
             Status status = Status::kOk;
-            auto curlErr = curl_easy_perform(curl);
+            auto curlErr = Core::GetCurl().Perform(curl);
             if (curlErr == CURLE_OK)
             {
                 if (auto* doc = htmlReadMemory(buffer.Items(), buffer.NumItems(), nullptr, encoding, HTML_PARSE_NOERROR | HTML_PARSE_NOWARNING))
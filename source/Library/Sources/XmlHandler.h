@@ -5,6 +5,7 @@
 #include <Core/String.h>
 
 // rePlayer
+#include <IO/CurlMulti.h>
 #include <Replayer/Core.h>
 
 // curl
@@ -85,7 +86,6 @@ namespace rePlayer
                 curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, false);
                 curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1);
                 curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
-                curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
                 curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
 
                 curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errorBuffer);
@@ -104,7 +104,7 @@ namespace rePlayer
 
             curl_easy_setopt(curl, CURLOPT_URL, url);
 
-            auto curlErr = curl_easy_perform(curl);
+            auto curlErr = Core::GetCurl().Perform(curl);
             if (curlErr == CURLE_OK)
             {
                 if (auto* doc = xmlReadMemory(buffer.Items(), buffer.NumItems(), nullptr, nullptr, XML_PARSE_NOERROR | XML_PARSE_NOWARNING))
@@ -8,6 +8,7 @@
 
 // rePlayer
 #include <Database/Database.h>
+#include <IO/CurlMulti.h>
 #include <Database/Types/Countries.h>
 #include <RePlayer/Core.h>
 #include <RePlayer/Replays.h>
@@ -183,7 +184,7 @@ namespace rePlayer
             sprintf(url, "https://zxart.ee/api/export:zxMusic/language:eng/start:%u/filter:authorId=%u", start, importedArtistID.internalId);
             curl_easy_setopt(curl, CURLOPT_URL, url);
             Log::Message("ZXArt: fetching author %u at %u\n", uint32_t(importedArtistID.internalId), start);
-            curlError = curl_easy_perform(curl);
+            curlError = Core::GetCurl().Perform(curl);
             if (curlError == CURLE_OK)
             {
                 if (GetSongs(results, buffer, true, curl, start))
@@ -230,7 +231,7 @@ namespace rePlayer
             sprintf(url, "https://zxart.ee/api/types:zxMusic/export:zxMusic/language:eng/start:%u/filter:zxMusicTitleSearch=%s", start, curlName);
             curl_easy_setopt(curl, CURLOPT_URL, url);
             Log::Message("ZXArt: fetching zxMusicTitleSearch %s at %u\n", name, start);
-            curlError = curl_easy_perform(curl);
+            curlError = Core::GetCurl().Perform(curl);
             if (curlError == CURLE_OK)
             {
                 if (GetSongs(collectedSongs, buffer, false, curl, start))
@@ -273,7 +274,7 @@ namespace rePlayer
 
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, Buffer::Writer);
         curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
-        auto curlError = curl_easy_perform(curl);
+        auto curlError = Core::GetCurl().Perform(curl);
         SmartPtr<io::Stream> stream;
         bool isEntryMissing = false;
         if (curlError == CURLE_OK)
@@ -802,7 +803,7 @@ namespace rePlayer
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, Buffer::Writer);
         curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
 
-        CURLcode curlError = curl_easy_perform(curl);
+        CURLcode curlError = Core::GetCurl().Perform(curl);
         if (curlError == CURLE_OK)
         {
             auto json = nlohmann::json::parse(buffer.begin(), buffer.end());
@@ -836,7 +837,7 @@ namespace rePlayer
 
                         buffer.Clear();
                         Log::Message("ZXArt: fetching authorAlias %u\n", alias.get<uint32_t>());
-                        curlError = curl_easy_perform(curl);
+                        curlError = Core::GetCurl().Perform(curl);
                         if (curlError == CURLE_OK)
                         {
                             auto jsonAlias = nlohmann::json::parse(buffer.begin(), buffer.end());
@@ -894,7 +895,7 @@ namespace rePlayer
                 sprintf(url, "https://zxart.ee/api/export:authorAlias/language:eng/start:%u/filter:authorAliasAll", start);
                 curl_easy_setopt(curl, CURLOPT_URL, url);
                 Log::Message("ZXArt: fetching authorAliasAll at %u\n", start);
-                curlError = curl_easy_perform(curl);
+                curlError = Core::GetCurl().Perform(curl);
                 if (curlError == CURLE_OK)
                 {
                     auto jsonAllAliases = nlohmann::json::parse(buffer.begin(), buffer.end());
@@ -930,7 +931,7 @@ namespace rePlayer
                     sprintf(url, "https://zxart.ee/api/export:author/language:eng/start:%u/filter:authorAll", start);
                     curl_easy_setopt(curl, CURLOPT_URL, url);
                     Log::Message("ZXArt: fetching authorAll at %u\n", start);
-                    curlError = curl_easy_perform(curl);
+                    curlError = Core::GetCurl().Perform(curl);
                     if (curlError == CURLE_OK)
                     {
                         auto jsonAllAuthors = nlohmann::json::parse(buffer.begin(), buffer.end());
@@ -1042,7 +1043,7 @@ namespace rePlayer
             sprintf(url, "https://zxart.ee/api/export:zxMusic/language:eng/start:%u/filter:authorId=%u", artist.numSongs, artist.id);
             curl_easy_setopt(curl, CURLOPT_URL, url);
             Log::Message("ZXArt: fetching author %u at %u\n", artist.id, artist.numSongs);
-            curlError = curl_easy_perform(curl);
+            curlError = Core::GetCurl().Perform(curl);
             if (curlError == CURLE_OK)
             {
                 if (GetDbSongs(buffer, artist.numSongs))
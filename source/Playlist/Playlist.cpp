@@ -9,7 +9,6 @@
 #include <IO/File.h>
 #include <IO/StreamFile.h>
 #include <Thread/SpinLock.h>
-#include <Thread/Thread.h>
 
 // rePlayer
 #include <Database/DatabaseArtistsUI.h>
@@ -40,7 +39,9 @@
 
 // stl
 #include <algorithm>
+#include <atomic>
 #include <filesystem>
+#include <utility>
 
 // curl
 #include <curl/curl.h>
@@ -49,6 +50,20 @@
 
 namespace rePlayer
 {
+    // hashed chunk by chunk from the current position, the stream itself is left as it is (not cached)
+    static uint32_t ComputeFileCrc(io::Stream* stream, uint64_t streamSize)
+    {
+        auto fileCrc = crc32(0L, Z_NULL, 0);
+        auto* moduleData = core::Alloc<uint8_t>(65536);
+        for (uint64_t s = 0; s < streamSize; s += 65536)
+        {
+            auto readSize = stream->Read(moduleData, 65536);
+            fileCrc = crc32_z(fileCrc, moduleData, size_t(readSize));
+        }
+        core::Free(moduleData);
+        return fileCrc;
+    }
+
     inline Playlist::Cue::Entry& Playlist::Cue::Entry::operator=(const MusicID& musicId)
     {
         *this = {};
@@ -80,9 +95,36 @@ namespace rePlayer
         file.Write(name);
     }
 
+    // held by the playlist and by its jobs: once cancelled, the jobs finish without touching the playlist
+    struct Playlist::PreloadJob : public RefCounted
+    {
+        MusicID musicId;
+        SmartPtr<io::Stream> stream;
+        BlobArray<CommandBuffer::Command, Blob::kIsDynamic> metadata;
+        MediaType type;
+        uint32_t fileSize = 0;
+        uint32_t fileCrc = 0;
+        Replay* replay = nullptr; // until the player owns it
+        SmartPtr<Player> player;
+        bool isCancelled = false;
+
+        ~PreloadJob() override
+        {
+            delete replay;
+        }
+    };
+
     struct Playlist::AddFilesContext : public thread::SpinLock
     {
+        // the walk pauses when too many files are waiting for their scan, the scans resume it
+        static constexpr uint32_t kMaxPendingEntries = 1024;
+        // the scan is split in two stages: a few jobs read the files (and hash them), the others probe the read ones
+        static constexpr uint32_t kMaxReadJobs = 2;
+        static constexpr uint32_t kMaxReadEntries = 16; // in memory, being read or waiting for their probe
+
         Array<std::string> files;
+        uint32_t fileIndex = 0;
+        std::filesystem::recursive_directory_iterator dirIterator;
 
         struct Entry
         {
@@ -97,6 +139,16 @@ namespace rePlayer
             MediaType type;
         };
         Array<EntryToScan> entriesToScan;
+        uint32_t nextEntryToScan = 0;
+        struct EntryToProbe
+        {
+            EntryToScan entry;
+            SmartPtr<io::Stream> stream;
+            uint32_t fileCrc;
+        };
+        Array<EntryToProbe> entriesToProbe;
+        uint32_t numReadJobs = 0;
+        uint32_t numProbeJobs = 0;
         struct EntryToUpdate
         {
             SongSheet* song;
@@ -108,18 +160,41 @@ namespace rePlayer
         Array<std::string> failedEntries;
 
         int32_t droppedEntryIndex;
-        std::atomic<uint32_t> numEntries = 0;
+        std::atomic<uint32_t> numEntries = 0; // walked and not scanned yet
+        std::atomic<uint32_t> numJobs = 0; // walk and scan
+        std::atomic<bool> isWalkPaused = false;
+        std::atomic<bool> isWalkDone = false;
+        std::atomic<bool> isCancel = false;
 
         bool isAcceptingAll = false;
         bool isUrl = false;
-        bool isDone = false;
-        bool isCancel = false;
         uint16_t time = 0;
+        uint16_t databaseDay = 0;
 
         SongID previousSongId = SongID::Invalid;
         PlaylistID previousPlaylistId = PlaylistID::kInvalid;
 
         AddFilesContext* next = nullptr;
+
+        void Walk();
+        void AddFile(const std::filesystem::path& path);
+        void Scan();
+        void ReadFile(const EntryToScan& entry);
+        void ProbeFile(const EntryToProbe& entryToProbe);
+
+        bool PauseWalk()
+        {
+            if (numEntries.load() < kMaxPendingEntries)
+                return false;
+            isWalkPaused.store(true);
+            // the pending entries may have been scanned before the pause was visible
+            return numEntries.load() >= kMaxPendingEntries || !isWalkPaused.exchange(false);
+        }
+
+        bool ResumeWalk()
+        {
+            return numEntries.load() < kMaxPendingEntries / 2 && !isCancel && isWalkPaused.exchange(false);
+        }
     };
 
     const char* const Playlist::ms_fileName = MusicPath "playlists" MusicExt;
@@ -302,135 +377,161 @@ namespace rePlayer
     }
 
     SmartPtr<Player> Playlist::LoadSong(const MusicID musicId)
+    {
+        if (musicId.databaseId != DatabaseID::kPlaylist)
+            return Core::GetLibrary().LoadSong(musicId);
+
+        auto stream = OpenSong(musicId);
+        if (stream.IsInvalid())
+            return nullptr;
+
+        auto* song = m_cue.db[musicId.subsongId]->Edit();
+        auto metadata(song->metadata);
+        auto* replay = Core::GetReplays().Load(stream, song->metadata.Container(), song->type, song->fileSize, song->fileCrc);
+        return LoadSong(musicId, stream, replay, metadata != song->metadata);
+    }
+
+    SmartPtr<io::Stream> Playlist::OpenSong(const MusicID musicId)
+    {
+        if (musicId.databaseId != DatabaseID::kPlaylist)
+            return Core::GetLibrary().OpenSong(musicId);
+
+        auto* dbSong = m_cue.db[musicId.subsongId];
+        auto* song = dbSong->Edit();
+        auto stream = GetStream(dbSong);
+        if (stream.IsValid())
+        {
+            if (dbSong->GetFileSize() == 0 && IS_FILECRC_ENABLED)
+            {
+                auto streamSize = stream->GetSize();
+                song->fileSize = uint32_t(streamSize);
+                song->fileCrc = ComputeFileCrc(stream, streamSize);
+                song->subsongs[0].isDirty = streamSize != 0;
+            }
+        }
+        else
+        {
+            if (!song->subsongs[0].isUnavailable)
+            {
+                song->subsongs[0].isUnavailable = true;
+                m_cue.db.Raise(Database::Flag::kSaveSongs | Database::Flag::kSaveArtists);
+            }
+            Log::Error("Can't open file \"%s\"\n", m_cue.db.GetPath(song->sourceIds[0]));
+        }
+        return stream;
+    }
+
+    SmartPtr<Player> Playlist::LoadSong(const MusicID musicId, SmartPtr<io::Stream> stream, Replay* replay, bool hasMetadataChanged)
     {
         SmartPtr<Player> player;
-        if (musicId.databaseId == DatabaseID::kPlaylist)
+        bool hasChanged = false;
+        if (auto* song = UpdateSong(musicId, stream, replay, hasMetadataChanged, hasChanged))
         {
-            auto* dbSong = m_cue.db[musicId.subsongId];
-            auto* song = dbSong->Edit();
-            auto sourceId = song->sourceIds[0];
-            auto stream = GetStream(dbSong);
-            if (stream.IsValid())
+            player = Player::Create(musicId, song, replay, stream);
+            if (player.IsValid())
+                player->MarkSongAsNew(hasChanged);
+        }
+        return player;
+    }
+
+    SongSheet* Playlist::UpdateSong(const MusicID musicId, io::Stream* stream, Replay* replay, bool hasMetadataChanged, bool& hasChanged)
+    {
+        if (musicId.databaseId != DatabaseID::kPlaylist)
+            return Core::GetLibrary().UpdateSong(musicId, stream, replay, hasMetadataChanged, hasChanged);
+
+        SongSheet* playableSong = nullptr;
+        auto* song = m_cue.db[musicId.subsongId]->Edit();
+        auto sourceId = song->sourceIds[0];
+        if (replay)
+        {
+            auto oldType = song->type;
+            auto type = replay->GetMediaType();
+            hasChanged = oldType != type || hasMetadataChanged;
+            song->type = type;
+            uint32_t oldNumSubsongs = song->lastSubsongIndex + 1;
+            auto numSubsongs = replay->GetNumSubsongs();
+            if (numSubsongs != oldNumSubsongs || song->subsongs[0].isDirty || song->subsongs[0].isInvalid || oldType.replay != type.replay)
             {
-                if (dbSong->GetFileSize() == 0 && IS_FILECRC_ENABLED)
-                {
-                    auto streamSize = stream->GetSize();
-                    song->fileSize = uint32_t(streamSize);
-                    auto fileCrc = crc32(0L, Z_NULL, 0);
-                    auto* moduleData = core::Alloc<uint8_t>(65536);
-                    for (uint64_t s = 0; s < streamSize; s += 65536)
-                    {
-                        auto readSize = stream->Read(moduleData, 65536);
-                        fileCrc = crc32_z(fileCrc, moduleData, size_t(readSize));
-                    }
-                    core::Free(moduleData);
-                    song->fileCrc = fileCrc;
-                    song->subsongs[0].isDirty = streamSize != 0;
-                }
+                hasChanged = true;
 
-                auto metadata(song->metadata);
-                if (auto* replay = Core::GetReplays().Load(stream, song->metadata.Container(), song->type))
+                song->fileSize = uint32_t(stream->GetSize());
+                song->subsongs.Resize(numSubsongs);
+                song->lastSubsongIndex = uint16_t(numSubsongs - 1);
+                for (uint16_t i = 0; i < numSubsongs; i++)
                 {
-                    auto oldType = song->type;
-                    auto type = replay->GetMediaType();
-                    bool hasChanged = oldType != type || metadata != song->metadata;
-                    song->type = type;
-                    uint32_t oldNumSubsongs = song->lastSubsongIndex + 1;
-                    auto numSubsongs = replay->GetNumSubsongs();
-                    if (numSubsongs != oldNumSubsongs || song->subsongs[0].isDirty || song->subsongs[0].isInvalid || oldType.replay != type.replay)
-                    {
-                        hasChanged = true;
-
-                        song->fileSize = uint32_t(stream->GetSize());
-                        song->subsongs.Resize(numSubsongs);
-                        song->lastSubsongIndex = uint16_t(numSubsongs - 1);
-                        for (uint16_t i = 0; i < numSubsongs; i++)
-                        {
-                            replay->SetSubsong(i);
+                    replay->SetSubsong(i);
 
-                            auto& subsong = song->subsongs[i];
-                            subsong.Clear();
-                            subsong.durationCs = replay->GetDurationMs() / 10;
-                            subsong.isDirty = false;
-                            if (numSubsongs > 1)
-                            {
-                                subsong.name = replay->GetSubsongTitle();
-                                if (subsong.name.IsEmpty())
-                                {
-                                    char txt[32];
-                                    sprintf(txt, "subsong %u of %u", i + 1, numSubsongs);
-                                    subsong.name = txt;
-                                }
-                            }
-                        }
-                        for (uint16_t i = 0; i < oldNumSubsongs; i++)
+                    auto& subsong = song->subsongs[i];
+                    subsong.Clear();
+                    subsong.durationCs = replay->GetDurationMs() / 10;
+                    subsong.isDirty = false;
+                    if (numSubsongs > 1)
+                    {
+                        subsong.name = replay->GetSubsongTitle();
+                        if (subsong.name.IsEmpty())
                         {
-                            if (i == musicId.subsongId.index)
-                                continue;
-                            for (uint32_t j = 0, e = m_cue.entries.NumItems(); j < e;)
-                            {
-                                if (m_cue.entries[j].subsongId.songId == song->id && m_cue.entries[j].subsongId.index == j)
-                                {
-                                    if (static_cast<int32_t>(j) < m_currentEntryIndex)
-                                        m_currentEntryIndex--;
-
-                                    m_cue.entries.RemoveAt(j);
-                                    e--;
-                                }
-                                else
-                                    j++;
-                            }
-                            if (m_currentEntryIndex >= m_cue.entries.NumItems<int32_t>())
-                                m_currentEntryIndex = m_cue.entries.NumItems<int32_t>() - 1;
+                            char txt[32];
+                            sprintf(txt, "subsong %u of %u", i + 1, numSubsongs);
+                            subsong.name = txt;
                         }
                     }
-                    else if (song->subsongs[0].isUnavailable)
-                    {
-                        song->subsongs[0].isUnavailable = false;
-                        hasChanged = true;
-                    }
-                    if (musicId.subsongId.index < numSubsongs)
-                    {
-                        player = Player::Create(musicId, song, replay, stream);
-                        player->MarkSongAsNew(hasChanged);
-                        Log::Message("%s: loaded %06X%02X \"%s\"\n", Core::GetReplays().GetName(song->type.replay), uint32_t(musicId.subsongId.songId), uint32_t(musicId.subsongId.index), m_cue.db.GetPath(sourceId));
-                    }
-                    else
-                    {
-                        delete replay;
-                        Log::Message("%s: discarded %06X%02X \"%s\"\n", Core::GetReplays().GetName(song->type.replay), uint32_t(musicId.subsongId.songId), uint32_t(musicId.subsongId.index), m_cue.db.GetPath(sourceId));
-                    }
-
-                    if (hasChanged)
-                        m_cue.db.Raise(Database::Flag::kSaveSongs | Database::Flag::kSaveArtists);
                 }
-                else
+                for (uint16_t i = 0; i < oldNumSubsongs; i++)
                 {
-                    if (!song->subsongs[0].isInvalid)
+                    if (i == musicId.subsongId.index)
+                        continue;
+                    for (uint32_t j = 0, e = m_cue.entries.NumItems(); j < e;)
                     {
-                        song->subsongs[0].isInvalid = true;
-                        m_cue.db.Raise(Database::Flag::kSaveSongs | Database::Flag::kSaveArtists);
+                        if (m_cue.entries[j].subsongId.songId == song->id && m_cue.entries[j].subsongId.index == j)
+                        {
+                            if (static_cast<int32_t>(j) < m_currentEntryIndex)
+                                m_currentEntryIndex--;
+
+                            m_cue.entries.RemoveAt(j);
+                            e--;
+                        }
+                        else
+                            j++;
                     }
-                    Log::Error("Can't find a replay for \"%s\"\n", m_cue.db.GetPath(sourceId));
+                    if (m_currentEntryIndex >= m_cue.entries.NumItems<int32_t>())
+                        m_currentEntryIndex = m_cue.entries.NumItems<int32_t>() - 1;
                 }
             }
+            else if (song->subsongs[0].isUnavailable)
+            {
+                song->subsongs[0].isUnavailable = false;
+                hasChanged = true;
+            }
+            if (musicId.subsongId.index < numSubsongs)
+            {
+                playableSong = song;
+                Log::Message("%s: loaded %06X%02X \"%s\"\n", Core::GetReplays().GetName(song->type.replay), uint32_t(musicId.subsongId.songId), uint32_t(musicId.subsongId.index), m_cue.db.GetPath(sourceId));
+            }
             else
             {
-                if (!song->subsongs[0].isUnavailable)
-                {
-                    song->subsongs[0].isUnavailable = true;
-                    m_cue.db.Raise(Database::Flag::kSaveSongs | Database::Flag::kSaveArtists);
-                }
-                Log::Error("Can't open file \"%s\"\n", m_cue.db.GetPath(sourceId));
+                delete replay;
+                Log::Message("%s: discarded %06X%02X \"%s\"\n", Core::GetReplays().GetName(song->type.replay), uint32_t(musicId.subsongId.songId), uint32_t(musicId.subsongId.index), m_cue.db.GetPath(sourceId));
             }
+
+            if (hasChanged)
+                m_cue.db.Raise(Database::Flag::kSaveSongs | Database::Flag::kSaveArtists);
         }
         else
-            player = Core::GetLibrary().LoadSong(musicId);
-        return player;
+        {
+            if (!song->subsongs[0].isInvalid)
+            {
+                song->subsongs[0].isInvalid = true;
+                m_cue.db.Raise(Database::Flag::kSaveSongs | Database::Flag::kSaveArtists);
+            }
+            Log::Error("Can't find a replay for \"%s\"\n", m_cue.db.GetPath(sourceId));
+        }
+        return playableSong;
     }
 
     void Playlist::LoadPreviousSong(SmartPtr<Player>& currentPlayer, SmartPtr<Player>& nextPlayer)
     {
+        CancelPreload();
+
         auto isLooping = Core::GetDeck().IsLooping();
         auto numEntries = m_cue.entries.NumItems<int32_t>();
         auto currentEntryIndex = m_currentEntryIndex;
@@ -491,6 +592,8 @@ namespace rePlayer
 
     SmartPtr<Player> Playlist::LoadCurrentSong()
     {
+        CancelPreload();
+
         SmartPtr<Player> player;
         auto isLooping = Core::GetDeck().IsLooping();
         auto numEntries = m_cue.entries.NumItems<int32_t>();
@@ -551,6 +654,8 @@ namespace rePlayer
 
     SmartPtr<Player> Playlist::LoadNextSong(bool isAdvancing)
     {
+        CancelPreload();
+
         SmartPtr<Player> player;
         auto isLooping = Core::GetDeck().IsLooping();
         auto numEntries = m_cue.entries.NumItems<int32_t>();
@@ -620,6 +725,12 @@ namespace rePlayer
 
     void Playlist::ValidateNextSong(SmartPtr<Player>& player)
     {
+        // the preload is on its way, wait for it rather than loading the song a second time (its callbacks run in WaitJobs)
+        while (m_preload.isPending)
+            Core::WaitJobs(m_preload.jobs);
+        if (m_preload.player.IsValid())
+            player = std::move(m_preload.player);
+
         if (m_currentEntryIndex < 0)
         {
             player.Reset();
@@ -682,6 +793,235 @@ namespace rePlayer
         player = newPlayer;
     }
 
+    void Playlist::PreloadNextSong(bool isAdvancing)
+    {
+        CancelPreload();
+
+        auto isLooping = Core::GetDeck().IsLooping();
+        auto numEntries = m_cue.entries.NumItems<int32_t>();
+        auto currentEntryIndex = m_currentEntryIndex;
+        auto lastEntryIndex = isLooping ? currentEntryIndex + numEntries : numEntries - 1;
+        if (isAdvancing)
+        {
+            for (;;)
+            {
+                currentEntryIndex++;
+                auto entryIndex = currentEntryIndex % numEntries;
+                if (currentEntryIndex <= lastEntryIndex && !m_cue.entries[entryIndex].GetSong()->IsInvalid())
+                {
+                    m_currentEntryIndex = entryIndex;
+                    break;
+                }
+                if (currentEntryIndex > lastEntryIndex)
+                    break;
+            }
+        }
+
+        m_preload.entryIndex = currentEntryIndex;
+        m_preload.lastEntryIndex = lastEntryIndex;
+        m_preload.isPending = true;
+        PreloadNextEntry();
+        PrefetchNextEntries();
+    }
+
+    SmartPtr<Player> Playlist::GetPreloadedSong()
+    {
+        return std::move(m_preload.player);
+    }
+
+    void Playlist::CancelPreload()
+    {
+        // the jobs still running will discard their replay (or their player)
+        if (m_preload.job.IsValid())
+        {
+            std::atomic_ref(m_preload.job->isCancelled).store(true);
+            m_preload.job.Reset();
+        }
+        m_preload.player.Reset();
+        m_preload.isPending = false;
+    }
+
+    void Playlist::PreloadNextEntry()
+    {
+        // same walk as LoadNextSong, but the downloads, the replays and the players are made by the workers
+        auto isLooping = Core::GetDeck().IsLooping();
+        auto numEntries = m_cue.entries.NumItems<int32_t>();
+        while (numEntries > 0)
+        {
+            auto nextEntryIndex = m_preload.entryIndex + 1;
+            if (isLooping)
+                nextEntryIndex = nextEntryIndex % numEntries;
+
+            if (nextEntryIndex < numEntries && m_cue.entries[nextEntryIndex].IsAvailable())
+            {
+                SmartPtr<PreloadJob> job(kAllocate);
+                job->musicId = m_cue.entries[nextEntryIndex];
+                m_preload.job = job;
+
+                // a library song missing from its folder is downloaded first, OpenSong takes it from the library
+                auto download = job->musicId.databaseId == DatabaseID::kLibrary ? Core::GetLibrary().DownloadSong(job->musicId) : thread::Task();
+                if (download)
+                {
+                    Core::AddJob([this, job, download = std::move(download)]() mutable
+                    {
+                        download();
+                        Core::FromJob([this, job]()
+                        {
+                            if (!job->isCancelled && !OpenPreloadedSong(job))
+                                SkipPreloadedEntry();
+                        });
+                    }, &m_preload.jobs);
+                    return;
+                }
+                if (OpenPreloadedSong(job))
+                    return;
+            }
+
+            if (m_preload.entryIndex >= m_preload.lastEntryIndex)
+                break;
+
+            m_preload.entryIndex++;
+        }
+        m_preload.job.Reset();
+        m_preload.isPending = false;
+    }
+
+    bool Playlist::OpenPreloadedSong(PreloadJob* job)
+    {
+        auto musicId = job->musicId;
+        auto stream = OpenSong(musicId);
+        if (stream.IsInvalid())
+            return false;
+
+        auto* song = Core::GetDatabase(musicId.databaseId)[musicId.subsongId];
+        job->stream = stream;
+        job->metadata = song->Metadatas();
+        job->type = song->GetType();
+        job->fileSize = song->GetFileSize();
+        job->fileCrc = song->GetFileCrc();
+        Core::AddJob([this, job = SmartPtr<PreloadJob>(job)]()
+        {
+            job->replay = Core::GetReplays().Load(job->stream, job->metadata.Container(), job->type, job->fileSize, job->fileCrc);
+            Core::FromJob([this, job]()
+            {
+                if (!job->isCancelled)
+                    OnPreloaded(job);
+            });
+        }, &m_preload.jobs);
+        return true;
+    }
+
+    void Playlist::SkipPreloadedEntry()
+    {
+        if (m_preload.entryIndex >= m_preload.lastEntryIndex)
+        {
+            m_preload.job.Reset();
+            m_preload.isPending = false;
+        }
+        else
+        {
+            m_preload.entryIndex++;
+            PreloadNextEntry();
+        }
+    }
+
+    void Playlist::PrefetchNextEntries()
+    {
+        // the library songs after the preloaded one (the library takes care of the downloads)
+        auto& library = Core::GetLibrary();
+        auto numPrefetchedSongs = library.NumPrefetchedSongs();
+        auto isLooping = Core::GetDeck().IsLooping();
+        auto numEntries = m_cue.entries.NumItems<int32_t>();
+        Array<SongID> songIds;
+        for (int32_t i = 2; i <= numEntries && songIds.NumItems() < numPrefetchedSongs; i++)
+        {
+            auto entryIndex = m_currentEntryIndex + i;
+            if (isLooping)
+                entryIndex = entryIndex % numEntries;
+            else if (entryIndex >= numEntries)
+                break;
+
+            auto& entry = m_cue.entries[entryIndex];
+            if (entry.databaseId == DatabaseID::kLibrary && entry.IsAvailable() && songIds.Find(entry.subsongId.songId) == nullptr)
+                songIds.Add(entry.subsongId.songId);
+        }
+        library.Prefetch(songIds);
+    }
+
+    void Playlist::OnPreloaded(PreloadJob* job)
+    {
+        auto isLooping = Core::GetDeck().IsLooping();
+        auto numEntries = m_cue.entries.NumItems<int32_t>();
+        auto nextEntryIndex = m_preload.entryIndex + 1;
+        if (isLooping && numEntries > 0)
+            nextEntryIndex = nextEntryIndex % numEntries;
+
+        auto* dbSong = Core::GetDatabase(job->musicId.databaseId)[job->musicId.subsongId];
+        if (nextEntryIndex >= numEntries || m_cue.entries[nextEntryIndex].playlistId != job->musicId.playlistId || dbSong == nullptr)
+        {
+            // the playlist has changed in the meantime, start over
+            PreloadNextSong(false);
+            return;
+        }
+
+        auto* song = dbSong->Edit();
+        bool hasMetadataChanged = job->metadata != song->metadata;
+        song->metadata = job->metadata;
+
+        bool hasChanged = false;
+        auto* playableSong = UpdateSong(job->musicId, job->stream, job->replay, hasMetadataChanged, hasChanged);
+        if (playableSong)
+        {
+            if (hasChanged)
+            {
+                auto cueEntry = m_cue.entries[nextEntryIndex];
+                auto currentSubsongIndex = cueEntry.subsongId.index;
+                for (uint16_t i = 0; i <= playableSong->lastSubsongIndex; i++)
+                {
+                    if (i == currentSubsongIndex)
+                        continue;
+                    cueEntry.playlistId = ++m_uniqueIdGenerator;
+                    cueEntry.subsongId.index = i;
+                    m_cue.entries.Insert(nextEntryIndex + i, cueEntry);
+                    m_cue.db.Raise(Database::Flag::kSaveSongs | Database::Flag::kSaveArtists);
+                }
+            }
+
+            // the player opens its audio output, a worker does it too
+            Core::AddJob([this, job = SmartPtr<PreloadJob>(job), song = SmartPtr<SongSheet>(playableSong)]()
+            {
+                if (!std::atomic_ref(job->isCancelled).load())
+                    job->player = Player::Create(job->musicId, song, std::exchange(job->replay, nullptr), job->stream);
+                Core::FromJob([this, job]()
+                {
+                    if (!job->isCancelled)
+                        OnPreloadedPlayer(job);
+                });
+            }, &m_preload.jobs);
+        }
+        else
+        {
+            // deleted by UpdateSong
+            job->replay = nullptr;
+            if (numEntries != m_cue.entries.NumItems<int32_t>())
+                PreloadNextSong(false);
+            else
+                SkipPreloadedEntry();
+        }
+    }
+
+    void Playlist::OnPreloadedPlayer(PreloadJob* job)
+    {
+        if (job->player.IsValid())
+        {
+            m_preload.player = std::move(job->player);
+            m_preload.job.Reset();
+            m_preload.isPending = false;
+        }
+        else
+            SkipPreloadedEntry();
+    }
+
     void Playlist::ProcessBrowserSong(const BrowserSong& browserSong, ProcessMode mode)
     {
         MusicID musicId;
@@ -1583,335 +1923,404 @@ namespace rePlayer
 
     void Playlist::AddFiles(int32_t droppedEntryIndex, const Array<std::string>& files, bool isAcceptingAll, bool isUrl)
     {
-        // we're going async for that: do the hard work in the job (identify the file, replay loading, tag), then add the processed files in the playlist (fast work)
+        // we're going async for that: the walk identifies the files, then the scan jobs do the hard work (replay loading, tag) in parallel
+        // and the processed files are added in the playlist on the main thread (fast work)
         auto* addFilesContext = new AddFilesContext;
         addFilesContext->files = files;
         addFilesContext->droppedEntryIndex = droppedEntryIndex;
         addFilesContext->isAcceptingAll = isAcceptingAll;
         addFilesContext->isUrl = isUrl;
+        addFilesContext->databaseDay = uint16_t((std::chrono::sys_days(std::chrono::floor<std::chrono::days>(std::chrono::system_clock::now())) - std::chrono::sys_days(std::chrono::days(Core::kReferenceDate))).count());
         addFilesContext->next = m_addFilesContext;
         m_addFilesContext = addFilesContext;
 
-        Core::AddJob([this, addFilesContext]()
+        addFilesContext->numJobs++;
+        Core::AddJob([addFilesContext]()
         {
-            auto& replays = Core::GetReplays();
-            auto databaseDay = uint16_t((std::chrono::sys_days(std::chrono::floor<std::chrono::days>(std::chrono::system_clock::now())) - std::chrono::sys_days(std::chrono::days(Core::kReferenceDate))).count());
+            addFilesContext->Walk();
+        });
+    }
 
-            for (auto& newFile : addFilesContext->files)
+    void Playlist::AddFilesContext::Walk()
+    {
+        while (!isCancel)
+        {
+            // resume the current directory
+            std::error_code ec;
+            for (; dirIterator != std::filesystem::end(dirIterator) && !isCancel; dirIterator.increment(ec))
             {
-                auto addFile = [&](const std::filesystem::path& path)
+                if (ec)
                 {
-                    // find the extension (or prefixes)
-                    auto guessedExtension = path.has_extension() ? path.extension().u8string().substr(1) : std::u8string();
-                    const auto pathExtension = guessedExtension;
-                    const auto pathStem = path.stem().u8string();
-                    {
-                        std::u8string prefix;
-                        for (uint16_t i = 0;; i++)
-                        {
-                            if (i == uint16_t(eExtension::Count))
-                            {
-                                if (!prefix.empty())
-                                    guessedExtension = prefix;
-                                break;
-                            }
-                            if (_stricmp(reinterpret_cast<const char*>(guessedExtension.c_str()), MediaType::extensionNames[i]) == 0)
-                                break;
-                            if (prefix.empty() && _strnicmp(MediaType::extensionNames[i], reinterpret_cast<const char*>(pathStem.c_str()), MediaType::extensionLengths[i]) == 0)
-                            {
-                                if (MediaType::extensionLengths[i] == pathStem.size() || pathStem[MediaType::extensionLengths[i]] == '.')
-                                    prefix = reinterpret_cast<const char8_t*>(MediaType::extensionNames[i]);
-                            }
-                        }
-                    }
+                    dirIterator = {};
+                    break;
+                }
+                if (PauseWalk())
+                {
+                    numJobs--;
+                    return;
+                }
+                if (dirIterator->is_regular_file(ec))
+                    AddFile(dirIterator->path());
+            }
 
-                    MediaType type = replays.Find(reinterpret_cast<const char*>(guessedExtension.c_str()));
-                    if (!addFilesContext->isAcceptingAll && type.value == 0 && !addFilesContext->isUrl)
-                    {
-                        addFilesContext->Lock();
-                        addFilesContext->failedEntries.Add(reinterpret_cast<const char*>(path.u8string().c_str()));
-                        addFilesContext->Unlock();
-                        return;
-                    }
-                    addFilesContext->numEntries++;
+            if (fileIndex == files.NumItems() || isCancel)
+                break;
+            if (PauseWalk())
+            {
+                numJobs--;
+                return;
+            }
 
-                    auto* songSheet = new SongSheet;
-                    songSheet->type = type;
-                    if (type.ext == eExtension::Unknown)
-                        songSheet->name = reinterpret_cast<const char*>(path.filename().u8string().c_str());
-                    else if (_stricmp(reinterpret_cast<const char*>(pathExtension.c_str()), type.GetExtension()) == 0)
-                        songSheet->name = reinterpret_cast<const char*>(pathStem.c_str());
-                    else
-                    {
-                        auto name = path.filename().u8string();
-                        auto extSize = type.extensionLengths[size_t(type.ext)];
-                        if (_strnicmp(reinterpret_cast<const char*>(name.c_str()), type.GetExtension(), extSize) == 0 && name.size() > extSize && name.c_str()[extSize] == '.')
-                            songSheet->name = reinterpret_cast<const char*>(name.c_str() + extSize + 1);
-                        else
-                            songSheet->name = reinterpret_cast<const char*>(name.c_str());
-                    }
-                    if (addFilesContext->isUrl)
-                    {
-                        auto* curl = curl_easy_init();
+            auto& newFile = files[fileIndex++];
+            auto path = std::filesystem::path(reinterpret_cast<const char8_t*>(newFile.c_str()));
+            if (isUrl)
+            {
+                assert(strcmp((const char*)path.u8string().c_str(), newFile.c_str()) == 0);
+                AddFile(path);
+            }
+            else if (std::filesystem::is_directory(path, ec))
+                dirIterator = std::filesystem::recursive_directory_iterator(path, ec);
+            else if (std::filesystem::is_regular_file(path, ec))
+                AddFile(path);
+        }
 
-                        int nameSize = 0;
-                        if (auto* name = curl_easy_unescape(curl, songSheet->name.String().c_str(), int(songSheet->name.String().size()), &nameSize))
-                        {
-                            songSheet->name = name;
-                            curl_free(name);
-                        }
+        isWalkDone = true;
+        numJobs--;
+    }
 
-                        curl_easy_cleanup(curl);
-                    }
+    void Playlist::AddFilesContext::AddFile(const std::filesystem::path& path)
+    {
+        auto& replays = Core::GetReplays();
 
-                    songSheet->databaseDay = databaseDay;
-                    songSheet->subsongs.Resize(1);
+        // find the extension (or prefixes)
+        auto guessedExtension = path.has_extension() ? path.extension().u8string().substr(1) : std::u8string();
+        const auto pathExtension = guessedExtension;
+        const auto pathStem = path.stem().u8string();
+        if (MediaType::FindExtension(reinterpret_cast<const char*>(guessedExtension.c_str()), guessedExtension.size()) == eExtension::Unknown)
+        {
+            // a prefix is everything before the first dot of the stem
+            auto prefixSize = Min(pathStem.find('.'), pathStem.size());
+            if (MediaType::FindExtension(reinterpret_cast<const char*>(pathStem.c_str()), prefixSize) != eExtension::Unknown)
+                guessedExtension = pathStem.substr(0, prefixSize);
+        }
 
-                    addFilesContext->Lock();
-                    addFilesContext->entries.Add({ reinterpret_cast<const char*>(path.u8string().c_str()), songSheet });
-                    addFilesContext->Unlock();
-                };
+        MediaType type = replays.Find(reinterpret_cast<const char*>(guessedExtension.c_str()));
+        if (!isAcceptingAll && type.value == 0 && !isUrl)
+        {
+            Lock();
+            failedEntries.Add(reinterpret_cast<const char*>(path.u8string().c_str()));
+            Unlock();
+            return;
+        }
+        numEntries++;
+
+        auto* songSheet = new SongSheet;
+        songSheet->type = type;
+        if (type.ext == eExtension::Unknown)
+            songSheet->name = reinterpret_cast<const char*>(path.filename().u8string().c_str());
+        else if (_stricmp(reinterpret_cast<const char*>(pathExtension.c_str()), type.GetExtension()) == 0)
+            songSheet->name = reinterpret_cast<const char*>(pathStem.c_str());
+        else
+        {
+            auto name = path.filename().u8string();
+            auto extSize = type.extensionLengths[size_t(type.ext)];
+            if (_strnicmp(reinterpret_cast<const char*>(name.c_str()), type.GetExtension(), extSize) == 0 && name.size() > extSize && name.c_str()[extSize] == '.')
+                songSheet->name = reinterpret_cast<const char*>(name.c_str() + extSize + 1);
+            else
+                songSheet->name = reinterpret_cast<const char*>(name.c_str());
+        }
+        if (isUrl)
+        {
+            auto* curl = curl_easy_init();
 
-                auto path = std::filesystem::path(reinterpret_cast<const char8_t*>(newFile.c_str()));
-                if (addFilesContext->isUrl)
-                {
-                    assert(strcmp((const char*)path.u8string().c_str(), newFile.c_str()) == 0);
-                    addFile(path);
-                }
-                else
+            int nameSize = 0;
+            if (auto* name = curl_easy_unescape(curl, songSheet->name.String().c_str(), int(songSheet->name.String().size()), &nameSize))
+            {
+                songSheet->name = name;
+                curl_free(name);
+            }
+
+            curl_easy_cleanup(curl);
+        }
+
+        songSheet->databaseDay = databaseDay;
+        songSheet->subsongs.Resize(1);
+
+        Lock();
+        entries.Add({ reinterpret_cast<const char*>(path.u8string().c_str()), songSheet });
+        Unlock();
+    }
+
+    void Playlist::AddFilesContext::Scan()
+    {
+        // each job reads or probes a single file, then queues the next ones: the other jobs get the workers in between
+        // two workers are left to the player update (it never leaves its job) and to the other jobs
+        auto maxJobs = Max(Core::NumWorkers(), 3u) - 2;
+
+        Array<EntryToScan> entriesToRead;
+        Array<EntryToProbe> entriesToProbeNow;
+        Lock();
+        if (!isCancel)
+        {
+            // the probes go first as they release the read files, but one job is kept for the reads
+            auto maxProbeJobs = (nextEntryToScan < entriesToScan.NumItems() && maxJobs > 1) ? maxJobs - 1 : maxJobs;
+            while (entriesToProbe.IsNotEmpty() && numProbeJobs < maxProbeJobs && numReadJobs + numProbeJobs < maxJobs)
+            {
+                entriesToProbeNow.Add(std::move(entriesToProbe[0]));
+                entriesToProbe.RemoveAt(0);
+                numProbeJobs++;
+            }
+            while (nextEntryToScan < entriesToScan.NumItems() && numReadJobs < kMaxReadJobs && numReadJobs + numProbeJobs < maxJobs
+                && numReadJobs + entriesToProbe.NumItems() < kMaxReadEntries)
+            {
+                entriesToRead.Add(std::move(entriesToScan[nextEntryToScan++]));
+                numReadJobs++;
+            }
+            if (nextEntryToScan == entriesToScan.NumItems())
+            {
+                entriesToScan.Clear();
+                nextEntryToScan = 0;
+            }
+        }
+        numJobs += entriesToRead.NumItems() + entriesToProbeNow.NumItems();
+        Unlock();
+
+        for (auto& entry : entriesToRead)
+        {
+            Core::AddJob([this, entry = std::move(entry)]()
+            {
+                ReadFile(entry);
+            });
+        }
+        for (auto& entryToProbe : entriesToProbeNow)
+        {
+            Core::AddJob([this, entryToProbe = std::move(entryToProbe)]()
+            {
+                ProbeFile(entryToProbe);
+            });
+        }
+    }
+
+    void Playlist::AddFilesContext::ReadFile(const EntryToScan& entry)
+    {
+        // the whole file is loaded here, so the probe only works from memory (the crc also saves the one of the replays probe cache)
+        SmartPtr<io::Stream> stream;
+        uint32_t fileCrc = 0;
+        if (isUrl)
+            stream = StreamUrl::Create(entry.path);
+        else if (!isCancel)
+        {
+            stream = io::StreamFile::Create(entry.path);
+            if (stream.IsValid())
+            {
+                auto fileData = stream->Read();
+                fileCrc = crc32_z(crc32(0L, Z_NULL, 0), fileData.Items(), fileData.Size());
+            }
+        }
+
+        Lock();
+        entriesToProbe.Add({ entry, stream, fileCrc });
+        numReadJobs--;
+        Unlock();
+
+        Scan();
+        numJobs--;
+    }
+
+    void Playlist::AddFilesContext::ProbeFile(const EntryToProbe& entryToProbe)
+    {
+        auto& replays = Core::GetReplays();
+        auto& entry = entryToProbe.entry;
+
+        // the songs of an archive are pushed together as UpdateFiles expects them in a row
+        Array<EntryToUpdate> newEntriesToUpdate;
+
+        numEntries--;
+        SmartPtr<io::Stream> stream = entryToProbe.stream;
+        if (stream.IsInvalid())
+            newEntriesToUpdate.Add({ nullptr, "!", entry.playlistId});
+        else
+        {
+            SmartPtr<io::Stream> streamArchive = StreamArchive::Create(stream, true);
+            if (streamArchive.IsValid())
+                stream = streamArchive;
+
+            bool isAdded = false;
+            bool isArchiveRaw = false;
+            for (;;)
+            {
+                if (isCancel)
+                    break;
+
+                // the crc of the read file is only valid for the file itself, not for the entries of an archive
+                auto isReadFile = !isUrl && stream == entryToProbe.stream.Get();
+                auto streamSize = stream->GetSize();
+                auto fileSize = isReadFile ? uint32_t(streamSize) : 0u;
+                auto fileCrc = isReadFile ? entryToProbe.fileCrc : 0u;
+
+                Array<CommandBuffer::Command> commands;
+                if (auto* replay = replays.Load(stream, commands, entry.type, fileSize, fileCrc))
                 {
-                    std::error_code ec;
-                    if (std::filesystem::is_directory(path, ec))
+                    isAdded = true;
+
+                    auto* songSheet = new SongSheet;
+                    songSheet->type = replay->GetMediaType();
+                    songSheet->fileSize = uint32_t(streamSize);
+                    if (IS_FILECRC_ENABLED)
+                        songSheet->fileCrc = isReadFile ? fileCrc : ComputeFileCrc(stream, streamSize);
+                    auto numSubsongs = replay->GetNumSubsongs();
+                    songSheet->subsongs.Resize(numSubsongs);
+                    songSheet->lastSubsongIndex = uint16_t(numSubsongs - 1);
+                    for (uint16_t i = 0; i < numSubsongs; i++)
                     {
-                        for (const std::filesystem::directory_entry& dir_entry : std::filesystem::recursive_directory_iterator(path, ec))
+                        replay->SetSubsong(i);
+
+                        auto& subsong = songSheet->subsongs[i];
+                        subsong.Clear();
+                        subsong.durationCs = replay->GetDurationMs() / 10;
+                        subsong.isDirty = false;
+                        if (numSubsongs > 1)
                         {
-                            if (dir_entry.is_regular_file(ec))
-                                addFile(dir_entry.path());
-                            if (addFilesContext->isCancel)
-                                break;
+                            subsong.name = replay->GetSubsongTitle();
+                            if (subsong.name.IsEmpty())
+                            {
+                                char txt[32];
+                                sprintf(txt, "subsong %u of %u", i + 1, numSubsongs);
+                                subsong.name = txt;
+                            }
                         }
                     }
-                    else if (std::filesystem::is_regular_file(path, ec))
-                        addFile(path);
-                }
-                if (addFilesContext->isCancel)
-                    break;
-            }
-            while (addFilesContext->numEntries.load() && !addFilesContext->isCancel)
-            {
-                addFilesContext->Lock();
-                auto entriesToScan = std::move(addFilesContext->entriesToScan);
-                addFilesContext->Unlock();
-                if (entriesToScan.IsEmpty())
-                    thread::Sleep(1);
+                    songSheet->metadata.Container() = commands;
 
-                for (auto& entry : entriesToScan)
-                {
-                    if (addFilesContext->isCancel)
-                        break;
+                    delete replay;
 
-                    addFilesContext->numEntries--;
-                    SmartPtr<io::Stream> stream;
-                    if (addFilesContext->isUrl)
-                        stream = StreamUrl::Create(entry.path);
-                    else
-                        stream = io::StreamFile::Create(entry.path);
-                    if (stream.IsInvalid())
+                    std::string artist;
+                    if (streamArchive.IsValid())
                     {
-                        addFilesContext->Lock();
-                        addFilesContext->entriesToUpdate.Add({ nullptr, "!", entry.playlistId});
-                        addFilesContext->Unlock();
+                        if (!isArchiveRaw)
+                            songSheet->sourceIds.Add(SourceID(SourceID::FileImportID, 0));
+                        songSheet->name.String() = stream->GetName();
+                        songSheet->subsongs[0].isArchive = true;
+                        songSheet->subsongs[0].isPackage = true;
                     }
-                    else
+                    else if (!isUrl)
                     {
-                        SmartPtr<io::Stream> streamArchive = StreamArchive::Create(stream, true);
-                        if (streamArchive.IsValid())
-                            stream = streamArchive;
-
-                        bool isAdded = false;
-                        bool isArchiveRaw = false;
-                        for (;;)
+                        TagLib::FileStream fStream(io::File::Convert(entry.path.c_str()).c_str(), true);
+                        TagLib::FileRef f(&fStream);
+                        if (auto* tag = f.tag())
                         {
-                            if (addFilesContext->isCancel)
-                                break;
-
-                            Array<CommandBuffer::Command> commands;
-                            if (auto* replay = replays.Load(stream, commands, entry.type))
+                            if (!tag->title().isEmpty())
                             {
-                                isAdded = true;
-
-                                auto* songSheet = new SongSheet;
-                                songSheet->type = replay->GetMediaType();
-                                auto streamSize = stream->GetSize();
-                                songSheet->fileSize = uint32_t(streamSize);
-                                if (IS_FILECRC_ENABLED)
+                                if (!tag->album().isEmpty())
                                 {
-                                    auto fileCrc = crc32(0L, Z_NULL, 0);
-                                    auto* moduleData = core::Alloc<uint8_t>(65536);
-                                    for (uint64_t s = 0; s < streamSize; s += 65536)
-                                    {
-                                        auto readSize = stream->Read(moduleData, 65536);
-                                        fileCrc = crc32_z(fileCrc, moduleData, size_t(readSize));
-                                    }
-                                    core::Free(moduleData);
-                                    songSheet->fileCrc = fileCrc;
-                                }
-                                auto numSubsongs = replay->GetNumSubsongs();
-                                songSheet->subsongs.Resize(numSubsongs);
-                                songSheet->lastSubsongIndex = uint16_t(numSubsongs - 1);
-                                for (uint16_t i = 0; i < numSubsongs; i++)
-                                {
-                                    replay->SetSubsong(i);
+                                    songSheet->name = tag->album().toCString(true);
+                                    songSheet->name.String() += '/';
 
-                                    auto& subsong = songSheet->subsongs[i];
-                                    subsong.Clear();
-                                    subsong.durationCs = replay->GetDurationMs() / 10;
-                                    subsong.isDirty = false;
-                                    if (numSubsongs > 1)
+                                    // get id3v2 tags to check if we have a disc number
+                                    TagLib::MPEG::File fMpeg(&fStream, true, TagLib::MPEG::Properties::Average, TagLib::ID3v2::FrameFactory::instance());
+                                    if (auto* id3v2Tag = fMpeg.ID3v2Tag())
                                     {
-                                        subsong.name = replay->GetSubsongTitle();
-                                        if (subsong.name.IsEmpty())
+                                        auto properties = id3v2Tag->properties();
+                                        for (auto it = properties.begin(), e = properties.end(); it != e; it++)
                                         {
-                                            char txt[32];
-                                            sprintf(txt, "subsong %u of %u", i + 1, numSubsongs);
-                                            subsong.name = txt;
-                                        }
-                                    }
-                                }
-                                songSheet->metadata.Container() = commands;
-
-                                delete replay;
-
-                                std::string artist;
-                                if (streamArchive.IsValid())
-                                {
-                                    if (!isArchiveRaw)
-                                        songSheet->sourceIds.Add(SourceID(SourceID::FileImportID, 0));
-                                    songSheet->name.String() = stream->GetName();
-                                    songSheet->subsongs[0].isArchive = true;
-                                    songSheet->subsongs[0].isPackage = true;
-                                }
-                                else if (!addFilesContext->isUrl)
-                                {
-                                    TagLib::FileStream fStream(io::File::Convert(entry.path.c_str()).c_str(), true);
-                                    TagLib::FileRef f(&fStream);
-                                    if (auto* tag = f.tag())
-                                    {
-                                        if (!tag->title().isEmpty())
-                                        {
-                                            if (!tag->album().isEmpty())
+                                            if (_stricmp(it->first.toCString(), "discnumber") == 0)
                                             {
-                                                songSheet->name = tag->album().toCString(true);
-                                                songSheet->name.String() += '/';
-
-                                                // get id3v2 tags to check if we have a disc number
-                                                TagLib::MPEG::File fMpeg(&fStream, true, TagLib::MPEG::Properties::Average, TagLib::ID3v2::FrameFactory::instance());
-                                                if (auto* id3v2Tag = fMpeg.ID3v2Tag())
-                                                {
-                                                    auto properties = id3v2Tag->properties();
-                                                    for (auto it = properties.begin(), e = properties.end(); it != e; it++)
-                                                    {
-                                                        if (_stricmp(it->first.toCString(), "discnumber") == 0)
-                                                        {
-                                                            uint32_t disc = 0;
-                                                            if (sscanf_s(it->second[0].toCString(), "%u", &disc) == 1)
-                                                            {
-                                                                char buf[16];
-                                                                sprintf(buf, "%u ", disc);
-                                                                songSheet->name.String() += buf;
-                                                            }
-                                                            else if (!it->second[0].isEmpty()) // weird format?
-                                                            {
-                                                                songSheet->name.String() += it->second[0].toCString();
-                                                                songSheet->name.String() += ' ';
-                                                            }
-                                                            break;
-                                                        }
-                                                    }
-                                                }
-
-                                                if (tag->track())
+                                                uint32_t disc = 0;
+                                                if (sscanf_s(it->second[0].toCString(), "%u", &disc) == 1)
                                                 {
                                                     char buf[16];
-                                                    sprintf(buf, "%02u ", tag->track());
+                                                    sprintf(buf, "%u ", disc);
                                                     songSheet->name.String() += buf;
                                                 }
-                                                songSheet->name.String() += tag->title().toCString(true);
+                                                else if (!it->second[0].isEmpty()) // weird format?
+                                                {
+                                                    songSheet->name.String() += it->second[0].toCString();
+                                                    songSheet->name.String() += ' ';
+                                                }
+                                                break;
                                             }
-                                            else
-                                                songSheet->name = tag->title().toCString(true);
-                                        }
-                                        songSheet->releaseYear = uint16_t(tag->year());
-
-                                        if (!tag->artist().isEmpty())
-                                        {
-                                            auto artistTag = tag->artist();
-                                            artist = artistTag.toCString(true);
                                         }
                                     }
-                                }
 
-                                addFilesContext->Lock();
-                                addFilesContext->entriesToUpdate.Add({ songSheet, artist, entry.playlistId });
-                                addFilesContext->Unlock();
-                            }
-                            else if (streamArchive.IsValid())
-                            {
-                                auto* songSheet = new SongSheet;
-
-                                auto streamSize = stream->GetSize();
-                                songSheet->fileSize = uint32_t(streamSize);
-                                if (IS_FILECRC_ENABLED)
-                                {
-                                    auto fileCrc = crc32(0L, Z_NULL, 0);
-                                    auto* moduleData = core::Alloc<uint8_t>(65536);
-                                    for (uint64_t s = 0; s < streamSize; s += 65536)
+                                    if (tag->track())
                                     {
-                                        auto readSize = stream->Read(moduleData, 65536);
-                                        fileCrc = crc32_z(fileCrc, moduleData, size_t(readSize));
+                                        char buf[16];
+                                        sprintf(buf, "%02u ", tag->track());
+                                        songSheet->name.String() += buf;
                                     }
-                                    core::Free(moduleData);
-                                    songSheet->fileCrc = fileCrc;
+                                    songSheet->name.String() += tag->title().toCString(true);
                                 }
-                                songSheet->subsongs[0].isInvalid = true;
-
-                                if (!isArchiveRaw)
-                                    songSheet->name.String() = stream->GetName();
-                                songSheet->subsongs[0].isArchive = true;
-                                songSheet->subsongs[0].isPackage = true;
-
-                                addFilesContext->Lock();
-                                addFilesContext->entriesToUpdate.Add({ songSheet, {}, entry.playlistId });
-                                addFilesContext->Unlock();
+                                else
+                                    songSheet->name = tag->title().toCString(true);
                             }
+                            songSheet->releaseYear = uint16_t(tag->year());
 
-                            auto newStream = stream->Next(true);
-                            if (newStream.IsInvalid())
+                            if (!tag->artist().isEmpty())
                             {
-                                if (streamArchive.IsInvalid())
-                                    streamArchive = newStream = StreamArchiveRaw::Create(stream);
-                                if (newStream.IsInvalid())
-                                {
-                                    if (!isAdded)
-                                    {
-                                        addFilesContext->Lock();
-                                        addFilesContext->entriesToUpdate.Add({ nullptr, {}, entry.playlistId });
-                                        addFilesContext->Unlock();
-                                    }
-                                    break;
-                                }
-                                isArchiveRaw = true;
+                                auto artistTag = tag->artist();
+                                artist = artistTag.toCString(true);
                             }
-                            stream = std::move(newStream);
                         }
                     }
+
+                    newEntriesToUpdate.Add({ songSheet, artist, entry.playlistId });
                 }
+                else if (streamArchive.IsValid())
+                {
+                    auto* songSheet = new SongSheet;
+
+                    songSheet->fileSize = uint32_t(streamSize);
+                    if (IS_FILECRC_ENABLED)
+                        songSheet->fileCrc = isReadFile ? fileCrc : ComputeFileCrc(stream, streamSize);
+                    songSheet->subsongs[0].isInvalid = true;
+
+                    if (!isArchiveRaw)
+                        songSheet->name.String() = stream->GetName();
+                    songSheet->subsongs[0].isArchive = true;
+                    songSheet->subsongs[0].isPackage = true;
+
+                    newEntriesToUpdate.Add({ songSheet, {}, entry.playlistId });
+                }
+
+                auto newStream = stream->Next(true);
+                if (newStream.IsInvalid())
+                {
+                    if (streamArchive.IsInvalid())
+                        streamArchive = newStream = StreamArchiveRaw::Create(stream);
+                    if (newStream.IsInvalid())
+                    {
+                        if (!isAdded)
+                            newEntriesToUpdate.Add({ nullptr, {}, entry.playlistId });
+                        break;
+                    }
+                    isArchiveRaw = true;
+                }
+                stream = std::move(newStream);
             }
+        }
 
-            addFilesContext->Lock();
-            addFilesContext->isDone = true;
-            addFilesContext->Unlock();
-        });
+        if (newEntriesToUpdate.IsNotEmpty())
+        {
+            Lock();
+            for (auto& entryToUpdate : newEntriesToUpdate)
+                entriesToUpdate.Add(std::move(entryToUpdate));
+            Unlock();
+        }
+
+        Lock();
+        numProbeJobs--;
+        Unlock();
+
+        if (ResumeWalk())
+        {
+            numJobs++;
+            Core::AddJob([this]()
+            {
+                Walk();
+            });
+        }
+        Scan();
+        numJobs--;
     }
 
     void Playlist::UpdateFiles()
@@ -1919,11 +2328,13 @@ namespace rePlayer
         AddFilesContext* prev = nullptr;
         for (auto* addFilesContext = m_addFilesContext; addFilesContext;)
         {
+            // no more jobs means all their results are in the lists
+            auto isDone = addFilesContext->numJobs.load() == 0 && (addFilesContext->isCancel || (addFilesContext->isWalkDone && addFilesContext->numEntries.load() == 0));
+
             addFilesContext->Lock();
             auto entries = std::move(addFilesContext->entries);
             auto entriesToUpdate = std::move(addFilesContext->entriesToUpdate);
             auto failedEntries = std::move(addFilesContext->failedEntries);
-            auto isDone = addFilesContext->isDone;
             addFilesContext->Unlock();
 
             for (auto& failedEntry : failedEntries)
@@ -2106,6 +2517,23 @@ namespace rePlayer
             }
             if (currentPlayingEntry.subsongId.IsValid())
                 m_currentEntryIndex = m_cue.entries.Find<uint32_t>(currentPlayingEntry.playlistId);
+
+            if (!isDone)
+            {
+                // the existing songs don't need a scan
+                if (addFilesContext->ResumeWalk())
+                {
+                    addFilesContext->numJobs++;
+                    Core::AddJob([addFilesContext]()
+                    {
+                        addFilesContext->Walk();
+                    });
+                }
+
+                // start the scan of the new files (the running jobs keep it going)
+                addFilesContext->Scan();
+            }
+
             auto* next = addFilesContext->next;
             if (isDone)
             {
@@ -2132,6 +2560,9 @@ namespace rePlayer
 
     void Playlist::Flush()
     {
+        // the callbacks of the cancelled preload run in WaitJobs, on this thread, and leave the playlist alone
+        CancelPreload();
+        Core::WaitJobs(m_preload.jobs);
         for (auto* addFilesContext = m_addFilesContext; addFilesContext; addFilesContext = addFilesContext->next)
             addFilesContext->isCancel = true;
         while (m_addFilesContext)
@@ -3,6 +3,7 @@
 #include <Containers/Array.h>
 #include <Containers/SmartPtr.h>
 #include <Core/Window.h>
+#include <Thread/Workers.h>
 
 #include <Database/Types/MusicID.h>
 #include <RePlayer/CoreHeader.h>
@@ -22,7 +23,9 @@ namespace rePlayer
     class DatabaseSongsUI;
     class Player;
     class PlaylistDatabase;
+    class Replay;
     struct BrowserSong;
+    struct SongSheet;
 
     class Playlist : public Window
     {
@@ -51,9 +54,15 @@ namespace rePlayer
         SmartPtr<Player> LoadNextSong(bool isAdvancing);
         void ValidateNextSong(SmartPtr<Player>& player);
 
+        // LoadNextSong through the workers, the player is available with GetPreloadedSong once ready
+        void PreloadNextSong(bool isAdvancing);
+        SmartPtr<Player> GetPreloadedSong();
+        bool IsPreloading() const { return m_preload.isPending; }
+        void CancelPreload();
+
         void ProcessBrowserSong(const BrowserSong& browserSong, ProcessMode mode);
 
-        void Eject() { m_currentEntryIndex = -1; }
+        void Eject() { CancelPreload(); m_currentEntryIndex = -1; }
 
         uint32_t NumEntries() const { return m_cue.entries.NumItems(); }
         int32_t GetCurrentEntryIndex() const { return m_currentEntryIndex; }
@@ -91,6 +100,7 @@ namespace rePlayer
         };
 
         struct AddFilesContext;
+        struct PreloadJob;
 
         class DropTarget;
         class SongsUI;
@@ -113,6 +123,17 @@ namespace rePlayer
         void ButtonClear();
         void ButtonSort();
 
+        SmartPtr<core::io::Stream> OpenSong(const MusicID musicId);
+        SmartPtr<Player> LoadSong(const MusicID musicId, SmartPtr<core::io::Stream> stream, Replay* replay, bool hasMetadataChanged);
+        SongSheet* UpdateSong(const MusicID musicId, core::io::Stream* stream, Replay* replay, bool hasMetadataChanged, bool& hasChanged);
+
+        void PreloadNextEntry();
+        bool OpenPreloadedSong(PreloadJob* job);
+        void SkipPreloadedEntry();
+        void PrefetchNextEntries();
+        void OnPreloaded(PreloadJob* job);
+        void OnPreloadedPlayer(PreloadJob* job);
+
         void AddFiles(int32_t droppedEntryIndex, const Array<std::string>& files, bool isAcceptingAll, bool isUrl);
         void UpdateFiles();
 
@@ -136,6 +157,17 @@ namespace rePlayer
         uint32_t m_draggedEntryIndex = 0;
         AddFilesContext* m_addFilesContext = nullptr;
 
+        // next song loaded by the workers, a cancelled job is left to finish on its own
+        struct
+        {
+            SmartPtr<Player> player;
+            SmartPtr<PreloadJob> job; // in flight
+            thread::JobCounter jobs;
+            int32_t entryIndex = -1;
+            int32_t lastEntryIndex = -1;
+            bool isPending = false;
+        } m_preload;
+
         int32_t m_oldCurrentEntryIndex = -1;
         int32_t m_currentEntryIndex = -1;
         bool m_isCurrentEntryFocus = true;
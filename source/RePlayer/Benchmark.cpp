@@ -0,0 +1,372 @@
+// Core
+#include <Audio/AudioTypes.inl.h>
+#include <Core/Log.h>
+#include <IO/StreamFile.h>
+
+// rePlayer
+#include <Deck/Player.h>
+#include <RePlayer/Core.h>
+#include <RePlayer/Replays.h>
+#include <Replays/Replay.h>
+
+#include "Benchmark.h"
+
+// stl
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+
+namespace rePlayer
+{
+    bool Benchmark::IsRequested(int32_t argc, const wchar_t* const* argv)
+    {
+        for (int32_t i = 1; i < argc; i++)
+        {
+            if (_wcsicmp(argv[i], L"--benchmark") == 0)
+                return true;
+        }
+        return false;
+    }
+
+    int32_t Benchmark::Run(int32_t argc, const wchar_t* const* argv)
+    {
+        uint32_t durationInSeconds = 60;
+        std::string csvFilename;
+        Array<std::string> paths;
+        bool isComparingKernels = false;
+        for (int32_t i = 1; i < argc; i++)
+        {
+            if (_wcsicmp(argv[i], L"--benchmark") == 0)
+                continue;
+            if (_wcsicmp(argv[i], L"--kernels") == 0)
+                isComparingKernels = true;
+            else if (_wcsicmp(argv[i], L"--seconds") == 0 && i + 1 < argc)
+                durationInSeconds = uint32_t(wcstoul(argv[++i], nullptr, 10));
+            else if (_wcsicmp(argv[i], L"--csv") == 0 && i + 1 < argc)
+                csvFilename = reinterpret_cast<const char*>(std::filesystem::path(argv[++i]).u8string().c_str());
+            else
+                paths.Add(reinterpret_cast<const char*>(std::filesystem::path(argv[i]).u8string().c_str()));
+        }
+        if ((paths.IsEmpty() && !isComparingKernels) || durationInSeconds == 0)
+        {
+            printf("usage: rePlayer.exe --benchmark [--kernels] [--seconds N] [--csv report.csv] <file|directory|@list.txt>...\n");
+            return -1;
+        }
+
+        int32_t exitCode = 0;
+        if (isComparingKernels && !CompareKernels())
+            exitCode = 1;
+        if (paths.IsEmpty())
+            return exitCode;
+
+        Benchmark benchmark(durationInSeconds);
+        for (auto& path : paths)
+            benchmark.Enqueue(path);
+        benchmark.Update();
+        benchmark.Report(csvFilename.empty() ? nullptr : csvFilename.c_str());
+
+        for (auto& stats : benchmark.m_stats)
+        {
+            if (stats.numFailures)
+                return 1;
+        }
+        return exitCode;
+    }
+
+    Benchmark::Benchmark(uint32_t durationInSeconds)
+        : m_durationInSeconds(durationInSeconds)
+    {}
+
+    void Benchmark::Enqueue(const std::string& path)
+    {
+        // list of files
+        if (path[0] == '@')
+        {
+            std::ifstream file(std::filesystem::path(reinterpret_cast<const char8_t*>(path.c_str() + 1)));
+            for (std::string line; std::getline(file, line);)
+            {
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                if (!line.empty())
+                    Enqueue(line);
+            }
+            return;
+        }
+
+        std::error_code ec;
+        auto fsPath = std::filesystem::path(reinterpret_cast<const char8_t*>(path.c_str()));
+        if (std::filesystem::is_directory(fsPath, ec))
+        {
+            // sorted, to keep the reports reproducible
+            Array<std::string> files;
+            for (const std::filesystem::directory_entry& dirEntry : std::filesystem::recursive_directory_iterator(fsPath, ec))
+            {
+                if (dirEntry.is_regular_file(ec))
+                    files.Add(reinterpret_cast<const char*>(dirEntry.path().u8string().c_str()));
+            }
+            std::sort(files.begin(), files.end());
+            for (auto& file : files)
+                m_files.Add(std::move(file));
+        }
+        else if (std::filesystem::is_regular_file(fsPath, ec))
+            m_files.Add(path);
+        else
+            Log::Warning("Benchmark: can't find \"%s\"\n", path.c_str());
+    }
+
+    void Benchmark::Update()
+    {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        for (auto& file : m_files)
+            Render(file);
+        m_wallTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+    }
+
+    void Benchmark::Render(const std::string& path)
+    {
+        using Clock = std::chrono::high_resolution_clock;
+
+        auto& replays = Core::GetReplays();
+        auto fsPath = std::filesystem::path(reinterpret_cast<const char8_t*>(path.c_str()));
+        auto extension = fsPath.has_extension() ? fsPath.extension().u8string().substr(1) : std::u8string();
+        auto type = replays.Find(reinterpret_cast<const char*>(extension.c_str()));
+
+        auto stream = io::StreamFile::Create(path);
+        if (stream.IsInvalid())
+        {
+            m_stats[size_t(type.replay)].numFailures++;
+            Log::Error("Benchmark: can't open \"%s\"\n", path.c_str());
+            return;
+        }
+
+        Array<CommandBuffer::Command> commands;
+        auto loadTime = Clock::now();
+        auto* replay = replays.Load(stream, commands, type);
+        auto renderTime = Clock::now();
+        if (replay == nullptr)
+        {
+            m_stats[size_t(type.replay)].numFailures++;
+            Log::Error("Benchmark: can't load \"%s\"\n", path.c_str());
+            return;
+        }
+
+        auto& stats = m_stats[size_t(replay->GetMediaType().replay)];
+        stats.numFiles++;
+        stats.loadTime += std::chrono::duration<double>(renderTime - loadTime).count();
+
+        if (replay->IsStreaming())
+        {
+            // streams never end and are realtime only
+            delete replay;
+            return;
+        }
+
+        SmartPtr<SongSheet> songSheet(new SongSheet);
+        songSheet->type = replay->GetMediaType();
+        songSheet->subsongs.Resize(replay->GetNumSubsongs());
+        songSheet->subsongs[0].durationCs = replay->GetDurationMs() / 10;
+        songSheet->metadata.Container() = commands;
+
+        // export mode: the player is rendering with a null output and we're driving it
+        auto sampleRate = replay->GetSampleRate();
+        auto player = Player::Create(MusicID(), songSheet, replay, stream, true);
+        if (player.IsInvalid())
+        {
+            stats.numFailures++;
+            Log::Error("Benchmark: can't play \"%s\"\n", path.c_str());
+            return;
+        }
+
+        auto maxSamples = uint64_t(m_durationInSeconds) * sampleRate;
+        bool isFirstBuffer = true;
+        while (player->m_songPos < maxSamples && player->m_songEnd == ~0ull)
+        {
+            player->Render(player->m_numSamples, 0);
+            if (isFirstBuffer)
+            {
+                stats.firstBufferTime += std::chrono::duration<double>(Clock::now() - renderTime).count();
+                isFirstBuffer = false;
+            }
+        }
+        stats.renderTime += std::chrono::duration<double>(Clock::now() - renderTime).count();
+        stats.numSamples += player->m_songPos;
+    }
+
+    void Benchmark::Report(const char* csvFilename) const
+    {
+        auto& replays = Core::GetReplays();
+
+        std::string report = "replay;files;failures;samples;samples/s;load (s);first buffer (s);render (s)\n";
+        printf("%-24s %6s %6s %14s %14s %10s %10s %10s\n", "Replay", "Files", "Fails", "Samples", "Samples/s", "Load", "1st Buf", "Render");
+        Stats total;
+        for (size_t i = 0; i < size_t(eReplay::Count); i++)
+        {
+            auto& stats = m_stats[i];
+            if (stats.numFiles == 0 && stats.numFailures == 0)
+                continue;
+            auto samplesPerSecond = stats.renderTime > 0.0 ? stats.numSamples / stats.renderTime : 0.0;
+            auto* name = i == 0 ? "Unknown" : replays.GetName(eReplay(i));
+            printf("%-24s %6u %6u %14llu %14.0f %10.3f %10.3f %10.3f\n", name, stats.numFiles, stats.numFailures, stats.numSamples, samplesPerSecond, stats.loadTime, stats.firstBufferTime, stats.renderTime);
+
+            char buf[256];
+            sprintf(buf, "%s;%u;%u;%llu;%.0f;%.6f;%.6f;%.6f\n", name, stats.numFiles, stats.numFailures, stats.numSamples, samplesPerSecond, stats.loadTime, stats.firstBufferTime, stats.renderTime);
+            report += buf;
+
+            total.numFiles += stats.numFiles;
+            total.numFailures += stats.numFailures;
+            total.numSamples += stats.numSamples;
+            total.loadTime += stats.loadTime;
+            total.firstBufferTime += stats.firstBufferTime;
+            total.renderTime += stats.renderTime;
+        }
+        auto samplesPerSecond = total.renderTime > 0.0 ? total.numSamples / total.renderTime : 0.0;
+        printf("%-24s %6u %6u %14llu %14.0f %10.3f %10.3f %10.3f\n", "Total", total.numFiles, total.numFailures, total.numSamples, samplesPerSecond, total.loadTime, total.firstBufferTime, total.renderTime);
+        printf("Wall time: %.3fs\n", m_wallTime);
+
+        if (csvFilename)
+        {
+            std::ofstream file(std::filesystem::path(reinterpret_cast<const char8_t*>(csvFilename)), std::ios::binary);
+            file << report;
+        }
+    }
+
+    // the scalar kernels are the conversions as they were before their vectorization
+    bool Benchmark::CompareKernels()
+    {
+        // same noise on each run, to keep the reports reproducible
+        Array<int16_t> input16(kKernelSamples * 2);
+        Array<float> inputFloat(kKernelSamples * 2);
+        uint32_t seed = 0x1234567;
+        for (uint32_t i = 0; i < kKernelSamples * 2; i++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            input16[i] = int16_t(seed >> 16);
+            inputFloat[i] = input16[i] / 32768.0f;
+        }
+        auto* stereo16 = input16.Items();
+        auto* left16 = input16.Items();
+        auto* right16 = input16.Items(kKernelSamples);
+        auto* stereoFloat = inputFloat.Items();
+        const float scale = 0.75f;
+        const uint32_t stereoSeparation = 60;
+        auto separate = [stereo = 0.5f - 0.5f * stereoSeparation / 100.0f](float l, float r)
+        {
+            return StereoSample{ l + (r - l) * stereo, r + (l - r) * stereo };
+        };
+
+#if !CORE_AUDIO_SSE2
+        printf("SSE2 is not available in this build, both sides are scalar\n");
+#endif
+        printf("%-24s %14s %14s %8s %10s\n", "Kernel", "Scalar (S/s)", "SIMD (S/s)", "Speedup", "Max error");
+        bool isValid = true;
+        isValid &= CompareKernel("int16 stereo", [&](StereoSample* output, Surround&)
+        {
+            for (uint32_t i = 0; i < kKernelSamples; i++)
+                output[i] = StereoSample{ stereo16[i * 2] / 32767.0f, stereo16[i * 2 + 1] / 32767.0f } * scale;
+        }, [&](StereoSample* output, Surround&)
+        {
+            output->Convert(stereo16, kKernelSamples, scale);
+        });
+        isValid &= CompareKernel("int16 planar", [&](StereoSample* output, Surround&)
+        {
+            for (uint32_t i = 0; i < kKernelSamples; i++)
+                output[i] = StereoSample{ left16[i] / 32767.0f, right16[i] / 32767.0f } * scale;
+        }, [&](StereoSample* output, Surround&)
+        {
+            output->Convert(left16, right16, kKernelSamples, scale);
+        });
+        isValid &= CompareKernel("int16 mono", [&](StereoSample* output, Surround&)
+        {
+            for (uint32_t i = 0; i < kKernelSamples; i++)
+                output[i].left = output[i].right = scale * left16[i] / 32767.0f;
+        }, [&](StereoSample* output, Surround&)
+        {
+            output->ConvertMono(left16, kKernelSamples, scale);
+        });
+        isValid &= CompareKernel("float mono", [&](StereoSample* output, Surround&)
+        {
+            for (uint32_t i = 0; i < kKernelSamples; i++)
+                output[i].left = output[i].right = scale * stereoFloat[i];
+        }, [&](StereoSample* output, Surround&)
+        {
+            output->ConvertMono(stereoFloat, kKernelSamples, scale);
+        });
+        isValid &= CompareKernel("int16 stereo surround", [&](StereoSample* output, Surround& surround)
+        {
+            auto ctx = surround.Begin();
+            for (uint32_t i = 0; i < kKernelSamples; i++)
+                output[i] = ctx(separate(scale * stereo16[i * 2] / 32767.0f, scale * stereo16[i * 2 + 1] / 32767.0f));
+            surround.End(ctx);
+        }, [&](StereoSample* output, Surround& surround)
+        {
+            output->Convert(surround, stereo16, kKernelSamples, stereoSeparation, scale);
+        });
+        isValid &= CompareKernel("int16 planar surround", [&](StereoSample* output, Surround& surround)
+        {
+            auto ctx = surround.Begin();
+            for (uint32_t i = 0; i < kKernelSamples; i++)
+                output[i] = ctx(separate(scale * left16[i] / 32767.0f, scale * right16[i] / 32767.0f));
+            surround.End(ctx);
+        }, [&](StereoSample* output, Surround& surround)
+        {
+            output->Convert(surround, left16, right16, kKernelSamples, stereoSeparation, scale);
+        });
+        isValid &= CompareKernel("float stereo surround", [&](StereoSample* output, Surround& surround)
+        {
+            auto ctx = surround.Begin();
+            for (uint32_t i = 0; i < kKernelSamples; i++)
+                output[i] = ctx(separate(scale * stereoFloat[i * 2], scale * stereoFloat[i * 2 + 1]));
+            surround.End(ctx);
+        }, [&](StereoSample* output, Surround& surround)
+        {
+            output->Convert(surround, stereoFloat, kKernelSamples, stereoSeparation, scale);
+        });
+        return isValid;
+    }
+
+    template <typename ScalarKernel, typename SimdKernel>
+    bool Benchmark::CompareKernel(const char* name, ScalarKernel&& scalarKernel, SimdKernel&& simdKernel)
+    {
+        using Clock = std::chrono::high_resolution_clock;
+
+        // each side has its own delay line, fed with the same samples
+        Array<StereoSample> scalarOutput(kKernelSamples);
+        Array<StereoSample> simdOutput(kKernelSamples);
+        Surround scalarSurround(44100);
+        Surround simdSurround(44100);
+        scalarSurround.Enable(true);
+        simdSurround.Enable(true);
+
+        // a few buffers, so the delay line wraps at different offsets
+        float maxError = 0.0f;
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            scalarKernel(scalarOutput.Items(), scalarSurround);
+            simdKernel(simdOutput.Items(), simdSurround);
+            for (uint32_t j = 0; j < kKernelSamples; j++)
+            {
+                maxError = Max(maxError, fabsf(scalarOutput[j].left - simdOutput[j].left));
+                maxError = Max(maxError, fabsf(scalarOutput[j].right - simdOutput[j].right));
+            }
+        }
+
+        auto startTime = Clock::now();
+        for (uint32_t i = 0; i < kKernelIterations; i++)
+            scalarKernel(scalarOutput.Items(), scalarSurround);
+        auto scalarTime = std::chrono::duration<double>(Clock::now() - startTime).count();
+        startTime = Clock::now();
+        for (uint32_t i = 0; i < kKernelIterations; i++)
+            simdKernel(simdOutput.Items(), simdSurround);
+        auto simdTime = std::chrono::duration<double>(Clock::now() - startTime).count();
+
+        auto numSamples = double(kKernelSamples) * kKernelIterations;
+        auto isValid = maxError <= kKernelTolerance;
+        printf("%-24s %14.0f %14.0f %7.2fx %10.2e%s\n", name, numSamples / scalarTime, numSamples / simdTime, scalarTime / simdTime, maxError, isValid ? "" : " FAILED");
+        if (!isValid)
+            Log::Error("Benchmark: kernel \"%s\" is off by %g\n", name, maxError);
+        return isValid;
+    }
+}
+// namespace rePlayer
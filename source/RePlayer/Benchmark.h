@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Containers/Array.h>
+#include <Replays/ReplayTypes.h>
+
+#include <string>
+
+namespace rePlayer
+{
+    using namespace core;
+
+    // Headless batch renderer: load each file with the replays and render it through the Player (same path as Export)
+    // --kernels times the sample conversions against their scalar versions (and checks they give the same output)
+    // command line: rePlayer.exe --benchmark [--kernels] [--seconds N] [--csv report.csv] <file|directory|@list.txt>...
+    class Benchmark
+    {
+    public:
+        static bool IsRequested(int32_t argc, const wchar_t* const* argv);
+        static int32_t Run(int32_t argc, const wchar_t* const* argv);
+
+    private:
+        struct Stats
+        {
+            uint32_t numFiles = 0;
+            uint32_t numFailures = 0;
+            uint64_t numSamples = 0;
+            double loadTime = 0.0;
+            double firstBufferTime = 0.0;
+            double renderTime = 0.0;
+        };
+
+    private:
+        Benchmark(uint32_t durationInSeconds);
+
+        void Enqueue(const std::string& path);
+        void Update();
+        void Report(const char* csvFilename) const;
+
+        void Render(const std::string& path);
+
+        static bool CompareKernels();
+        template <typename ScalarKernel, typename SimdKernel>
+        static bool CompareKernel(const char* name, ScalarKernel&& scalarKernel, SimdKernel&& simdKernel);
+
+    private:
+        Array<std::string> m_files;
+        Stats m_stats[size_t(eReplay::Count)];
+        double m_wallTime = 0.0;
+        uint32_t m_durationInSeconds;
+
+        static constexpr uint32_t kKernelSamples = 4096;
+        static constexpr uint32_t kKernelIterations = 4096;
+        static constexpr float kKernelTolerance = 1.0e-5f;
+    };
+}
+// namespace rePlayer
@@ -4,6 +4,7 @@
 
 // rePlayer
 #include <Database/Database.h>
+#include <IO/CurlMulti.h>
 #include <Playlist/Playlist.h>
 
 #include "Core.h"
@@ -27,14 +28,24 @@ namespace rePlayer
         ms_instance->m_playlist->Discard(musicId);
     }
 
-    void Core::AddJob(const std::function<void()>& callback)
+    void Core::AddJob(thread::Task&& task, thread::JobCounter* counter)
     {
-        ms_instance->m_workers->AddJob(callback);
+        ms_instance->m_workers->AddJob(std::move(task), counter);
     }
 
-    void Core::FromJob(const std::function<void()>& callback)
+    void Core::FromJob(thread::Task&& task)
     {
-        ms_instance->m_workers->FromJob(callback);
+        ms_instance->m_workers->FromJob(std::move(task));
+    }
+
+    void Core::WaitJobs(thread::JobCounter& counter)
+    {
+        ms_instance->m_workers->Wait(counter);
+    }
+
+    uint32_t Core::NumWorkers()
+    {
+        return ms_instance->m_workers->NumThreads();
     }
 
     template <typename ItemID>
@@ -55,6 +66,24 @@ namespace rePlayer
     template void Core::OnNewProxy(SongID id);
     template void Core::OnNewProxy(ArtistID id);
 
+    template <typename ItemType>
+    void Core::OnEdit(const ItemType* item)
+    {
+        // the item doesn't know its database, but only its owner holds this very item at its id
+        auto id = item->GetId();
+        for (auto* db : ms_instance->m_db)
+        {
+            if (db->IsValid(id) && (*db)[id] == item)
+            {
+                db->Touch(id);
+                break;
+            }
+        }
+    }
+
+    template void Core::OnEdit(const Song* item);
+    template void Core::OnEdit(const Artist* item);
+
     template <typename ItemType>
     void Core::Stack<ItemType>::Reconcile()
     {
@@ -139,7 +168,7 @@ namespace rePlayer
 
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, Buffer::Writer);
         curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
-        if (curl_easy_perform(curl) != CURLE_OK)
+        if (GetCurl().Perform(curl) != CURLE_OK)
             Log::Error("%s: can't download \"%s\", curl error \"%s\"\n", logId, url, errorBuffer);
         curl_easy_cleanup(curl);
 
@@ -2,11 +2,13 @@
 
 #include <Database/Types/MusicID.h>
 #include <RePlayer/RePlayer.h>
+#include <Thread/Task.h>
 
 #include <functional>
 
 namespace core::thread
 {
+    class JobCounter;
     class Workers;
 }
 // namespace core::thread
@@ -16,6 +18,7 @@ namespace rePlayer
     using namespace core;
 
     class About;
+    class CurlMulti;
     class Database;
     class Deck;
     class Library;
@@ -43,8 +46,13 @@ namespace rePlayer
         static bool IsLocked();
 
         // job
-        static void AddJob(const std::function<void()>& callback);
-        static void FromJob(const std::function<void()>& callback);
+        static void AddJob(thread::Task&& task, thread::JobCounter* counter = nullptr);
+        static void FromJob(thread::Task&& task);
+        static void WaitJobs(thread::JobCounter& counter);
+        static uint32_t NumWorkers();
+
+        // network, all the transfers share the same connections
+        static CurlMulti& GetCurl();
 
         // Jukebox
         static About& GetAbout();
@@ -61,6 +69,8 @@ namespace rePlayer
         // Proxy only
         template <typename ItemID>
         static void OnNewProxy(ItemID id);
+        template <typename ItemType>
+        static void OnEdit(const ItemType* item);
 
         // Misc
         static uint32_t GetVersion();
@@ -120,6 +130,7 @@ namespace rePlayer
 
     private:
         About* m_about = nullptr;
+        CurlMulti* m_curl = nullptr;
         Deck* m_deck = nullptr;
         Library* m_library = nullptr;
         Playlist* m_playlist = nullptr;
@@ -9,6 +9,11 @@ namespace rePlayer
         return *ms_instance->m_about;
     }
 
+    inline CurlMulti& Core::GetCurl()
+    {
+        return *ms_instance->m_curl;
+    }
+
     inline Database& Core::GetDatabase(DatabaseID databaseId)
     {
         return *ms_instance->m_db[int32_t(databaseId)];
@@ -5,6 +5,7 @@
 // rePlayer
 #include <Database/SongEditor.h>
 #include <Deck/Deck.h>
+#include <IO/CurlMulti.h>
 #include <Library/Library.h>
 #include <Library/LibraryDatabase.h>
 #include <Playlist/Playlist.h>
@@ -22,6 +23,7 @@
 // stl
 #include <atomic>
 #include <csignal>
+#include <thread>
 
 #include "Core.h"
 
@@ -80,6 +82,8 @@ namespace rePlayer
 
     Core::~Core()
     {
+        // the library jobs run through the replays and the sources, they are done before anything goes away
+        m_library->CancelJobs();
         m_playlist->Flush();
         m_workers->Flush();
         m_library->Validate();
@@ -96,6 +100,7 @@ namespace rePlayer
         for (auto* db : m_db)
             delete db;
 
+        delete m_curl;
         delete m_workers;
 
         while (m_songsStack.items)
@@ -128,7 +133,9 @@ namespace rePlayer
     {
         if (m_deck == nullptr)
         {
-            m_workers = new thread::Workers(8, 16, L"rePlayer");
+            // at least 8 workers as some jobs are long running (downloads, sources...), more when there are enough cores to export in parallel
+            m_workers = new thread::Workers(Max(8u, std::thread::hardware_concurrency()), 1024, L"rePlayer");
+            m_curl = new CurlMulti();
 
             m_libraryDatabase = new LibraryDatabase();
             m_playlistDatabase = new PlaylistDatabase();
@@ -1,7 +1,6 @@
 // core
 #include <Core/String.h>
 #include <IO/File.h>
-#include <Thread/Thread.h>
 
 // rePlayer
 #include <Deck/Player.h>
@@ -21,6 +20,7 @@
 
 // stl
 #include <atomic>
+#include <thread>
 
 namespace rePlayer
 {
@@ -29,8 +29,7 @@ namespace rePlayer
 
     Export::~Export()
     {
-        while (!std::atomic_ref(m_isJobDone).load())
-            thread::Sleep(0);
+        Core::WaitJobs(m_jobCounter);
     }
 
     void Export::Enqueue(MusicID musicId)
@@ -44,11 +43,28 @@ namespace rePlayer
         if (m_songs.IsEmpty())
             return false;
 
-        Core::AddJob([this]()
+        auto& replays = Core::GetReplays();
+        for (uint32_t i = 0; i < m_songs.NumItems(); i++)
         {
-            Update();
-            std::atomic_ref(m_isJobDone).store(true);
-        });
+            if (replays.IsThreadSafe(m_songs[i].songSheet->type.replay))
+                m_parallelEntries.Add(i);
+            else
+                m_serialEntries.Add(i);
+        }
+
+        // keep a core for the ui, and two workers: one is held by the player update, the other one runs the other jobs
+        auto numCores = Max(std::thread::hardware_concurrency(), 2u) - 1;
+        auto numWorkers = Max(Core::NumWorkers(), 3u) - 2;
+        auto numJobs = Min(numCores, numWorkers, m_parallelEntries.NumItems() + (m_serialEntries.IsEmpty() ? 0 : 1));
+        m_jobs.Resize(Max(numJobs, 1u));
+
+        for (uint32_t i = 0; i < m_jobs.NumItems(); i++)
+        {
+            Core::AddJob([this, i]()
+            {
+                Update(i);
+            }, &m_jobCounter);
+        }
         return true;
     }
 
@@ -57,94 +73,123 @@ namespace rePlayer
         std::atomic_ref(m_isCancelled).store(true);
     }
 
-    uint32_t Export::GetStatus(float& progress, uint32_t& duration) const
+    uint32_t Export::GetStatus(uint32_t jobIndex, float& progress, uint32_t& duration) const
     {
-        auto currentEntry = std::atomic_ref(m_currentEntry).load();
-        progress = std::atomic_ref(m_progress).load();
-        duration = std::atomic_ref(m_duration).load();
-        return currentEntry;
+        auto& job = m_jobs[jobIndex];
+        auto entry = std::atomic_ref(job.entry).load();
+        progress = std::atomic_ref(job.progress).load();
+        duration = std::atomic_ref(job.duration).load();
+        return entry;
+    }
+
+    uint32_t Export::NumDoneSongs() const
+    {
+        return std::atomic_ref(m_numDoneSongs).load();
     }
 
     bool Export::IsDone()
     {
-        return std::atomic_ref(m_isJobDone).load();
+        return m_jobCounter.IsDone();
     }
 
-    void Export::Update()
+    void Export::Update(uint32_t jobIndex)
     {
-        for (uint32_t i = 0, e = m_songs.NumItems(); i < e && !IsCancelled(); i++)
+        auto& job = m_jobs[jobIndex];
+
+        // the first job is the only one exporting the songs of the non thread safe replays, then it helps the others
+        if (jobIndex == 0)
         {
-            std::atomic_ref(m_progress).store(0.0f);
-            std::atomic_ref(m_duration).store(0);
-            std::atomic_ref(m_currentEntry).store(i);
+            for (uint32_t i = 0; i < m_serialEntries.NumItems() && !IsCancelled(); i++)
+            {
+                Update(job, m_serialEntries[i]);
+                std::atomic_ref(m_numDoneSongs).fetch_add(1);
+            }
+        }
+        for (uint32_t i = std::atomic_ref(m_nextParallelEntry).fetch_add(1); i < m_parallelEntries.NumItems() && !IsCancelled(); i = std::atomic_ref(m_nextParallelEntry).fetch_add(1))
+        {
+            Update(job, m_parallelEntries[i]);
+            std::atomic_ref(m_numDoneSongs).fetch_add(1);
+        }
 
-            auto& entry = m_songs[i];
+        std::atomic_ref(job.entry).store(kNoEntry);
+    }
 
-            SmartPtr<core::io::Stream> stream;
+    void Export::Update(Job& job, uint32_t entryIndex)
+    {
+        std::atomic_ref(job.progress).store(0.0f);
+        std::atomic_ref(job.duration).store(0);
+        std::atomic_ref(job.entry).store(entryIndex);
+
+        auto& entry = m_songs[entryIndex];
+
+        SmartPtr<core::io::Stream> stream;
+        {
+            // getting the stream may download the song and edit the database (a sleeping lock, the download can be long)
+            std::scoped_lock lock(m_streamMutex);
             if (entry.id.databaseId == DatabaseID::kPlaylist)
                 stream = Core::GetPlaylist().GetStream(entry.song);
             else
                 stream = Core::GetLibrary().GetStream(entry.song);
-            if (auto replay = Core::GetReplays().Load(stream, entry.songSheet->metadata.Container(), entry.songSheet->type))
+        }
+        auto* replay = Core::GetReplays().Load(stream, entry.songSheet->metadata.Container(), entry.songSheet->type, entry.songSheet->fileSize, entry.songSheet->fileCrc);
+        if (replay == nullptr)
+            return;
+        if (replay->IsStreaming())
+        {
+            // we won't export stream as it never ends and works only realtime
+            delete replay;
+            return;
+        }
+        auto player = Player::Create(entry.id, entry.songSheet, replay, stream, true);
+
+        auto maxFrames = (uint64_t(entry.songSheet->subsongs[entry.id.subsongId.index].durationCs) * replay->GetSampleRate()) / 100ull;
+
+        auto filename = entry.id.GetArtists();
+        if (filename.empty())
+            filename = "!Unknown! - ";
+        else
+            filename += " - ";
+        filename += entry.songSheet->name.Items();
+        filename += " [";
+        if (*entry.songSheet->subsongs[entry.id.subsongId.index].name.Items())
+        {
+            filename += entry.songSheet->name.Items();
+            filename += "][";
+        }
+        char buf[32];
+        sprintf(buf, "%016llX%c].wav", entry.id.subsongId.Value(), entry.id.databaseId == DatabaseID::kPlaylist ? 'p' : 'l');
+        filename += buf;
+        io::File::CleanFilename(filename.data());
+
+        drwav wav;
+        drwav_data_format format;
+        format.container = drwav_container_riff;
+        format.format = DR_WAVE_FORMAT_IEEE_FLOAT;
+        format.channels = 2;
+        format.sampleRate = replay->GetSampleRate();
+        format.bitsPerSample = 32;
+        if (!drwav_init_file_write(&wav, filename.c_str(), &format, nullptr))
+            return;
+
+        for(; !IsCancelled();)
+        {
+            auto currentPos = player->m_songPos;
+            player->Render(player->m_numSamples, 0);
+            if (player->m_songEnd != ~0ull)
             {
-                if (replay->IsStreaming())
-                {
-                    // we won't export stream as it never ends and works only realtime
-                    delete replay;
-                    continue;
-                }
-                auto player = Player::Create(entry.id, entry.songSheet, replay, stream, true);
-
-                auto maxFrames = (uint64_t(entry.songSheet->subsongs[entry.id.subsongId.index].durationCs) * replay->GetSampleRate()) / 100ull;
-
-                auto filename = entry.id.GetArtists();
-                if (filename.empty())
-                    filename = "!Unknown! - ";
-                else
-                    filename += " - ";
-                filename += entry.songSheet->name.Items();
-                filename += " [";
-                if (*entry.songSheet->subsongs[entry.id.subsongId.index].name.Items())
-                {
-                    filename += entry.songSheet->name.Items();
-                    filename += "][";
-                }
-                char buf[32];
-                sprintf(buf, "%016llX%c].wav", entry.id.subsongId.Value(), entry.id.databaseId == DatabaseID::kPlaylist ? 'p' : 'l');
-                filename += buf;
-                io::File::CleanFilename(filename.data());
-
-                drwav wav;
-                drwav_data_format format;
-                format.container = drwav_container_riff;
-                format.format = DR_WAVE_FORMAT_IEEE_FLOAT;
-                format.channels = 2;
-                format.sampleRate = replay->GetSampleRate();
-                format.bitsPerSample = 32;
-                if (!drwav_init_file_write(&wav, filename.c_str(), &format, nullptr))
-                    continue;
-
-                for(; !IsCancelled();)
-                {
-                    auto currentPos = player->m_songPos;
-                    player->Render(player->m_numSamples, 0);
-                    if (player->m_songEnd != ~0ull)
-                    {
-                        drwav_write_pcm_frames(&wav, currentPos - player->m_songEnd, player->m_waveData);
-                        std::atomic_ref(m_progress).store(1.0f);
-                        break;
-                    }
-                    auto framesWritten = drwav_write_pcm_frames(&wav, player->m_numSamples, player->m_waveData);
-                    if (maxFrames != 0)
-                        std::atomic_ref(m_progress).store(float((double((player->m_songPos << 32) / maxFrames) / 65536.0) / 65536.0));
-                    if (framesWritten != player->m_numSamples)
-                        break;
-                    std::atomic_ref(m_duration).store(uint32_t(player->m_songPos / format.sampleRate));
-                }
-                std::atomic_ref(m_duration).store(0xffFFffFF);
-                drwav_uninit(&wav);
+                drwav_write_pcm_frames(&wav, currentPos - player->m_songEnd, player->m_waveData);
+                std::atomic_ref(job.progress).store(1.0f);
+                break;
             }
+            auto framesWritten = drwav_write_pcm_frames(&wav, player->m_numSamples, player->m_waveData);
+            if (maxFrames != 0)
+                std::atomic_ref(job.progress).store(float((double((player->m_songPos << 32) / maxFrames) / 65536.0) / 65536.0));
+            if (framesWritten != player->m_numSamples)
+                break;
+            std::atomic_ref(job.duration).store(uint32_t(player->m_songPos / format.sampleRate));
         }
+        std::atomic_ref(job.duration).store(0xffFFffFF);
+        drwav_uninit(&wav);
     }
 
     bool Export::IsCancelled() const
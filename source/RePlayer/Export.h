@@ -3,6 +3,9 @@
 #include <Containers/Array.h>
 #include <Containers/SmartPtr.h>
 #include <Database/Types/MusicID.h>
+#include <Thread/Workers.h>
+
+#include <mutex>
 
 namespace rePlayer
 {
@@ -13,6 +16,9 @@ namespace rePlayer
 
     class Export
     {
+    public:
+        static constexpr uint32_t kNoEntry = 0xffFFffFF;
+
     public:
         Export();
         ~Export();
@@ -21,11 +27,14 @@ namespace rePlayer
         bool Start();
         void Cancel();
 
-        uint32_t GetStatus(float& progress, uint32_t& duration) const;
+        // status of a running job: song index (kNoEntry when idle), progress and duration (0xffFFffFF when writing)
+        uint32_t GetStatus(uint32_t jobIndex, float& progress, uint32_t& duration) const;
         bool IsDone();
 
+        uint32_t NumJobs() const;
         uint32_t NumSongs() const;
-        MusicID GetMusicId(uint32_t& index) const;
+        uint32_t NumDoneSongs() const;
+        MusicID GetMusicId(uint32_t index) const;
 
     private:
         struct Entry
@@ -35,26 +44,43 @@ namespace rePlayer
             MusicID id;
         };
 
+        struct Job
+        {
+            uint32_t entry = kNoEntry;
+            float progress = 0.0f;
+            uint32_t duration = 0;
+        };
+
     private:
-        void Update();
+        void Update(uint32_t jobIndex);
+        void Update(Job& job, uint32_t entryIndex);
         bool IsCancelled() const;
 
     private:
         Array<Entry> m_songs;
+        Array<uint32_t> m_serialEntries; // songs played by a non thread safe replay are exported one at a time
+        Array<uint32_t> m_parallelEntries;
+        uint32_t m_nextParallelEntry = 0;
+
+        Array<Job> m_jobs;
+        thread::JobCounter m_jobCounter;
+        uint32_t m_numDoneSongs = 0;
+        std::mutex m_streamMutex;
 
-        uint32_t m_currentEntry = 0;
-        float m_progress = 0.0f;
-        uint32_t m_duration = 0;
         bool m_isCancelled = false;
-        bool m_isJobDone = false;
     };
 
+    inline uint32_t Export::NumJobs() const
+    {
+        return m_jobs.NumItems();
+    }
+
     inline uint32_t Export::NumSongs() const
     {
         return m_songs.NumItems();
     }
 
-    inline MusicID Export::GetMusicId(uint32_t& index) const
+    inline MusicID Export::GetMusicId(uint32_t index) const
     {
         return m_songs[index].id;
     }
@@ -3,16 +3,19 @@
 
 #include <Core/Log.h>
 #include <Core/String.h>
-#include <Helpers/CommandBuffer.h>
+#include <Helpers/CommandBuffer.inl.h>
 #include <ImGui.h>
+#include <IO/File.h>
 #include <IO/Stream.h>
 #include <IO/StreamFile.h>
 #include <RePlayer/Core.h>
+#include <RePlayer/CoreHeader.h>
 #include <Replayer/Version.h>
 #include <Replays/Replay.h>
 #include <Replays/ReplayPlugin.h>
 
 #include <dllloader.h>
+#include <zlib.h>
 
 #include <filesystem>
 
@@ -29,6 +32,8 @@ namespace rePlayer
         #undef REPLAY
     };
 
+    const char* const Replays::ms_probesFilename = MusicPath "probes" MusicExt;
+
     typedef ReplayPlugin* (*GetReplayPlugin)();
 
     Replays::Replays()
@@ -36,9 +41,28 @@ namespace rePlayer
         , m_dllManager(new DllManager())
     {
         LoadPlugins();
+        LoadProbes();
 
         m_dllManager->EnableDllRedirection();
 
+        // tokenize the plugins extensions once, Find is called for each file added
+        for (auto* plugin : m_sortedPlugins)
+        {
+            if (plugin == nullptr)
+                continue;
+            for (auto exts = plugin->extensions; *exts; exts++)
+            {
+                auto ext = exts;
+                while (*exts && *exts != ';')
+                    ++exts;
+                auto extIndex = int32_t(MediaType::FindExtension(ext, exts - ext));
+                if (extIndex != 0 && m_extensionToDefaultReplay[extIndex] == eReplay::Unknown)
+                    m_extensionToDefaultReplay[extIndex] = plugin->replayId;
+                if (*exts == 0)
+                    break;
+            }
+        }
+
         // build the list of sorted extension and mapping tables
         for (int32_t i = 0; i < int32_t(eExtension::Count); i++)
             MediaType::sortedExtensions[i] = eExtension(i);
@@ -56,6 +80,7 @@ namespace rePlayer
 
     Replays::~Replays()
     {
+        SaveProbes();
         FlushDlls();
         assert(m_dlls.IsEmpty());
 
@@ -75,21 +100,44 @@ namespace rePlayer
         //we should free all the plugin libraries here, but it's crashing after (in the ucrt trying to call an unloaded function)
     }
 
-    Replay* Replays::Load(io::Stream* stream, CommandBuffer metadata, MediaType type)
+    Replay* Replays::Load(io::Stream* stream, CommandBuffer metadata, MediaType type, uint32_t fileSize, uint32_t fileCrc)
     {
         // try the remap
         if (type.replay == eReplay::Unknown)
             type.replay = m_extensionToReplay[int(type.ext)];
 
         // default load
+        bool isRejected = false;
         if (auto plugin = m_plugins[int32_t(type.replay)])
         {
             stream->Rewind();
-            if (auto replay = Load(plugin, stream, metadata))
+            if (auto replay = Load(plugin, stream, metadata, &isRejected))
                 return replay;
         }
 
-        // failed the default loader, then try to load using extension first
+        // failed the default loader, skip the replays which have already rejected this file
+        auto probeKey = GetProbeKey(stream, metadata, fileSize, fileCrc);
+        auto probe = FindProbe(probeKey);
+        if (isRejected)
+            probe.rejected |= 1ull << int32_t(type.replay);
+        auto replay = Load(stream, metadata, type, probe);
+        UpdateProbe(probeKey, probe);
+        return replay;
+    }
+
+    Replay* Replays::Load(io::Stream* stream, CommandBuffer metadata, MediaType type, Probe& probe)
+    {
+        // the replay which has already accepted this file
+        if (probe.accepted != eReplay::Unknown && probe.accepted != type.replay)
+        {
+            if (auto plugin = m_plugins[int32_t(probe.accepted)])
+            {
+                if (auto replay = Load(plugin, stream, metadata, probe))
+                    return replay;
+            }
+        }
+
+        // then try to load using extension first
         ReplayPlugin* plugins[uint16_t(eReplay::Count)];
         memcpy(plugins, m_sortedPlugins, sizeof(m_sortedPlugins));
         auto baseReplayIndex = m_replayToIndex[int32_t(type.replay)];
@@ -110,8 +158,7 @@ namespace rePlayer
                             ++nextExt;
                         if (_strnicmp(extensions, currentExt, nextExt - extensions) == 0)
                         {
-                            stream->Rewind();
-                            if (auto replay = Load(plugin, stream, metadata))
+                            if (auto replay = Load(plugin, stream, metadata, probe))
                                 return replay;
                             plugins[replayIndex] = nullptr;
                             break;
@@ -131,25 +178,26 @@ namespace rePlayer
             auto replayIndex = (i + baseReplayIndex) % uint16_t(eReplay::Count);
             if (auto plugin = plugins[replayIndex])
             {
-                stream->Rewind();
-                if (auto replay = Load(plugin, stream, metadata))
+                if (auto replay = Load(plugin, stream, metadata, probe))
                     return replay;
             }
         }
         return nullptr;
     }
 
-    Replayables Replays::Enumerate(io::Stream* stream)
+    Replayables Replays::Enumerate(io::Stream* stream, uint32_t fileSize, uint32_t fileCrc)
     {
+        Array<CommandBuffer::Command> commands;
+        auto probeKey = GetProbeKey(stream, commands, fileSize, fileCrc);
+        auto probe = FindProbe(probeKey);
+
         Replayables replays;
         uint32_t numReplays = 0;
-        Array<CommandBuffer::Command> commands;
         for (int16_t i = 0; i < uint16_t(eReplay::Count); i++)
         {
             if (auto plugin = m_plugins[i])
             {
-                stream->Rewind();
-                if (auto replay = Load(plugin, stream, commands))
+                if (auto replay = Load(plugin, stream, commands, probe))
                 {
                     replays[numReplays++] = plugin->replayId;
                     delete replay;
@@ -157,13 +205,19 @@ namespace rePlayer
             }
         }
         replays[numReplays++] = eReplay::Unknown;
+
+        UpdateProbe(probeKey, probe);
         return replays;
     }
 
-    Replayables Replays::Enumerate(io::Stream* stream, MediaType type)
+    Replayables Replays::Enumerate(io::Stream* stream, MediaType type, uint32_t fileSize, uint32_t fileCrc)
     {
         if (type.ext == eExtension::Unknown)
-            return Enumerate(stream);
+            return Enumerate(stream, fileSize, fileCrc);
+
+        Array<CommandBuffer::Command> commands;
+        auto probeKey = GetProbeKey(stream, commands, fileSize, fileCrc);
+        auto probe = FindProbe(probeKey);
 
         ReplayPlugin* plugins[uint16_t(eReplay::Count)];
         memcpy(plugins, m_sortedPlugins, sizeof(m_sortedPlugins));
@@ -171,7 +225,6 @@ namespace rePlayer
 
         Replayables replays;
         uint32_t numReplays = 0;
-        Array<CommandBuffer::Command> commands;
 
         // load by extension
         auto currentExt = MediaType::extensionNames[int32_t(type.ext)];
@@ -187,8 +240,7 @@ namespace rePlayer
                         ++nextExt;
                     if (_strnicmp(extensions, currentExt, nextExt - extensions) == 0)
                     {
-                        stream->Rewind();
-                        if (auto replay = Load(plugin, stream, commands))
+                        if (auto replay = Load(plugin, stream, commands, probe))
                         {
                             replays[numReplays++] = plugin->replayId;
                             delete replay;
@@ -209,8 +261,7 @@ namespace rePlayer
         {
             if (auto plugin = plugins[i])
             {
-                stream->Rewind();
-                if (auto replay = Load(plugin, stream, commands))
+                if (auto replay = Load(plugin, stream, commands, probe))
                 {
                     replays[numReplays++] = plugin->replayId;
                     delete replay;
@@ -219,6 +270,8 @@ namespace rePlayer
         }
 
         replays[numReplays++] = eReplay::Unknown;
+
+        UpdateProbe(probeKey, probe);
         return replays;
     }
 
@@ -227,7 +280,10 @@ namespace rePlayer
         MediaType type(extension, eReplay::Unknown);
         // force the replay?
         type.replay = m_extensionToReplay[int32_t(type.ext)];
-        if (extension != nullptr && type.replay == eReplay::Unknown)
+        if (type.replay == eReplay::Unknown)
+            type.replay = m_extensionToDefaultReplay[int32_t(type.ext)];
+        // an extension not in our list but still listed by a plugin
+        if (extension != nullptr && type.ext == eExtension::Unknown && type.replay == eReplay::Unknown)
         {
             // look for the first plugin allowing this extension
             auto length = strlen(extension);
@@ -328,6 +384,13 @@ namespace rePlayer
         return "!!! Missing Plugin !!!";
     }
 
+    bool Replays::IsThreadSafe(eReplay replay) const
+    {
+        if (auto plugin = m_plugins[int(replay)])
+            return plugin->isThreadSafe;
+        return false;
+    }
+
     void Replays::SetSelectedSettings(MediaType type)
     {
         if (type.replay != eReplay::Unknown)
@@ -381,6 +444,7 @@ namespace rePlayer
                     {
                         replayPlugin->init(SharedContexts::ms_instance, Core::GetSettings());
                         m_plugins[int32_t(replayPlugin->replayId)] = replayPlugin;
+                        m_replayVersions[int32_t(replayPlugin->replayId)] = GetReplayVersion(dirEntry, replayPlugin);
                     }
                     else
                     {
@@ -563,12 +627,28 @@ namespace rePlayer
         m_fileFilters = fileFilters;
     }
 
-    Replay* Replays::Load(ReplayPlugin* plugin, io::Stream* stream, CommandBuffer metadata)
+    Replay* Replays::Load(ReplayPlugin* plugin, io::Stream* stream, CommandBuffer metadata, bool* isRejected)
     {
-        if (plugin->isThreadSafe)
-            return plugin->load(stream, metadata);
+        // only a plugin looking at the file and saying no is a rejection (the dll may fail to load for other reasons)
+        if (plugin->sniff)
+        {
+            auto isAccepted = plugin->sniff(stream);
+            stream->Rewind();
+            if (!isAccepted)
+            {
+                if (isRejected)
+                    *isRejected = true;
+                return nullptr;
+            }
+        }
 
-        FlushDlls();
+        if (plugin->isThreadSafe)
+        {
+            auto replay = plugin->load(stream, metadata);
+            if (isRejected)
+                *isRejected = replay == nullptr;
+            return replay;
+        }
 
         char* pgrPath;
         _get_pgmptr(&pgrPath);
@@ -579,6 +659,12 @@ namespace rePlayer
         auto dllStream = io::StreamFile::Create(mainPath);
         auto dllData = dllStream->Read();
 
+        // the dll manager and the dll list are shared by all the threads loading through a non thread safe plugin
+        // each load gets its own copy of the dll, so the plugin itself runs outside of the lock
+        std::unique_lock lock(m_dllsMutex);
+
+        FlushDlls();
+
         char dllName[32];
         sprintf(dllName, "%s%04X.dll", plugin->dllName, m_dllIdGenerator++);
 
@@ -586,6 +672,7 @@ namespace rePlayer
         m_dllManager->SetDllFile(mainPath.c_str(), dllData.Items(), dllData.Size());
 
         auto dllHandle = m_dllManager->LoadLibrary(mainPath.c_str());
+        lock.unlock();
         if (dllHandle)
         {
             // load the song though the new module
@@ -593,6 +680,7 @@ namespace rePlayer
 
             replayPlugin->onDelete = [](Replay* replay)
             {
+                std::scoped_lock lock(Core::GetReplays().m_dllsMutex);
                 for (auto& dllEntry : Core::GetReplays().m_dlls)
                 {
                     if (dllEntry.replay == replay)
@@ -607,6 +695,10 @@ namespace rePlayer
             Window* w = nullptr;
             replayPlugin->init(SharedContexts::ms_instance, reinterpret_cast<Window&>(*w));
             auto replay = replayPlugin->load(stream, metadata);
+            if (isRejected)
+                *isRejected = replay == nullptr;
+
+            lock.lock();
             if (replay)
             {
                 m_dlls.Add({ mainPath, dllHandle, replay });
@@ -620,12 +712,147 @@ namespace rePlayer
         }
         else
         {
+            lock.lock();
             auto s = m_dllManager->GetLastError();
             s.clear();
         }
         return nullptr;
     }
 
+    Replay* Replays::Load(ReplayPlugin* plugin, io::Stream* stream, CommandBuffer metadata, Probe& probe)
+    {
+        auto replayMask = 1ull << int32_t(plugin->replayId);
+        if (probe.rejected & replayMask)
+            return nullptr;
+        stream->Rewind();
+        bool isRejected = false;
+        auto replay = Load(plugin, stream, metadata, &isRejected);
+        if (replay)
+            probe.accepted = plugin->replayId;
+        else if (isRejected)
+            probe.rejected |= replayMask;
+        return replay;
+    }
+
+    uint64_t Replays::GetProbeKey(io::Stream* stream, CommandBuffer metadata, uint32_t fileSize, uint32_t fileCrc)
+    {
+        // without the database crc, only for the streams we can read in one go (no http streaming)
+        if (fileSize == 0)
+        {
+            auto size = stream->GetSize();
+            if (size == 0 || size > 0xffFFffFF || stream->GetAvailableSize() != int64_t(size))
+                return 0;
+            stream->Rewind();
+            auto data = stream->Read();
+            stream->Rewind();
+            if (data.Size() != size)
+                return 0;
+            fileSize = uint32_t(size);
+            fileCrc = crc32_z(0L, data.Items(), data.Size());
+        }
+
+        // the same data may load or not depending on its companion files (looked up from its name) and its metadata
+        auto& name = stream->GetName();
+        auto& commands = metadata.Commands();
+        auto contextCrc = crc32_z(0L, reinterpret_cast<const uint8_t*>(&fileSize), sizeof(fileSize));
+        contextCrc = crc32_z(contextCrc, reinterpret_cast<const uint8_t*>(name.c_str()), name.size());
+        contextCrc = crc32_z(contextCrc, reinterpret_cast<const uint8_t*>(commands.Items()), commands.Size<size_t>());
+        return (uint64_t(contextCrc) << 32) | fileCrc;
+    }
+
+    Replays::Probe Replays::FindProbe(uint64_t key)
+    {
+        if (key != 0)
+        {
+            thread::ScopedSpinLock lock(m_probesLock);
+            if (auto* probe = m_probes.FindItemByKey(key))
+                return *probe;
+        }
+        return {};
+    }
+
+    void Replays::UpdateProbe(uint64_t key, const Probe& probe)
+    {
+        if (key == 0 || (probe.rejected == 0 && probe.accepted == eReplay::Unknown))
+            return;
+        thread::ScopedSpinLock lock(m_probesLock);
+        auto& oldProbe = m_probes[key];
+        if (oldProbe.rejected != probe.rejected || oldProbe.accepted != probe.accepted)
+        {
+            oldProbe = probe;
+            m_areProbesDirty = true;
+        }
+    }
+
+    void Replays::LoadProbes()
+    {
+        auto file = io::File::OpenForRead(ms_probesFilename);
+        if (file.IsValid())
+        {
+            // plugins may have changed their minds since the last version
+            if (file.Read<uint32_t>() != kMusicFileStamp || file.Read<uint32_t>() != Core::GetVersion() || file.Read<uint32_t>() != kProbesVersion)
+                return;
+
+            // and each replay since its dll was saved with the probes
+            Array<uint32_t> replayVersions;
+            file.Read<uint32_t>(replayVersions);
+            uint64_t changedReplays = 0;
+            for (uint16_t i = 0; i < uint16_t(eReplay::Count); i++)
+            {
+                if (i >= replayVersions.NumItems() || replayVersions[i] != m_replayVersions[i])
+                    changedReplays |= 1ull << i;
+            }
+
+            for (auto numProbes = file.Read<uint32_t>(); numProbes > 0; numProbes--)
+            {
+                auto key = file.Read<uint64_t>();
+                auto rejected = file.Read<uint64_t>() & ~changedReplays;
+                auto accepted = eReplay(file.Read<uint16_t>());
+                if (accepted >= eReplay::Count || (changedReplays & (1ull << uint16_t(accepted))))
+                    accepted = eReplay::Unknown;
+                if (rejected != 0 || accepted != eReplay::Unknown)
+                    m_probes[key] = { rejected, accepted };
+            }
+            m_areProbesDirty = changedReplays != 0;
+        }
+    }
+
+    void Replays::SaveProbes()
+    {
+        if (!m_areProbesDirty)
+            return;
+        auto file = io::File::OpenForWrite(ms_probesFilename);
+        if (file.IsValid())
+        {
+            file.Write(kMusicFileStamp);
+            file.Write(Core::GetVersion());
+            file.Write(kProbesVersion);
+            file.WriteAs<uint32_t>(uint16_t(eReplay::Count));
+            file.Write(m_replayVersions, sizeof(m_replayVersions));
+            file.Write(m_probes.NumItems());
+            for (auto it = m_probes.begin(), e = m_probes.end(); it != e; it++)
+            {
+                file.Write(it.Key());
+                file.Write(it->rejected);
+                file.WriteAs<uint16_t>(it->accepted);
+            }
+            m_areProbesDirty = false;
+        }
+    }
+
+    uint32_t Replays::GetReplayVersion(const std::filesystem::directory_entry& dllEntry, const ReplayPlugin* plugin)
+    {
+        // no version in the plugins: their dll (size and date) and what they say about themselves
+        std::error_code ec;
+        auto dllSize = uint64_t(dllEntry.file_size(ec));
+        auto dllTime = int64_t(dllEntry.last_write_time(ec).time_since_epoch().count());
+        auto version = crc32_z(0L, reinterpret_cast<const uint8_t*>(&dllSize), sizeof(dllSize));
+        version = crc32_z(version, reinterpret_cast<const uint8_t*>(&dllTime), sizeof(dllTime));
+        if (plugin->about)
+            version = crc32_z(version, reinterpret_cast<const uint8_t*>(plugin->about), strlen(plugin->about));
+        return uint32_t(version) | 1; // never 0, like a replay without a dll
+    }
+
     void Replays::FlushDlls()
     {
         m_dlls.RemoveIf([this](auto& dllEntry)
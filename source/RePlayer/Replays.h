@@ -1,8 +1,12 @@
 #pragma once
 
+#include <Containers/HashMap.h>
 #include <Helpers/CommandBuffer.h>
 #include <Replays/ReplayTypes.h>
+#include <Thread/SpinLock.h>
 
+#include <filesystem>
+#include <mutex>
 #include <string>
 
 class DllManager;
@@ -59,9 +63,10 @@ namespace rePlayer
         Replays();
         ~Replays();
 
-        Replay* Load(io::Stream* stream, CommandBuffer metadata, MediaType type);
-        Replayables Enumerate(io::Stream* stream);
-        Replayables Enumerate(io::Stream* stream, MediaType type);
+        // fileSize and fileCrc are the ones from the database, when known (saves reading the whole stream again on a failed load)
+        Replay* Load(io::Stream* stream, CommandBuffer metadata, MediaType type, uint32_t fileSize = 0, uint32_t fileCrc = 0);
+        Replayables Enumerate(io::Stream* stream, uint32_t fileSize = 0, uint32_t fileCrc = 0);
+        Replayables Enumerate(io::Stream* stream, MediaType type, uint32_t fileSize = 0, uint32_t fileCrc = 0);
         MediaType Find(const char* extension) const;
 
         bool DisplaySettings() const;
@@ -75,6 +80,7 @@ namespace rePlayer
         void EditMetadata(eReplay replayId, ReplayMetadataContext& context) const;
 
         const char* GetName(eReplay replay) const;
+        bool IsThreadSafe(eReplay replay) const;
 
         void SetSelectedSettings(MediaType type);
 
@@ -86,18 +92,36 @@ namespace rePlayer
             Replay* replay = nullptr;
         };
 
+        // what we know about a file (by size, crc, name and metadata) which didn't load with its default replay
+        struct Probe
+        {
+            uint64_t rejected = 0; // one bit per replay
+            eReplay accepted = eReplay::Unknown;
+        };
+        static_assert(uint16_t(eReplay::Count) <= 64);
+
     private:
         void LoadPlugins();
         void BuildFileFilters();
-        Replay* Load(ReplayPlugin* plugin, io::Stream* stream, CommandBuffer metadata);
+        Replay* Load(ReplayPlugin* plugin, io::Stream* stream, CommandBuffer metadata, bool* isRejected = nullptr);
+        Replay* Load(ReplayPlugin* plugin, io::Stream* stream, CommandBuffer metadata, Probe& probe);
+        Replay* Load(io::Stream* stream, CommandBuffer metadata, MediaType type, Probe& probe);
         void FlushDlls();
 
+        static uint64_t GetProbeKey(io::Stream* stream, CommandBuffer metadata, uint32_t fileSize, uint32_t fileCrc);
+        Probe FindProbe(uint64_t key);
+        void UpdateProbe(uint64_t key, const Probe& probe);
+        void LoadProbes();
+        void SaveProbes();
+        static uint32_t GetReplayVersion(const std::filesystem::directory_entry& dllEntry, const ReplayPlugin* plugin);
+
     private:
         ReplayPlugin* m_plugins[uint16_t(eReplay::Count)];
         ReplayPlugin* m_sortedPlugins[uint16_t(eReplay::Count)];
         ReplayPlugin* m_settingsPlugins[uint16_t(eReplay::Count)];
         uint8_t m_replayToIndex[uint16_t(eReplay::Count)];
         mutable eReplay m_extensionToReplay[uint16_t(eExtension::Count)] = { eReplay::Unknown };
+        eReplay m_extensionToDefaultReplay[uint16_t(eExtension::Count)] = { eReplay::Unknown }; // first plugin (by priority) listing the extension
         uint16_t m_dllIdGenerator = 0;
         uint16_t m_numSettings = 0;
         mutable int32_t m_selectedSettings = 0;
@@ -111,8 +135,16 @@ namespace rePlayer
 
         DllManager* m_dllManager = nullptr;
         Array<DllEntry> m_dlls;
+        std::mutex m_dllsMutex; // loading a dll can take a while, the others sleep meanwhile
+
+        HashMap<uint64_t, Probe> m_probes;
+        uint32_t m_replayVersions[uint16_t(eReplay::Count)] = {}; // the probes of a replay are dropped when its dll changes
+        thread::SpinLock m_probesLock;
+        bool m_areProbesDirty = false;
 
         static int16_t ms_priorities[uint16_t(eReplay::Count)];
+        static const char* const ms_probesFilename;
+        static constexpr uint32_t kProbesVersion = 2; // bumped when the key or the file layout changes
     };
 }
 // namespace rePlayer
\ No newline at end of file
@@ -12,9 +12,19 @@ namespace rePlayer
         .name = "Free Lossless Audio Codec",
         .extensions = "flac",
         .about = "dr_flac " DRFLAC_VERSION_STRING "\nCopyright (c) 2020 David Reid",
-        .load = ReplayFLAC::Load
+        .load = ReplayFLAC::Load,
+        .sniff = ReplayFLAC::Sniff
     };
 
+    bool ReplayFLAC::Sniff(io::Stream* stream)
+    {
+        // native, native with an id3 tag or ogg
+        char id[4];
+        if (stream->Read(id, sizeof(id)) != sizeof(id))
+            return false;
+        return memcmp(id, "fLaC", 4) == 0 || memcmp(id, "ID3", 3) == 0 || memcmp(id, "OggS", 4) == 0;
+    }
+
     Replay* ReplayFLAC::Load(io::Stream* stream, CommandBuffer /*metadata*/)
     {
         auto replay = new ReplayFLAC(stream);
@@ -16,6 +16,7 @@ namespace rePlayer
     {
     public:
         static Replay* Load(io::Stream* stream, CommandBuffer metadata);
+        static bool Sniff(io::Stream* stream);
 
     public:
         ~ReplayFLAC() override;
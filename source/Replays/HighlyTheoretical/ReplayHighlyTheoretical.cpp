@@ -327,6 +327,24 @@ namespace rePlayer
         sega_upload_program(m_segaState, m_loaderState.data, (uint32_t)length);
     }
 
+    void ReplayHighlyTheoretical::SaveSnapshot(Array<uint8_t>& state) const
+    {
+        auto segaStateSize = uint32_t(sega_get_state_size(m_psfType - 0x10));
+        state.Resize(sizeof(m_currentPosition) + sizeof(m_currentDuration) + segaStateSize);
+        auto* data = state.Items();
+        memcpy(data, &m_currentPosition, sizeof(m_currentPosition));
+        memcpy(data + sizeof(m_currentPosition), &m_currentDuration, sizeof(m_currentDuration));
+        memcpy(data + sizeof(m_currentPosition) + sizeof(m_currentDuration), m_segaState, segaStateSize);
+    }
+
+    void ReplayHighlyTheoretical::RestoreSnapshot(const Array<uint8_t>& state)
+    {
+        auto* data = state.Items();
+        memcpy(&m_currentPosition, data, sizeof(m_currentPosition));
+        memcpy(&m_currentDuration, data + sizeof(m_currentPosition), sizeof(m_currentDuration));
+        memcpy(m_segaState, data + sizeof(m_currentPosition) + sizeof(m_currentDuration), state.NumItems() - sizeof(m_currentPosition) - sizeof(m_currentDuration));
+    }
+
     void ReplayHighlyTheoretical::ApplySettings(const CommandBuffer metadata)
     {
         auto settings = metadata.Find<Settings>();
@@ -59,6 +59,11 @@ namespace rePlayer
         std::string GetExtraInfo() const override;
         std::string GetInfo() const override;
 
+        // the sega state is a single block (its pointers are inside the block), restored at the same address
+        bool CanSnapshot() const override { return true; }
+        void SaveSnapshot(Array<uint8_t>& state) const override;
+        void RestoreSnapshot(const Array<uint8_t>& state) override;
+
     private:
         static constexpr uint32_t kSampleRate = 44100;
         static constexpr uint32_t kDefaultSongDuration = 180 * 1000; // in milliseconds
@@ -23,6 +23,7 @@ namespace rePlayer
         .settings = "HivelyTracker 1.9",
         .init = ReplayHively::Init,
         .load = ReplayHively::Load,
+        .sniff = ReplayHively::Sniff,
         .displaySettings = ReplayHively::DisplaySettings,
         .editMetadata = ReplayHively::Settings::Edit
     };
@@ -69,6 +70,16 @@ namespace rePlayer
         return new ReplayHively(module, hvl_ParseTune(data.Items(), static_cast<uint32_t>(data.Size()), kSampleRate, 2, [](size_t size) { auto* ptr = Alloc(size); memset(ptr, 0, size); return ptr; }, [](void* ptr) { Free(ptr); }), extension);
     }
 
+    bool ReplayHively::Sniff(io::Stream* stream)
+    {
+        // same header check as hvl_ParseTune
+        uint8_t header[4];
+        if (stream->GetSize() < 8 || stream->Read(header, sizeof(header)) != sizeof(header))
+            return false;
+        return (header[0] == 'T' && header[1] == 'H' && header[2] == 'X' && header[3] < 3)
+            || (header[0] == 'H' && header[1] == 'V' && header[2] == 'L' && header[3] < 2);
+    }
+
     bool ReplayHively::DisplaySettings()
     {
         bool changed = false;
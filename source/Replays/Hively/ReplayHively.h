@@ -14,6 +14,7 @@ namespace rePlayer
         static bool Init(SharedContexts* ctx, Window& window);
 
         static Replay* Load(io::Stream* stream, CommandBuffer metadata);
+        static bool Sniff(io::Stream* stream);
 
         static bool DisplaySettings();
 
@@ -201,7 +201,17 @@ namespace rePlayer
                 numSamples = uint32_t(currentDuration - currentPosition);
             }
         }
-        numSamples = uint32_t(openmpt_module_read_interleaved_float_stereo(m_modulePlayback, kSampleRate, numSamples, reinterpret_cast<float*>(output)));
+        // the patterns module is only a pattern data source: the rows come from the playback itself
+        uint32_t numRendered = 0;
+        while (numRendered < numSamples)
+        {
+            PushVisualEvent(numRendered, openmpt_module_get_current_order(m_modulePlayback), openmpt_module_get_current_pattern(m_modulePlayback), openmpt_module_get_current_row(m_modulePlayback));
+            auto count = uint32_t(openmpt_module_read_interleaved_float_stereo(m_modulePlayback, kSampleRate, Min(numSamples - numRendered, kVisualsChunkSize), reinterpret_cast<float*>(output + numRendered)));
+            if (count == 0)
+                break;
+            numRendered += count;
+        }
+        numSamples = numRendered;
         output->Convert(m_surround, numSamples);
         if (numSamples)
         {
@@ -225,48 +235,22 @@ namespace rePlayer
             m_currentPosition = currentDuration;
         m_isSilenceTriggered = false;
 
-        auto posInSec = openmpt_module_get_position_seconds(m_moduleVisuals) * 1000.0;
-        if (posInSec > timeInMs)
-        {
-            posInSec = 0.0;
-            m_visualsSamples = 0;
-            openmpt_module_set_position_seconds(m_moduleVisuals, 0.0);
-        }
-        if (auto numSamples = uint32_t((timeInMs - posInSec) * kSampleRate / 1000.0))
-        {
-            auto availableSamples = Min(numSamples, m_visualsSamples);
-            m_visualsSamples -= availableSamples;
-            numSamples -= availableSamples;
-            while (numSamples)
-            {
-                m_visualsSamples = uint32_t(openmpt_module_read_one_tick(m_moduleVisuals, kSampleRate));
-                availableSamples = Min(numSamples, m_visualsSamples);
-                m_visualsSamples -= availableSamples;
-                numSamples -= availableSamples;
-            }
-        }
-
         return uint32_t(newTime * 1000);
     }
 
     void ReplayOpenMPT::ResetPlayback()
     {
         auto numSubsongs = GetNumSubsongs();
-        auto setSubsong = [&](auto* module)
+        if (numSubsongs > 1)
         {
-            if (numSubsongs > 1)
-            {
-                auto subsongIndex = m_subsongIndex;
-                //libopenmpt bug: if the current subsong index > 0 and we restart it after a loop, then the first end song is not triggered
-                //so this hack seems to reset the proper internal states
-                openmpt_module_select_subsong(module, (subsongIndex + 1) % numSubsongs);
-                openmpt_module_select_subsong(module, subsongIndex);
-            }
-            else
-                openmpt_module_set_position_seconds(module, 0.0);
-        };
-        setSubsong(m_modulePlayback);
-        setSubsong(m_moduleVisuals);
+            auto subsongIndex = m_subsongIndex;
+            //libopenmpt bug: if the current subsong index > 0 and we restart it after a loop, then the first end song is not triggered
+            //so this hack seems to reset the proper internal states
+            openmpt_module_select_subsong(m_modulePlayback, (subsongIndex + 1) % numSubsongs);
+            openmpt_module_select_subsong(m_modulePlayback, subsongIndex);
+        }
+        else
+            openmpt_module_set_position_seconds(m_modulePlayback, 0.0);
         m_surround.Reset();
 
         // Silence trimmer
@@ -284,7 +268,6 @@ namespace rePlayer
 
         m_isSilenceTriggered = false;
         m_currentPosition = 0;
-        m_visualsSamples = 0;
     }
 
     void ReplayOpenMPT::ApplySettings(const CommandBuffer metadata)
@@ -316,7 +299,6 @@ namespace rePlayer
 
         int32_t vblank = (settings && (settings->overrideVblank)) ? settings->vblank : -1;
         openmpt_module_ctl_set_integer(m_modulePlayback, "vblank", vblank);
-        openmpt_module_ctl_set_integer(m_moduleVisuals, "vblank", vblank);
         if (m_vblank != vblank)
         {
             std::atomic_ref(m_isSilenceDetectionCancelled).store(true);
@@ -416,29 +398,20 @@ namespace rePlayer
 
     Replay::Patterns ReplayOpenMPT::UpdatePatterns(uint32_t numSamples, uint32_t numLines, uint32_t charWidth, uint32_t spaceWidth, Patterns::Flags flags)
     {
-        if (numSamples > 0)
-        {
-            auto availableSamples = Min(numSamples, m_visualsSamples);
-            m_visualsSamples -= availableSamples;
-            numSamples -= availableSamples;
-            while (numSamples)
-            {
-                m_visualsSamples = uint32_t(openmpt_module_read_one_tick(m_moduleVisuals, kSampleRate));
-                availableSamples = Min(numSamples, m_visualsSamples);
-                m_visualsSamples -= availableSamples;
-                numSamples -= availableSamples;
-            }
-        }
-
+        (void)numSamples;
         if (!m_arePatternsDisplayed && !(flags & Patterns::kEnablePatterns)) // kEnablePatterns has priority over internal flag
             return {};
 
+        // the row played right now, from the visual events pushed by the render
+        auto& visualEvent = GetVisualEvent();
+        if (visualEvent.pattern < 0)
+            return {};
+
         auto numChannels = openmpt_module_get_num_channels(m_moduleVisuals);
 
         Patterns patterns;
-        patterns.lines.Reserve(65536);
         patterns.sizes.Resize(numLines);
-        patterns.currentLine = openmpt_module_get_current_row(m_moduleVisuals);
+        patterns.currentLine = visualEvent.row;
         if (flags & (Patterns::kEnableInstruments | Patterns::kEnableVolume | Patterns::kEnableEffects))
             patterns.width = (numChannels * 4 - 1) * charWidth;
         else
@@ -464,8 +437,10 @@ namespace rePlayer
             patterns.width += numChannels * 3 * charWidth + spaceWidth * numChannels;
             size += uint16_t(numChannels * 4);
         }
+        // each line has its characters, up to 4 color changes per channel + 1 for the row number and its terminator
+        patterns.lines.Reserve(numLines * (size + numChannels * 4 + 2));
 
-        auto currentPattern = openmpt_module_get_current_pattern(m_moduleVisuals);
+        auto currentPattern = visualEvent.pattern;
         auto numRows = openmpt_module_get_pattern_num_rows(m_moduleVisuals, currentPattern);
         auto currentRow = patterns.currentLine - int32_t(numLines) / 2;
 
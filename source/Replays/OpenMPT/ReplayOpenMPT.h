@@ -91,6 +91,9 @@ namespace rePlayer
 
         static void SilenceDetection(ReplayOpenMPT* replay);
 
+        // rows are pushed to the visual events every chunk of rendered samples (~5ms)
+        static constexpr uint32_t kVisualsChunkSize = kSampleRate / 200;
+
     private:
         SmartPtr<io::Stream> m_stream;
         openmpt_module* m_modulePlayback = nullptr;
@@ -100,7 +103,6 @@ namespace rePlayer
         uint64_t m_silenceStart = 0;
         uint64_t m_currentPosition = 0;
         uint32_t m_previousSubsongIndex = 0xffFFffFF;
-        uint32_t m_visualsSamples = 0;
         Surround m_surround;
         bool m_arePatternsDisplayed = true;
         bool m_isSilenceTriggered = false;
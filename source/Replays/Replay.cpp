@@ -1,6 +1,9 @@
 #include "Replay.h"
 #include "ReplayPlugin.h"
 
+// stl
+#include <string_view>
+
 namespace rePlayer
 {
     #define EXTENSION(a) #a,
@@ -32,18 +35,141 @@ namespace rePlayer
     eExtension MediaType::sortedExtensions[int32_t(eExtension::Count)];
     int32_t MediaType::mapSortedExtensions[int32_t(eExtension::Count)];
 
-    MediaType::MediaType(const char* const otherExt, eReplay otherReplay)
-        : replay{ otherReplay }
-        , ext{ eExtension::Unknown }
+    namespace
     {
-        for (auto& extensionName : extensionNames)
+        #define EXTENSION(a) #a,
+        #define NO_EXTENSION() "",
+        constexpr std::string_view kExtensionNames[] = {
+            "---",
+            #include "Extensions.inc"
+        };
+        #undef NO_EXTENSION
+        #undef EXTENSION
+
+        // hash and displace: the extensions are spread in buckets, each bucket has a seed moving its extensions to free slots
+        struct ExtensionHash
         {
-            if (_stricmp(extensionName, otherExt) == 0)
+            static constexpr uint32_t kNumSlots = 2048;
+            static constexpr uint32_t kNumBuckets = 512;
+            static constexpr uint32_t kMaxBucketSize = 32;
+            static_assert(uint32_t(eExtension::Count) <= kNumSlots / 2);
+
+            static constexpr char Lower(char c)
             {
-                ext = static_cast<eExtension>(&extensionName - extensionNames);
-                break;
+                return c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c;
             }
-        }
+
+            static constexpr uint32_t Hash(const char* name, size_t length)
+            {
+                uint32_t hash = 2166136261u;
+                for (size_t i = 0; i < length; i++)
+                    hash = (hash ^ uint8_t(Lower(name[i]))) * 16777619u;
+                return hash;
+            }
+
+            static constexpr uint32_t Slot(uint32_t hash, uint32_t seed)
+            {
+                hash ^= seed * 0x9e3779b9u;
+                hash ^= hash >> 16;
+                hash *= 0x85ebca6bu;
+                hash ^= hash >> 13;
+                return hash & (kNumSlots - 1);
+            }
+
+            constexpr ExtensionHash()
+            {
+                constexpr uint32_t kNumExtensions = uint32_t(eExtension::Count);
+
+                // sort the extensions by bucket
+                uint32_t hashes[kNumExtensions] = {};
+                uint32_t bucketStarts[kNumBuckets + 1] = {};
+                for (uint32_t i = 1; i < kNumExtensions; i++)
+                {
+                    hashes[i] = Hash(kExtensionNames[i].data(), kExtensionNames[i].size());
+                    bucketStarts[hashes[i] % kNumBuckets + 1]++;
+                }
+                uint32_t maxBucketSize = 0;
+                for (uint32_t i = 0; i < kNumBuckets; i++)
+                {
+                    maxBucketSize = Max(maxBucketSize, bucketStarts[i + 1]);
+                    bucketStarts[i + 1] += bucketStarts[i];
+                }
+                uint16_t bucketExtensions[kNumExtensions] = {};
+                uint32_t bucketSizes[kNumBuckets] = {};
+                for (uint32_t i = 1; i < kNumExtensions; i++)
+                {
+                    auto bucket = hashes[i] % kNumBuckets;
+                    bucketExtensions[bucketStarts[bucket] + bucketSizes[bucket]++] = uint16_t(i);
+                }
+                if (maxBucketSize > kMaxBucketSize)
+                    return;
+
+                // the largest buckets first, while there are still a lot of free slots
+                for (auto bucketSize = maxBucketSize; bucketSize > 0; bucketSize--)
+                {
+                    for (uint32_t bucket = 0; bucket < kNumBuckets; bucket++)
+                    {
+                        if (bucketSizes[bucket] != bucketSize)
+                            continue;
+                        auto* extensions = bucketExtensions + bucketStarts[bucket];
+                        uint32_t candidates[kMaxBucketSize] = {};
+                        uint32_t seed = 1;
+                        for (;; seed++)
+                        {
+                            if (seed == 65536)
+                                return;
+                            uint32_t i = 0;
+                            for (; i < bucketSize; i++)
+                            {
+                                candidates[i] = Slot(hashes[extensions[i]], seed);
+                                bool isFree = slots[candidates[i]] == 0;
+                                for (uint32_t j = 0; j < i && isFree; j++)
+                                    isFree = candidates[j] != candidates[i];
+                                if (!isFree)
+                                    break;
+                            }
+                            if (i == bucketSize)
+                            {
+                                for (i = 0; i < bucketSize; i++)
+                                    slots[candidates[i]] = extensions[i];
+                                break;
+                            }
+                        }
+                        seeds[bucket] = uint16_t(seed);
+                    }
+                }
+                isValid = true;
+            }
+
+            uint16_t seeds[kNumBuckets] = {};
+            uint16_t slots[kNumSlots] = {}; // eExtension, 0 is an empty slot
+            bool isValid = false;
+        };
+
+        constexpr ExtensionHash kExtensionHash;
+        static_assert(kExtensionHash.isValid, "can't build the extensions perfect hash, change the seeds or the number of buckets");
+    }
+    // namespace
+
+    MediaType::MediaType(const char* const otherExt, eReplay otherReplay)
+        : replay{ otherReplay }
+        , ext{ FindExtension(otherExt) }
+    {}
+
+    eExtension MediaType::FindExtension(const char* name)
+    {
+        if (name == nullptr)
+            return eExtension::Unknown;
+        return FindExtension(name, strlen(name));
+    }
+
+    eExtension MediaType::FindExtension(const char* name, size_t length)
+    {
+        auto hash = ExtensionHash::Hash(name, length);
+        auto ext = kExtensionHash.slots[ExtensionHash::Slot(hash, kExtensionHash.seeds[hash % ExtensionHash::kNumBuckets])];
+        if (ext != 0 && extensionLengths[ext] == length && _strnicmp(extensionNames[ext], name, length) == 0)
+            return eExtension(ext);
+        return eExtension::Unknown;
     }
 
     const char* const MediaType::GetReplay() const
@@ -67,5 +193,44 @@ namespace rePlayer
     {
         g_replayPlugin.onDelete(this);
     }
+
+    void Replay::ResetVisuals()
+    {
+        // the render is stopped at this point
+        m_visualsWriteIndex.store(0);
+        m_visualsReadIndex.store(0);
+        m_visualsPos = 0;
+        m_lastVisualEvent = {};
+        m_visualEvent = {};
+    }
+
+    void Replay::UpdateVisuals(uint64_t playPos)
+    {
+        auto readIndex = m_visualsReadIndex.load(std::memory_order_relaxed);
+        auto writeIndex = m_visualsWriteIndex.load(std::memory_order_acquire);
+        for (; readIndex != writeIndex; readIndex++)
+        {
+            auto& visualEvent = m_visualEvents[readIndex % kNumVisualEvents];
+            if (visualEvent.pos > playPos)
+                break;
+            m_visualEvent = visualEvent;
+        }
+        m_visualsReadIndex.store(readIndex, std::memory_order_release);
+    }
+
+    void Replay::PushVisualEvent(uint32_t offset, int32_t order, int32_t pattern, int32_t row)
+    {
+        if (order == m_lastVisualEvent.order && pattern == m_lastVisualEvent.pattern && row == m_lastVisualEvent.row)
+            return;
+
+        auto writeIndex = m_visualsWriteIndex.load(std::memory_order_relaxed);
+        if (writeIndex - m_visualsReadIndex.load(std::memory_order_acquire) == kNumVisualEvents)
+            return; // nobody is looking, it will be queued on the next render once there is room
+
+        auto& visualEvent = m_visualEvents[writeIndex % kNumVisualEvents];
+        visualEvent = { m_visualsPos + offset, order, pattern, row };
+        m_lastVisualEvent = visualEvent;
+        m_visualsWriteIndex.store(writeIndex + 1, std::memory_order_release);
+    }
 }
 // namespace rePlayer
\ No newline at end of file
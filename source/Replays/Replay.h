@@ -6,6 +6,7 @@
 #include <IO/Stream.h>
 #include <Replays/ReplayContexts.h>
 
+#include <atomic>
 #include <string>
 
 struct ImGuiContext;
@@ -83,6 +84,15 @@ namespace rePlayer
             static const uint32_t colors[kNumColors];
         };
 
+        // position in the song pushed by the render, tagged with its sample position in the output
+        struct VisualEvent
+        {
+            uint64_t pos = 0; // samples since the last reset of the output
+            int32_t order = -1;
+            int32_t pattern = -1;
+            int32_t row = -1;
+        };
+
     public:
         virtual ~Replay();
 
@@ -111,14 +121,39 @@ namespace rePlayer
 
         virtual Patterns UpdatePatterns(uint32_t numSamples, uint32_t numLines, uint32_t charWidth, uint32_t spaceWidth, Patterns::Flags flags = Patterns::kDisplayAll) { (void)numSamples; (void)numLines; (void)charWidth; (void)spaceWidth; (void)flags; return {}; }
 
+        // visual events: the player tells where the next render goes, then it pops the events up to the play position
+        // a replay pushing its rows this way doesn't have to run a second replay to follow the audio in UpdatePatterns
+        void ResetVisuals();
+        void SetVisualsPosition(uint64_t pos) { m_visualsPos = pos; }
+        void UpdateVisuals(uint64_t playPos);
+        const VisualEvent& GetVisualEvent() const { return m_visualEvent; }
+
+        // opt-in snapshot of the whole playback state, used by the player to save checkpoints when seeking a replay without Seek
+        virtual bool CanSnapshot() const { return false; }
+        virtual void SaveSnapshot(Array<uint8_t>& state) const { (void)state; }
+        virtual void RestoreSnapshot(const Array<uint8_t>& state) { (void)state; }
+
     protected:
         Replay(MediaType mediaType) : m_mediaType(mediaType) {}
         Replay(const char* const ext, eReplay replay) : m_mediaType(ext, replay) {}
         Replay(eExtension ext, eReplay replay) : m_mediaType(ext, replay) {}
 
+        // from Render, offset is the position of the event in the output buffer (only the changes are queued)
+        void PushVisualEvent(uint32_t offset, int32_t order, int32_t pattern, int32_t row);
+
     protected:
         uint32_t m_subsongIndex = 0;
         mutable MediaType m_mediaType;
+
+    private:
+        // single producer (render)/single consumer (ui) ring, the events are dropped when it's full
+        static constexpr uint32_t kNumVisualEvents = 256;
+        VisualEvent m_visualEvents[kNumVisualEvents];
+        std::atomic<uint32_t> m_visualsWriteIndex = 0;
+        std::atomic<uint32_t> m_visualsReadIndex = 0;
+        uint64_t m_visualsPos = 0;
+        VisualEvent m_lastVisualEvent; // last queued (render side)
+        VisualEvent m_visualEvent; // current one (ui side)
     };
 }
 // namespace rePlayer
\ No newline at end of file
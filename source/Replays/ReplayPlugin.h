@@ -41,6 +41,8 @@ namespace rePlayer
         void (*release)() = [](){};
 
         Replay* (*load)(io::Stream*, CommandBuffer) = [](io::Stream*, CommandBuffer) { Replay* replay = nullptr;  return replay; };
+        // optional cheap header check, returning false rejects the stream without going through load (has to be thread safe)
+        bool (*sniff)(io::Stream*) = nullptr;
 
         bool (*displaySettings)() = [](){ return false; };
 
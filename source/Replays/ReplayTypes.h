@@ -58,6 +58,10 @@ namespace rePlayer
         const T* const GetExtension() const;
         const char* const GetReplay() const;
 
+        // case insensitive, through a perfect hash built at compile time
+        static eExtension FindExtension(const char* name);
+        static eExtension FindExtension(const char* name, size_t length);
+
         static const char* const extensionNames[];
         static const size_t extensionLengths[];
         static const char* const replayNames[];
@@ -27,6 +27,7 @@ extern "C"
 namespace rePlayer
 {
     ReplayPlugin g_replayPlugin = {
+        // the emulator (cpu, custom chips, memory banks) is made of process-wide globals: each instance needs its own copy of the dll
         .replayId = eReplay::UADE, .isThreadSafe = false,
         .name = "Unix Amiga Delitracker Emulator",
         .about = "UADE 3.0.5\nHeikki Orsila & Michael Doering",
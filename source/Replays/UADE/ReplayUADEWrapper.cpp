@@ -3,7 +3,6 @@
 #include <IO/StreamFile.h>
 #include <RePlayer/Version.h>
 #include <ReplayPlugin.h>
-#include <Thread/Mutex.h>
 
 extern "C"
 {
@@ -14,6 +13,7 @@ extern "C"
 #include <windows.h>
 #include <io.h>
 
+#include <atomic>
 #include <filesystem>
 
 extern "C" int uade_filesize(size_t * size, const char* pathname)
@@ -52,71 +52,116 @@ extern "C" int uade_atomic_close(int fd)
     return 0;
 }
 
-struct MySocket : public core::thread::Mutex
+// one channel per uade instance, the frontend and its core talk through a lock-free single producer/single consumer byte ring per direction
+// the fds given to uade encode the channel and the direction: kFdBase + channel * 2 + (0: core -> frontend, 1: frontend -> core)
+// only the transport is per instance, the emulator state is still global: one core runs at a time in a copy of the dll (see isThreadSafe)
+struct Channel
 {
-    HANDLE m_semaphore;
-    uint64_t m_messageOffset = 0;
-    core::Array<uint8_t> m_message;
-    int32_t m_count = 0;
+    struct Ring
+    {
+        static constexpr uint32_t kSize = 64 * 1024; // power of 2, bigger than any message (like a pipe, the writer waits when it's full)
+        static constexpr uint64_t kClosed = 1ull << 63; // or'ed in both positions, so the waiters wake up
+
+        uint8_t data[kSize];
+        alignas(64) std::atomic<uint64_t> writePos{ 0 };
+        alignas(64) std::atomic<uint64_t> readPos{ 0 };
+
+        ssize_t Read(uint8_t* dst, size_t count);
+        ssize_t Write(const uint8_t* src, size_t count);
+        void Close();
+    };
+
+    static constexpr int kFdBase = 0x7700;
+    static constexpr uint32_t kMaxChannels = 64;
+
+    static Channel* Get(int fd);
+
+    Ring rings[2];
+    uint32_t index;
+    HANDLE thread = nullptr;
 };
-static MySocket s_sockets[2];
-static bool s_isClosed = false;
+static std::atomic<Channel*> s_channels[Channel::kMaxChannels];
 
-extern "C" ssize_t uade_atomic_read(int fd, const void* buf, size_t count)
+ssize_t Channel::Ring::Read(uint8_t* dst, size_t count)
 {
-    assert((fd & 0xffF0) == 0x7770);
-    if (s_isClosed)
-        return 0;
-
-    auto& socket = s_sockets[fd & 1];
-    auto dst = (uint8_t*)buf;
-    size_t bytes_read = 0;
-    while (bytes_read < count)
+    size_t bytesRead = 0;
+    while (bytesRead < count)
     {
-        ::WaitForSingleObject(socket.m_semaphore, INFINITE);
-        if (s_isClosed)
+        auto pos = readPos.load(std::memory_order_relaxed);
+        auto endPos = writePos.load(std::memory_order_acquire);
+        if ((pos | endPos) & kClosed)
             return 0;
-        socket.Lock();
-
-        auto src = socket.m_message.Items() + socket.m_messageOffset;
-        auto messageSize = socket.m_message.NumItems() - socket.m_messageOffset;
-        auto toRead = size_t(core::Min(count - bytes_read, messageSize));
-        memcpy(dst + bytes_read, src, toRead);
-
-        bytes_read += toRead;
-        socket.m_messageOffset += toRead;
-        if (socket.m_messageOffset == socket.m_message.NumItems())
+        if (endPos == pos)
         {
-            socket.m_message.Clear();
-            socket.m_messageOffset = 0;
+            writePos.wait(endPos);
+            continue;
         }
-        else
+
+        auto toRead = size_t(core::Min(count - bytesRead, endPos - pos));
+        auto offset = uint32_t(pos) & (kSize - 1);
+        auto size = core::Min(toRead, size_t(kSize - offset));
+        memcpy(dst + bytesRead, data + offset, size);
+        memcpy(dst + bytesRead + size, data, toRead - size);
+        bytesRead += toRead;
+
+        readPos.fetch_add(toRead, std::memory_order_release);
+        readPos.notify_one();
+    }
+    return ssize_t(bytesRead);
+}
+
+ssize_t Channel::Ring::Write(const uint8_t* src, size_t count)
+{
+    size_t bytesWritten = 0;
+    while (bytesWritten < count)
+    {
+        auto pos = writePos.load(std::memory_order_relaxed);
+        auto startPos = readPos.load(std::memory_order_acquire);
+        if ((pos | startPos) & kClosed)
+            return 0;
+        auto space = kSize - (pos - startPos);
+        if (space == 0)
         {
-            ::ReleaseSemaphore(socket.m_semaphore, 1, nullptr);
+            readPos.wait(startPos);
+            continue;
         }
 
-        socket.Unlock();
+        auto toWrite = size_t(core::Min(count - bytesWritten, space));
+        auto offset = uint32_t(pos) & (kSize - 1);
+        auto size = core::Min(toWrite, size_t(kSize - offset));
+        memcpy(data + offset, src + bytesWritten, size);
+        memcpy(data, src + bytesWritten + size, toWrite - size);
+        bytesWritten += toWrite;
+
+        writePos.fetch_add(toWrite, std::memory_order_release);
+        writePos.notify_one();
     }
-    return bytes_read;
+    return ssize_t(bytesWritten);
 }
 
-extern "C" ssize_t uade_atomic_write(int fd, const void* buf, size_t count)
+void Channel::Ring::Close()
 {
-    assert((fd & 0xffF0) == 0x7770);
-    if (s_isClosed)
-        return 0;
-
-    auto& socket = s_sockets[fd & 1];
-    socket.Lock();
+    writePos.fetch_or(kClosed);
+    writePos.notify_all();
+    readPos.fetch_or(kClosed);
+    readPos.notify_all();
+}
 
-    auto offset = socket.m_message.NumItems();
-    socket.m_message.Resize(uint32_t(offset + count));
-    memcpy(socket.m_message.Items(offset), buf, count);
+Channel* Channel::Get(int fd)
+{
+    auto index = uint32_t(fd - kFdBase) >> 1;
+    assert(index < kMaxChannels && s_channels[index].load() != nullptr);
+    return s_channels[index].load(std::memory_order_acquire);
+}
 
-    socket.Unlock();
-    ::ReleaseSemaphore(socket.m_semaphore, 1, nullptr);
+extern "C" ssize_t uade_atomic_read(int fd, const void* buf, size_t count)
+{
+    return Channel::Get(fd)->rings[fd & 1].Read((uint8_t*)buf, count);
+}
 
-    return count;
+extern "C" ssize_t uade_atomic_write(int fd, const void* buf, size_t count)
+{
+    return Channel::Get(fd)->rings[fd & 1].Write((const uint8_t*)buf, count);
 }
 
 extern "C" int in_m68k_go;
@@ -126,33 +171,49 @@ extern "C" void uade_arch_kill_and_wait_uadecore(struct uade_ipc* /*ipc*/, void*
     while (in_m68k_go == 0)
         ::Sleep(1);
 
-    s_isClosed = true;
-    ::ReleaseSemaphore(s_sockets[0].m_semaphore, 1, nullptr);
-    ::ReleaseSemaphore(s_sockets[1].m_semaphore, 1, nullptr);
+    auto* channel = reinterpret_cast<Channel*>(*userdata);
+    channel->rings[0].Close();
+    channel->rings[1].Close();
 
-    WaitForSingleObject((HANDLE)*userdata, INFINITE);
-    CloseHandle((HANDLE)*userdata);
+    WaitForSingleObject(channel->thread, INFINITE);
+    CloseHandle(channel->thread);
 
-    CloseHandle(s_sockets[0].m_semaphore);
-    CloseHandle(s_sockets[1].m_semaphore);
+    s_channels[channel->index].store(nullptr);
+    delete channel;
 }
 
 extern "C" int uadecore_main(int argc, char** argv);
 
-static void thread_func()
+static DWORD WINAPI thread_func(LPVOID param)
 {
-    const char *args[] = { "uadecore", "-i", "30577", "-o", "30576" };
+    auto* channel = reinterpret_cast<Channel*>(param);
+    char inFd[16], outFd[16];
+    sprintf(inFd, "%d", Channel::kFdBase + channel->index * 2 + 1);
+    sprintf(outFd, "%d", Channel::kFdBase + channel->index * 2);
+    const char *args[] = { "uadecore", "-i", inFd, "-o", outFd };
     uadecore_main(5, (char**)args);
+    return 0;
 }
 
 extern "C" int uade_arch_spawn(struct uade_ipc *ipc, /*pid_t * uadepid*/void** userdata, const char */*uadename*/)
 {
-    s_sockets[0].m_semaphore = ::CreateSemaphore(nullptr, 0, 1, nullptr);
-    s_sockets[1].m_semaphore = ::CreateSemaphore(nullptr, 0, 1, nullptr);
+    auto* channel = new Channel;
+    for (channel->index = 0; channel->index < Channel::kMaxChannels; channel->index++)
+    {
+        Channel* freeChannel = nullptr;
+        if (s_channels[channel->index].compare_exchange_strong(freeChannel, channel))
+            break;
+    }
+    if (channel->index == Channel::kMaxChannels)
+    {
+        delete channel;
+        return -1;
+    }
 
-    *userdata = (void*)CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)thread_func, nullptr, 0, nullptr);
+    channel->thread = CreateThread(NULL, 0, thread_func, channel, 0, nullptr);
+    *userdata = channel;
 
-    uade_set_peer(ipc, 1, 0x7770, 0x7771);
+    uade_set_peer(ipc, 1, Channel::kFdBase + channel->index * 2, Channel::kFdBase + channel->index * 2 + 1);
     return 0;
 }
 
@@ -8,6 +8,7 @@
 
 #include <Deck/Deck.h>
 #include <Graphics/Graphics.h>
+#include <RePlayer/Benchmark.h>
 #include <RePlayer/Core.h>
 #include <RePlayer/RePlayer.h>
 
@@ -254,6 +255,18 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int /*nCmdShow*/)
 
     ::OleInitialize(NULL);
 
+    // headless benchmark (output on the console we've been launched from)
+    int32_t argc = 0;
+    auto* argv = ::CommandLineToArgvW(::GetCommandLineW(), &argc);
+    const bool isBenchmark = rePlayer::Benchmark::IsRequested(argc, argv);
+    int32_t exitCode = 0;
+    if (isBenchmark && ::AttachConsole(ATTACH_PARENT_PROCESS))
+    {
+        FILE* f;
+        freopen_s(&f, "CONOUT$", "w", stdout);
+        freopen_s(&f, "CONOUT$", "w", stderr);
+    }
+
     if (s_rePlayer = RePlayer::Create())
     {
         // Create application window
@@ -304,14 +317,17 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int /*nCmdShow*/)
         }
 #endif
 
-        // Taskbar Icon begin
-        CreateSystrayIcon();
+        if (!isBenchmark)
+        {
+            // Taskbar Icon begin
+            CreateSystrayIcon();
 
-        // Show the window
-        auto mainWindowExStyle = ::GetWindowLongW(s_hWnd, GWL_EXSTYLE);
-        ::SetWindowLongW(s_hWnd, GWL_EXSTYLE, mainWindowExStyle | WS_EX_TRANSPARENT | WS_EX_LAYERED);
-        ::ShowWindow(s_hWnd, SW_SHOW);
-        ::UpdateWindow(s_hWnd);
+            // Show the window
+            auto mainWindowExStyle = ::GetWindowLongW(s_hWnd, GWL_EXSTYLE);
+            ::SetWindowLongW(s_hWnd, GWL_EXSTYLE, mainWindowExStyle | WS_EX_TRANSPARENT | WS_EX_LAYERED);
+            ::ShowWindow(s_hWnd, SW_SHOW);
+            ::UpdateWindow(s_hWnd);
+        }
 
 /*
         LONG cur_style = ::GetWindowLongW(s_hWnd, GWL_EXSTYLE);
@@ -321,7 +337,10 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int /*nCmdShow*/)
 
         std::srand(static_cast<uint32_t>(std::time(0) & 0xffFFffFF));
 
-        if (s_rePlayer->Launch() == core::Status::kOk)
+        auto status = s_rePlayer->Launch();
+        if (status == core::Status::kOk && isBenchmark)
+            exitCode = rePlayer::Benchmark::Run(argc, argv);
+        else if (status == core::Status::kOk)
         {
             // Main loop
             MSG msg = {};
@@ -411,5 +430,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int /*nCmdShow*/)
 
     ::OleUninitialize();
 
-    return 0;
+    ::LocalFree(argv);
+
+    return exitCode;
 }